@@ -0,0 +1,917 @@
+//
+//  KSOTokenBenchmark.c
+//  KSOToken
+//
+//  Created by William Towe on 10/17/26.
+//  Copyright © 2021 Kosoku Interactive, LLC. All rights reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+// Command line harness for the UIKit free parts of KSOToken: the tokenizer, the completion index, the fuzzy matcher, snapshots and corpus files. Workloads are generated from a fixed seed so runs are comparable, results are written to stdout as JSON. See the Makefile in this directory.
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "KSOTokenTokenizerFunctions.h"
+#include "KSOTokenCompletionIndexFunctions.h"
+#include "KSOTokenFuzzyMatchFunctions.h"
+#include "KSOTokenSnapshotFunctions.h"
+#include "KSOTokenCorpusFunctions.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#if defined(__APPLE__)
+#include <mach/mach.h>
+#endif
+
+// the cores are compiled with malloc and free redirected to these, so every allocation they make is counted
+static uint64_t KSOTokenBenchmarkAllocationCount;
+static uint64_t KSOTokenBenchmarkAllocatedBytes;
+
+void *KSOTokenBenchmarkMalloc(size_t size) {
+    KSOTokenBenchmarkAllocationCount++;
+    KSOTokenBenchmarkAllocatedBytes += size;
+    
+    return malloc(size);
+}
+void KSOTokenBenchmarkFree(void *pointer) {
+    free(pointer);
+}
+
+// Workloads
+
+typedef struct {
+    uint64_t state;
+} KSOTokenBenchmarkRandom;
+
+static uint64_t KSOTokenBenchmarkRandomNext(KSOTokenBenchmarkRandom *random) {
+    // xorshift64*
+    random->state ^= random->state >> 12;
+    random->state ^= random->state << 25;
+    random->state ^= random->state >> 27;
+    
+    return random->state * 0x2545F4914F6CDD1DULL;
+}
+static size_t KSOTokenBenchmarkRandomUniform(KSOTokenBenchmarkRandom *random, size_t upperBound) {
+    return upperBound == 0 ? 0 : (size_t)(KSOTokenBenchmarkRandomNext(random) % upperBound);
+}
+
+// the corpus is laid out like KSOTokenCompletionIndex, each entry is terminated by 0 and offsets has one extra element for the total length, loading it does not fold it
+typedef struct {
+    uint16_t *characters;
+    uint16_t *foldedCharacters;
+    size_t length;
+    uint32_t *offsets;
+    size_t count;
+} KSOTokenBenchmarkCorpus;
+
+static bool KSOTokenBenchmarkCorpusLoad(KSOTokenBenchmarkCorpus *corpus, const char *path) {
+    FILE *file = fopen(path, "rb");
+    
+    if (file == NULL) {
+        return false;
+    }
+    
+    fseek(file, 0, SEEK_END);
+    
+    long size = ftell(file);
+    
+    fseek(file, 0, SEEK_SET);
+    
+    char *bytes = malloc((size_t)size + 1);
+    
+    if (bytes == NULL ||
+        fread(bytes, 1, (size_t)size, file) != (size_t)size) {
+        
+        free(bytes);
+        fclose(file);
+        return false;
+    }
+    
+    fclose(file);
+    
+    size_t count = 0;
+    
+    for (long i=0; i<size; i++) {
+        if (bytes[i] == '\n') {
+            count++;
+        }
+    }
+    
+    // words.txt is ascii, so each byte is one code unit
+    corpus->characters = malloc(sizeof(uint16_t) * ((size_t)size + 2));
+    corpus->foldedCharacters = NULL;
+    corpus->offsets = malloc(sizeof(uint32_t) * (count + 2));
+    corpus->length = 0;
+    corpus->count = 0;
+    
+    size_t start = 0;
+    
+    for (size_t i=0; i<=(size_t)size; i++) {
+        if (i < (size_t)size &&
+            bytes[i] != '\n') {
+            
+            continue;
+        }
+        
+        size_t end = i;
+        
+        if (end > start &&
+            bytes[end - 1] == '\r') {
+            
+            end--;
+        }
+        if (end > start) {
+            corpus->offsets[corpus->count++] = (uint32_t)corpus->length;
+            
+            for (size_t j=start; j<end; j++) {
+                corpus->characters[corpus->length++] = (unsigned char)bytes[j];
+            }
+            corpus->characters[corpus->length++] = 0;
+        }
+        
+        start = i + 1;
+    }
+    
+    corpus->offsets[corpus->count] = (uint32_t)corpus->length;
+    
+    free(bytes);
+    
+    return true;
+}
+static size_t KSOTokenBenchmarkCorpusEntryLength(const KSOTokenBenchmarkCorpus *corpus, size_t index) {
+    return corpus->offsets[index + 1] - corpus->offsets[index] - 1;
+}
+
+// appends random corpus entries separated by delimiter and a space until length code units are written, every nth entry is replaced by a token text attachment
+static void KSOTokenBenchmarkFillField(uint16_t *field, size_t length, const KSOTokenBenchmarkCorpus *corpus, KSOTokenBenchmarkRandom *random, uint16_t delimiter, size_t attachmentInterval) {
+    size_t position = 0;
+    size_t entries = 0;
+    
+    while (position < length) {
+        if (attachmentInterval > 0 &&
+            ++entries % attachmentInterval == 0) {
+            
+            field[position++] = KSOTokenAttachmentCharacter;
+            continue;
+        }
+        
+        size_t index = KSOTokenBenchmarkRandomUniform(random, corpus->count);
+        const uint16_t *entry = corpus->characters + corpus->offsets[index];
+        size_t entryLength = KSOTokenBenchmarkCorpusEntryLength(corpus, index);
+        
+        for (size_t i=0; i<entryLength && position<length; i++) {
+            field[position++] = entry[i];
+        }
+        if (position < length) {
+            field[position++] = delimiter;
+        }
+        if (position < length) {
+            field[position++] = ' ';
+        }
+    }
+}
+
+// Reporting
+
+typedef struct {
+    const char *name;
+    // the number of operations timed together in each sample, operations that take nanoseconds are too fast to time one at a time
+    size_t batch;
+    // what throughput counts, for example "ops" or "bytes"
+    const char *unit;
+    // the number of units processed by each operation
+    double unitsPerOperation;
+    uint64_t *samples;
+    size_t samplesCount;
+    uint64_t allocationCount;
+    uint64_t allocatedBytes;
+    // the largest growth in resident memory of any sample, only written for benchmarks that measure it
+    uint64_t residentBytes;
+    bool measuresResidentBytes;
+} KSOTokenBenchmarkResult;
+
+static uint64_t KSOTokenBenchmarkNow(void) {
+    struct timespec time;
+    
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    
+    return (uint64_t)time.tv_sec * 1000000000ULL + (uint64_t)time.tv_nsec;
+}
+// the resident memory of the process, or 0 where it cannot be read
+static uint64_t KSOTokenBenchmarkResidentBytes(void) {
+#if defined(__linux__)
+    FILE *file = fopen("/proc/self/statm", "r");
+    unsigned long size;
+    unsigned long resident = 0;
+    
+    if (file != NULL) {
+        if (fscanf(file, "%lu %lu", &size, &resident) != 2) {
+            resident = 0;
+        }
+        fclose(file);
+    }
+    
+    return (uint64_t)resident * (uint64_t)sysconf(_SC_PAGESIZE);
+#elif defined(__APPLE__)
+    mach_task_basic_info_data_t info;
+    mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+    
+    return task_info(mach_task_self(), MACH_TASK_BASIC_INFO, (task_info_t)&info, &count) == KERN_SUCCESS ? info.resident_size : 0;
+#else
+    return 0;
+#endif
+}
+static int KSOTokenBenchmarkCompareSamples(const void *first, const void *second) {
+    uint64_t a = *(const uint64_t *)first;
+    uint64_t b = *(const uint64_t *)second;
+    
+    return a < b ? -1 : a > b ? 1 : 0;
+}
+static double KSOTokenBenchmarkPercentile(const uint64_t *sortedSamples, size_t count, double percentile) {
+    size_t index = (size_t)(percentile * (double)(count - 1) + 0.5);
+    
+    return (double)sortedSamples[index];
+}
+static void KSOTokenBenchmarkResultWrite(FILE *file, KSOTokenBenchmarkResult *result, bool first) {
+    uint64_t total = 0;
+    
+    for (size_t i=0; i<result->samplesCount; i++) {
+        total += result->samples[i];
+    }
+    
+    qsort(result->samples, result->samplesCount, sizeof(uint64_t), KSOTokenBenchmarkCompareSamples);
+    
+    // latencies are per operation, so divide each sample by the number of operations in it
+    double batch = (double)result->batch;
+    double operations = batch * (double)result->samplesCount;
+    
+    fprintf(file, "%s\n    {\"name\": \"%s\", \"iterations\": %zu, \"batch\": %zu, ", first ? "" : ",", result->name, result->samplesCount, result->batch);
+    fprintf(file, "\"latency_ns\": {\"mean\": %.1f, \"p50\": %.1f, \"p90\": %.1f, \"p99\": %.1f, \"max\": %.1f}, ", (double)total / operations, KSOTokenBenchmarkPercentile(result->samples, result->samplesCount, 0.5) / batch, KSOTokenBenchmarkPercentile(result->samples, result->samplesCount, 0.9) / batch, KSOTokenBenchmarkPercentile(result->samples, result->samplesCount, 0.99) / batch, (double)result->samples[result->samplesCount - 1] / batch);
+    fprintf(file, "\"throughput\": %.1f, \"throughput_unit\": \"%s/s\", ", total > 0 ? operations * result->unitsPerOperation * 1e9 / (double)total : 0.0, result->unit);
+    fprintf(file, "\"allocations\": %.2f, \"allocated_bytes\": %.1f", (double)result->allocationCount / operations, (double)result->allocatedBytes / operations);
+    
+    if (result->measuresResidentBytes) {
+        fprintf(file, ", \"resident_bytes\": %llu", (unsigned long long)result->residentBytes);
+    }
+    
+    fprintf(file, "}");
+}
+
+typedef struct {
+    const char *filter;
+    size_t iterations;
+    FILE *output;
+    bool first;
+} KSOTokenBenchmarkContext;
+
+static bool KSOTokenBenchmarkShouldRun(const KSOTokenBenchmarkContext *context, const char *name) {
+    return context->filter == NULL || strstr(name, context->filter) != NULL;
+}
+static void KSOTokenBenchmarkBegin(KSOTokenBenchmarkResult *result, const char *name, size_t iterations, size_t batch, const char *unit, double unitsPerOperation) {
+    memset(result, 0, sizeof(*result));
+    
+    result->name = name;
+    result->batch = batch;
+    result->unit = unit;
+    result->unitsPerOperation = unitsPerOperation;
+    result->samples = malloc(sizeof(uint64_t) * iterations);
+    
+    KSOTokenBenchmarkAllocationCount = 0;
+    KSOTokenBenchmarkAllocatedBytes = 0;
+}
+static void KSOTokenBenchmarkEnd(KSOTokenBenchmarkContext *context, KSOTokenBenchmarkResult *result) {
+    result->allocationCount = KSOTokenBenchmarkAllocationCount;
+    result->allocatedBytes = KSOTokenBenchmarkAllocatedBytes;
+    
+    KSOTokenBenchmarkResultWrite(context->output, result, context->first);
+    
+    context->first = false;
+    
+    free(result->samples);
+}
+
+// keeps the compiler from discarding results that are otherwise unused
+static volatile size_t KSOTokenBenchmarkSink;
+
+// Benchmarks
+
+// what -[KSOTokenTextView _tokenRangeForRange:] does on every edit, scan out from a location to the surrounding delimiters or token text attachments
+static void KSOTokenBenchmarkTokenRange(KSOTokenBenchmarkContext *context, const KSOTokenBenchmarkCorpus *corpus, const KSOTokenDelimiterSet *delimiters, size_t fieldLength) {
+    char name[64];
+    
+    snprintf(name, sizeof(name), "token_range/%zu", fieldLength);
+    
+    if (!KSOTokenBenchmarkShouldRun(context, name)) {
+        return;
+    }
+    
+    KSOTokenBenchmarkRandom random = {.state = 0x4B534F546F6B656EULL ^ fieldLength};
+    uint16_t *field = malloc(sizeof(uint16_t) * fieldLength);
+    size_t batch = 1000;
+    KSOTokenBenchmarkResult result;
+    
+    KSOTokenBenchmarkFillField(field, fieldLength, corpus, &random, ',', 8);
+    KSOTokenBenchmarkBegin(&result, name, context->iterations, batch, "ops", 1.0);
+    
+    for (size_t i=0; i<context->iterations; i++) {
+        uint64_t start = KSOTokenBenchmarkNow();
+        
+        for (size_t j=0; j<batch; j++) {
+            size_t location = KSOTokenBenchmarkRandomUniform(&random, fieldLength + 1);
+            size_t first = KSOTokenScanBackward(field, location, delimiters);
+            
+            KSOTokenBenchmarkSink = KSOTokenScanForward(field, fieldLength, location, delimiters) - first;
+        }
+        
+        result.samples[result.samplesCount++] = KSOTokenBenchmarkNow() - start;
+    }
+    
+    KSOTokenBenchmarkEnd(context, &result);
+    free(field);
+}
+
+// what -[KSOTokenTextView paste:] does on a background queue before resolving represented objects
+static void KSOTokenBenchmarkPasteSplit(KSOTokenBenchmarkContext *context, const KSOTokenBenchmarkCorpus *corpus, const KSOTokenDelimiterSet *delimiters, const KSOTokenDelimiterSet *whitespace, size_t payloadLength) {
+    char name[64];
+    
+    snprintf(name, sizeof(name), "paste_split/%zu", payloadLength);
+    
+    if (!KSOTokenBenchmarkShouldRun(context, name)) {
+        return;
+    }
+    
+    KSOTokenBenchmarkRandom random = {.state = 0x7061737465ULL ^ payloadLength};
+    uint16_t *payload = malloc(sizeof(uint16_t) * payloadLength);
+    size_t capacity = payloadLength / 2 + 1;
+    KSOTokenTextRange *ranges = malloc(sizeof(KSOTokenTextRange) * capacity);
+    KSOTokenBenchmarkResult result;
+    
+    KSOTokenBenchmarkFillField(payload, payloadLength, corpus, &random, ',', 0);
+    KSOTokenBenchmarkBegin(&result, name, context->iterations, 1, "bytes", (double)(payloadLength * sizeof(uint16_t)));
+    
+    for (size_t i=0; i<context->iterations; i++) {
+        uint64_t start = KSOTokenBenchmarkNow();
+        
+        KSOTokenBenchmarkSink = KSOTokenSplitTokenTexts(payload, payloadLength, delimiters, whitespace, ranges, capacity);
+        
+        result.samples[result.samplesCount++] = KSOTokenBenchmarkNow() - start;
+    }
+    
+    KSOTokenBenchmarkEnd(context, &result);
+    free(ranges);
+    free(payload);
+}
+
+// what -[KSOTokenCompletionIndex initWithStrings:weights:] does after copying the strings
+static void KSOTokenBenchmarkIndexBuild(KSOTokenBenchmarkContext *context, const KSOTokenBenchmarkCorpus *corpus) {
+    const char *name = "index_build";
+    
+    if (!KSOTokenBenchmarkShouldRun(context, name)) {
+        return;
+    }
+    
+    // building the index takes long enough that a few samples are plenty
+    size_t iterations = context->iterations < 5 ? context->iterations : 5;
+    KSOTokenBenchmarkResult result;
+    
+    KSOTokenBenchmarkBegin(&result, name, iterations, 1, "entries", (double)corpus->count);
+    
+    for (size_t i=0; i<iterations; i++) {
+        uint64_t start = KSOTokenBenchmarkNow();
+        uint16_t *folded = KSOTokenBenchmarkMalloc(sizeof(uint16_t) * corpus->length);
+        size_t count;
+        
+        KSOTokenFoldCharacters(corpus->characters, folded, corpus->length);
+        
+        uint32_t *suffixes = KSOTokenSuffixArrayCreate(folded, corpus->length, &count);
+        uint64_t *masks = KSOTokenBenchmarkMalloc(sizeof(uint64_t) * corpus->count);
+        
+        for (size_t j=0; j<corpus->count; j++) {
+            masks[j] = KSOTokenFuzzyCharactersMask(folded + corpus->offsets[j], KSOTokenBenchmarkCorpusEntryLength(corpus, j));
+        }
+        
+        result.samples[result.samplesCount++] = KSOTokenBenchmarkNow() - start;
+        
+        KSOTokenBenchmarkSink = count;
+        free(masks);
+        free(suffixes);
+        free(folded);
+    }
+    
+    KSOTokenBenchmarkEnd(context, &result);
+}
+
+// what -[KSOTokenCompletionIndex completionResultsForSubstring:offset:limit:scoringBlock:] does with the default ranking, keeping the best 100 matches
+static void KSOTokenBenchmarkSubstringQuery(KSOTokenBenchmarkContext *context, const KSOTokenBenchmarkCorpus *corpus, const uint32_t *suffixes, size_t suffixesCount, const uint32_t *prefixes, size_t prefixesCount, size_t queryLength) {
+    char name[64];
+    
+    snprintf(name, sizeof(name), "substring_query/%zu", queryLength);
+    
+    if (!KSOTokenBenchmarkShouldRun(context, name)) {
+        return;
+    }
+    
+    KSOTokenBenchmarkRandom random = {.state = 0x717565727900ULL ^ queryLength};
+    KSOTokenBenchmarkResult result;
+    
+    KSOTokenBenchmarkBegin(&result, name, context->iterations, 1, "ops", 1.0);
+    
+    for (size_t i=0; i<context->iterations; i++) {
+        // queries are substrings of random entries, so every query has at least one match
+        size_t queryIndex;
+        
+        do {
+            queryIndex = KSOTokenBenchmarkRandomUniform(&random, corpus->count);
+        } while (KSOTokenBenchmarkCorpusEntryLength(corpus, queryIndex) < queryLength);
+        
+        const uint16_t *query = corpus->foldedCharacters + corpus->offsets[queryIndex] + KSOTokenBenchmarkRandomUniform(&random, KSOTokenBenchmarkCorpusEntryLength(corpus, queryIndex) - queryLength + 1);
+        uint64_t start = KSOTokenBenchmarkNow();
+        KSOTokenBoundedHeap heap;
+        size_t prefixesLength;
+        size_t prefixesFirst = KSOTokenSuffixArrayFind(corpus->foldedCharacters, corpus->length, prefixes, prefixesCount, query, queryLength, &prefixesLength);
+        size_t suffixesLength;
+        size_t suffixesFirst = KSOTokenSuffixArrayFind(corpus->foldedCharacters, corpus->length, suffixes, suffixesCount, query, queryLength, &suffixesLength);
+        
+        KSOTokenBoundedHeapInit(&heap, 100);
+        
+        for (size_t j=prefixesFirst; j<prefixesFirst + prefixesLength; j++) {
+            size_t index = KSOTokenOffsetsFind(corpus->offsets, corpus->count, prefixes[j]);
+            
+            KSOTokenBoundedHeapInsert(&heap, KSOTokenCompletionRankKey(0, KSOTokenBenchmarkCorpusEntryLength(corpus, index), index));
+        }
+        
+        // prefix matches outrank everything else, once the heap is full the index stops at the first other match
+        for (size_t j=suffixesFirst; j<suffixesFirst + suffixesLength; j++) {
+            size_t index = KSOTokenOffsetsFind(corpus->offsets, corpus->count, suffixes[j]);
+            size_t location = suffixes[j] - corpus->offsets[index];
+            
+            if (location == 0 ||
+                KSOTokenCharactersContainPattern(corpus->foldedCharacters + corpus->offsets[index], location + queryLength - 1, query, queryLength)) {
+                
+                continue;
+            }
+            if (heap.count == heap.capacity) {
+                break;
+            }
+            
+            KSOTokenBoundedHeapInsert(&heap, KSOTokenCompletionRankKey(location, KSOTokenBenchmarkCorpusEntryLength(corpus, index), index));
+        }
+        
+        KSOTokenBoundedHeapSort(&heap);
+        
+        result.samples[result.samplesCount++] = KSOTokenBenchmarkNow() - start;
+        
+        KSOTokenBenchmarkSink = heap.count;
+        KSOTokenBoundedHeapDestroy(&heap);
+    }
+    
+    KSOTokenBenchmarkEnd(context, &result);
+}
+
+// what -[KSOTokenCompletionIndex completionResultsForFuzzyString:maximumDistance:offset:limit:scoringBlock:] does, keeping the best 100 matches
+static void KSOTokenBenchmarkFuzzyQuery(KSOTokenBenchmarkContext *context, const KSOTokenBenchmarkCorpus *corpus, const uint64_t *masks, size_t maximumDistance) {
+    char name[64];
+    
+    snprintf(name, sizeof(name), "fuzzy_query/%zu", maximumDistance);
+    
+    if (!KSOTokenBenchmarkShouldRun(context, name)) {
+        return;
+    }
+    
+    KSOTokenBenchmarkRandom random = {.state = 0x66757A7A79ULL ^ maximumDistance};
+    size_t batchSize = 4096;
+    uint32_t *candidates = malloc(sizeof(uint32_t) * batchSize);
+    KSOTokenBenchmarkResult result;
+    
+    // a full scan per query, fewer samples keep the run short
+    size_t iterations = context->iterations < 100 ? context->iterations : 100;
+    
+    KSOTokenBenchmarkBegin(&result, name, iterations, 1, "entries", (double)corpus->count);
+    
+    for (size_t i=0; i<iterations; i++) {
+        size_t queryIndex;
+        
+        do {
+            queryIndex = KSOTokenBenchmarkRandomUniform(&random, corpus->count);
+        } while (KSOTokenBenchmarkCorpusEntryLength(corpus, queryIndex) < 4);
+        
+        // the first 4 to 8 characters of a random entry, with two adjacent characters transposed when typos are allowed
+        uint16_t query[8];
+        size_t queryLength = KSOTokenBenchmarkCorpusEntryLength(corpus, queryIndex);
+        
+        queryLength = 4 + KSOTokenBenchmarkRandomUniform(&random, (queryLength < 8 ? queryLength : 8) - 3);
+        memcpy(query, corpus->foldedCharacters + corpus->offsets[queryIndex], sizeof(uint16_t) * queryLength);
+        
+        if (maximumDistance > 0) {
+            size_t position = KSOTokenBenchmarkRandomUniform(&random, queryLength - 1);
+            uint16_t temp = query[position];
+            
+            query[position] = query[position + 1];
+            query[position + 1] = temp;
+        }
+        
+        uint64_t start = KSOTokenBenchmarkNow();
+        KSOTokenFuzzyPattern pattern;
+        KSOTokenBoundedHeap heap;
+        
+        KSOTokenFuzzyPatternInit(&pattern, query, queryLength, maximumDistance);
+        KSOTokenBoundedHeapInit(&heap, 100);
+        
+        for (size_t first=0; first<corpus->count; first+=batchSize) {
+            size_t count = corpus->count - first < batchSize ? corpus->count - first : batchSize;
+            size_t candidatesCount = KSOTokenFuzzyFilterMasks(masks + first, count, &pattern, candidates);
+            
+            for (size_t j=0; j<candidatesCount; j++) {
+                size_t index = first + candidates[j];
+                KSOTokenFuzzyMatchResult match;
+                
+                if (KSOTokenFuzzyMatch(&pattern, corpus->foldedCharacters + corpus->offsets[index], KSOTokenBenchmarkCorpusEntryLength(corpus, index), masks[index], NULL, &match)) {
+                    KSOTokenBoundedHeapInsertScore(&heap, match.score, index);
+                }
+            }
+        }
+        
+        KSOTokenBoundedHeapSort(&heap);
+        
+        result.samples[result.samplesCount++] = KSOTokenBenchmarkNow() - start;
+        
+        KSOTokenBenchmarkSink = heap.count;
+        KSOTokenBoundedHeapDestroy(&heap);
+    }
+    
+    KSOTokenBenchmarkEnd(context, &result);
+    free(candidates);
+}
+
+// what the completion delegate of the demo does on the first keystroke, fuzzy match a single character allowing one typo and keep the best 100 matches
+static size_t KSOTokenBenchmarkFirstCompletion(const KSOTokenCorpus *corpus, uint16_t query, uint32_t *candidates, size_t batchSize) {
+    KSOTokenFuzzyPattern pattern;
+    KSOTokenBoundedHeap heap;
+    
+    KSOTokenFuzzyPatternInit(&pattern, &query, 1, 1);
+    KSOTokenBoundedHeapInit(&heap, 100);
+    
+    for (size_t first=0; first<corpus->count; first+=batchSize) {
+        size_t count = corpus->count - first < batchSize ? corpus->count - first : batchSize;
+        size_t candidatesCount = KSOTokenFuzzyFilterMasks(corpus->masks + first, count, &pattern, candidates);
+        
+        for (size_t i=0; i<candidatesCount; i++) {
+            size_t index = first + candidates[i];
+            KSOTokenFuzzyMatchResult match;
+            
+            if (KSOTokenFuzzyMatch(&pattern, corpus->foldedCharacters + corpus->offsets[index], corpus->offsets[index + 1] - corpus->offsets[index] - 1, corpus->masks[index], NULL, &match)) {
+                KSOTokenBoundedHeapInsertScore(&heap, match.score, index);
+            }
+        }
+    }
+    
+    KSOTokenBoundedHeapSort(&heap);
+    
+    size_t retval = heap.count;
+    
+    KSOTokenBoundedHeapDestroy(&heap);
+    
+    return retval;
+}
+
+// what -[KSOTokenCompletionIndex initWithStrings:] does when the strings are read from a text file, through to the first completion
+static void KSOTokenBenchmarkColdStartText(KSOTokenBenchmarkContext *context, const char *path, uint16_t query) {
+    const char *name = "cold_start/text";
+    
+    if (!KSOTokenBenchmarkShouldRun(context, name)) {
+        return;
+    }
+    
+    size_t batchSize = 4096;
+    uint32_t *candidates = malloc(sizeof(uint32_t) * batchSize);
+    size_t iterations = context->iterations < 5 ? context->iterations : 5;
+    KSOTokenBenchmarkResult result;
+    
+    KSOTokenBenchmarkBegin(&result, name, iterations, 1, "ops", 1.0);
+    
+    result.measuresResidentBytes = true;
+    
+    for (size_t i=0; i<iterations; i++) {
+        uint64_t resident = KSOTokenBenchmarkResidentBytes();
+        uint64_t start = KSOTokenBenchmarkNow();
+        KSOTokenBenchmarkCorpus text;
+        
+        if (!KSOTokenBenchmarkCorpusLoad(&text, path)) {
+            break;
+        }
+        
+        KSOTokenCorpus corpus = {.characters = text.characters, .charactersLength = text.length, .offsets = text.offsets, .count = text.count};
+        
+        KSOTokenCorpusCreateSections(&corpus);
+        
+        KSOTokenBenchmarkSink = KSOTokenBenchmarkFirstCompletion(&corpus, query, candidates, batchSize);
+        
+        result.samples[result.samplesCount++] = KSOTokenBenchmarkNow() - start;
+        
+        // everything the index holds on to is still allocated at this point
+        uint64_t residentAfter = KSOTokenBenchmarkResidentBytes();
+        
+        if (residentAfter > resident &&
+            residentAfter - resident > result.residentBytes) {
+            
+            result.residentBytes = residentAfter - resident;
+        }
+        
+        KSOTokenCorpusDestroySections(&corpus);
+        free(text.offsets);
+        free(text.characters);
+    }
+    
+    if (result.samplesCount > 0) {
+        KSOTokenBenchmarkEnd(context, &result);
+    }
+    else {
+        free(result.samples);
+    }
+    
+    free(candidates);
+}
+
+// what -[KSOTokenCompletionIndex initWithContentsOfCorpusURL:] does, through to the first completion. The corpus file was just written, so like an installed app its pages are in the page cache and mapping them does not read the disk.
+static void KSOTokenBenchmarkColdStartCorpus(KSOTokenBenchmarkContext *context, const KSOTokenBenchmarkCorpus *text, uint16_t query) {
+    const char *name = "cold_start/corpus";
+    
+    if (!KSOTokenBenchmarkShouldRun(context, name)) {
+        return;
+    }
+    
+    KSOTokenCorpus corpus = {.characters = text->characters, .charactersLength = text->length, .offsets = text->offsets, .count = text->count};
+    
+    if (!KSOTokenCorpusCreateSections(&corpus)) {
+        return;
+    }
+    
+    size_t length = KSOTokenCorpusWriteLength(&corpus);
+    uint8_t *bytes = malloc(length);
+    FILE *file = tmpfile();
+    
+    KSOTokenCorpusWrite(&corpus, bytes);
+    KSOTokenCorpusDestroySections(&corpus);
+    
+    if (file == NULL ||
+        fwrite(bytes, 1, length, file) != length ||
+        fflush(file) != 0) {
+        
+        if (file != NULL) {
+            fclose(file);
+        }
+        free(bytes);
+        return;
+    }
+    
+    free(bytes);
+    
+    size_t batchSize = 4096;
+    uint32_t *candidates = malloc(sizeof(uint32_t) * batchSize);
+    size_t iterations = context->iterations < 100 ? context->iterations : 100;
+    KSOTokenBenchmarkResult result;
+    
+    KSOTokenBenchmarkBegin(&result, name, iterations, 1, "ops", 1.0);
+    
+    result.measuresResidentBytes = true;
+    
+    for (size_t i=0; i<iterations; i++) {
+        uint64_t resident = KSOTokenBenchmarkResidentBytes();
+        uint64_t start = KSOTokenBenchmarkNow();
+        void *mapping = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fileno(file), 0);
+        
+        if (mapping == MAP_FAILED) {
+            break;
+        }
+        if (!KSOTokenCorpusOpen(&corpus, mapping, length)) {
+            munmap(mapping, length);
+            break;
+        }
+        
+        KSOTokenBenchmarkSink = KSOTokenBenchmarkFirstCompletion(&corpus, query, candidates, batchSize);
+        
+        result.samples[result.samplesCount++] = KSOTokenBenchmarkNow() - start;
+        
+        // only the pages the first completion touched are resident
+        uint64_t residentAfter = KSOTokenBenchmarkResidentBytes();
+        
+        if (residentAfter > resident &&
+            residentAfter - resident > result.residentBytes) {
+            
+            result.residentBytes = residentAfter - resident;
+        }
+        
+        munmap(mapping, length);
+    }
+    
+    if (result.samplesCount > 0) {
+        KSOTokenBenchmarkEnd(context, &result);
+    }
+    else {
+        free(result.samples);
+    }
+    
+    free(candidates);
+    fclose(file);
+}
+
+// what -[KSOTokenTextView restoreSnapshotData:] reads before it creates any attachments
+static void KSOTokenBenchmarkSnapshotRead(KSOTokenBenchmarkContext *context, const KSOTokenBenchmarkCorpus *corpus, size_t tokenCount) {
+    char name[64];
+    
+    snprintf(name, sizeof(name), "snapshot_read/%zu", tokenCount);
+    
+    if (!KSOTokenBenchmarkShouldRun(context, name)) {
+        return;
+    }
+    
+    KSOTokenBenchmarkRandom random = {.state = 0x736E6170ULL ^ tokenCount};
+    KSOTokenSnapshotWriter writer;
+    KSOTokenSnapshotHeader header = {(const uint8_t *)".SFUI-Regular", 13, 17.0f, tokenCount};
+    char text[256];
+    
+    KSOTokenSnapshotWriterInit(&writer, tokenCount * 32);
+    KSOTokenSnapshotWriteHeader(&writer, &header);
+    
+    for (size_t i=0; i<tokenCount; i++) {
+        size_t index = KSOTokenBenchmarkRandomUniform(&random, corpus->count);
+        size_t length = KSOTokenBenchmarkCorpusEntryLength(corpus, index);
+        
+        length = length < sizeof(text) ? length : sizeof(text);
+        
+        // the corpus is ASCII, so each code unit is a single UTF-8 byte
+        for (size_t j=0; j<length; j++) {
+            text[j] = (char)corpus->characters[corpus->offsets[index] + j];
+        }
+        
+        KSOTokenSnapshotRecord record = {KSOTokenSnapshotRecordKindString, (const uint8_t *)text, length, 8.0f * length + 16.0f, 22.0f, NULL, 0};
+        
+        KSOTokenSnapshotWriteRecord(&writer, &record);
+    }
+    
+    KSOTokenBenchmarkResult result;
+    size_t iterations = context->iterations * 100 / tokenCount;
+    
+    iterations = iterations > 3 ? iterations : 3;
+    
+    KSOTokenBenchmarkBegin(&result, name, iterations, 1, "tokens", (double)tokenCount);
+    
+    for (size_t i=0; i<iterations; i++) {
+        uint64_t start = KSOTokenBenchmarkNow();
+        KSOTokenSnapshotReader reader;
+        KSOTokenSnapshotRecord record;
+        size_t bytes = 0;
+        
+        KSOTokenSnapshotReaderInit(&reader, writer.bytes, writer.length);
+        KSOTokenSnapshotReadHeader(&reader, &header);
+        
+        for (size_t j=0; j<header.count && KSOTokenSnapshotReadRecord(&reader, &record); j++) {
+            bytes += record.textLength;
+        }
+        
+        result.samples[result.samplesCount++] = KSOTokenBenchmarkNow() - start;
+        
+        KSOTokenBenchmarkSink = bytes;
+    }
+    
+    KSOTokenBenchmarkEnd(context, &result);
+    KSOTokenSnapshotWriterDestroy(&writer);
+}
+
+// Main
+
+static void KSOTokenBenchmarkUsage(const char *program) {
+    fprintf(stderr, "usage: %s [--words path] [--iterations count] [--filter substring]\n", program);
+}
+
+int main(int argc, char *argv[]) {
+    const char *wordsPath = "../Demo/words.txt";
+    KSOTokenBenchmarkContext context = {.filter = NULL, .iterations = 1000, .output = stdout, .first = true};
+    
+    for (int i=1; i<argc; i++) {
+        if (strcmp(argv[i], "--words") == 0 && i + 1 < argc) {
+            wordsPath = argv[++i];
+        }
+        else if (strcmp(argv[i], "--iterations") == 0 && i + 1 < argc) {
+            context.iterations = strtoul(argv[++i], NULL, 10);
+        }
+        else if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+            context.filter = argv[++i];
+        }
+        else {
+            KSOTokenBenchmarkUsage(argv[0]);
+            return 1;
+        }
+    }
+    
+    if (context.iterations == 0) {
+        KSOTokenBenchmarkUsage(argv[0]);
+        return 1;
+    }
+    
+    KSOTokenBenchmarkCorpus corpus;
+    
+    if (!KSOTokenBenchmarkCorpusLoad(&corpus, wordsPath)) {
+        fprintf(stderr, "unable to read %s\n", wordsPath);
+        return 1;
+    }
+    
+    corpus.foldedCharacters = malloc(sizeof(uint16_t) * (corpus.length + 1));
+    
+    KSOTokenFoldCharacters(corpus.characters, corpus.foldedCharacters, corpus.length);
+    
+    // the default tokenizing character set of KSOTokenTextView, newlines and comma
+    static KSOTokenDelimiterSet delimiters;
+    static KSOTokenDelimiterSet whitespace;
+    
+    KSOTokenDelimiterSetInit(&delimiters, NULL, 0);
+    KSOTokenDelimiterSetInit(&whitespace, NULL, 0);
+    
+    const uint16_t delimiterCharacters[] = {'\n', '\r', 0x0B, 0x0C, 0x85, 0x2028, 0x2029, ','};
+    const uint16_t whitespaceCharacters[] = {' ', '\t', '\n', '\r', 0x0B, 0x0C, 0x85, 0xA0, 0x2028, 0x2029};
+    
+    for (size_t i=0; i<sizeof(delimiterCharacters) / sizeof(delimiterCharacters[0]); i++) {
+        delimiters.bits[delimiterCharacters[i] >> 3] |= 1 << (delimiterCharacters[i] & 7);
+    }
+    for (size_t i=0; i<sizeof(whitespaceCharacters) / sizeof(whitespaceCharacters[0]); i++) {
+        whitespace.bits[whitespaceCharacters[i] >> 3] |= 1 << (whitespaceCharacters[i] & 7);
+    }
+    
+    size_t suffixesCount;
+    uint32_t *suffixes = KSOTokenSuffixArrayCreate(corpus.foldedCharacters, corpus.length, &suffixesCount);
+    uint64_t *masks = malloc(sizeof(uint64_t) * corpus.count);
+    uint32_t *prefixes = malloc(sizeof(uint32_t) * corpus.count);
+    size_t prefixesCount = 0;
+    
+    // the suffixes that begin an entry, in suffix order
+    for (size_t i=0; i<suffixesCount; i++) {
+        if (suffixes[i] == 0 ||
+            corpus.foldedCharacters[suffixes[i] - 1] == 0) {
+            
+            prefixes[prefixesCount++] = suffixes[i];
+        }
+    }
+    
+    for (size_t i=0; i<corpus.count; i++) {
+        masks[i] = KSOTokenFuzzyCharactersMask(corpus.foldedCharacters + corpus.offsets[i], KSOTokenBenchmarkCorpusEntryLength(&corpus, i));
+    }
+    
+    fprintf(context.output, "{\n  \"corpus\": {\"path\": \"%s\", \"entries\": %zu},\n  \"iterations\": %zu,\n  \"benchmarks\": [", wordsPath, corpus.count, context.iterations);
+    
+    const size_t fieldLengths[] = {1000, 10000, 100000};
+    const size_t payloadLengths[] = {64 * 1024, 1024 * 1024};
+    const size_t queryLengths[] = {1, 2, 4};
+    const size_t tokenCounts[] = {100, 1000, 10000};
+    
+    for (size_t i=0; i<sizeof(fieldLengths) / sizeof(fieldLengths[0]); i++) {
+        KSOTokenBenchmarkTokenRange(&context, &corpus, &delimiters, fieldLengths[i]);
+    }
+    for (size_t i=0; i<sizeof(payloadLengths) / sizeof(payloadLengths[0]); i++) {
+        KSOTokenBenchmarkPasteSplit(&context, &corpus, &delimiters, &whitespace, payloadLengths[i]);
+    }
+    
+    KSOTokenBenchmarkIndexBuild(&context, &corpus);
+    
+    // both cold starts answer the same single character query, the first character of a fixed entry
+    KSOTokenBenchmarkRandom random = {.state = 0x636F6C64ULL};
+    uint16_t coldStartQuery = corpus.foldedCharacters[corpus.offsets[KSOTokenBenchmarkRandomUniform(&random, corpus.count)]];
+    
+    KSOTokenBenchmarkColdStartText(&context, wordsPath, coldStartQuery);
+    KSOTokenBenchmarkColdStartCorpus(&context, &corpus, coldStartQuery);
+    
+    for (size_t i=0; i<sizeof(queryLengths) / sizeof(queryLengths[0]); i++) {
+        KSOTokenBenchmarkSubstringQuery(&context, &corpus, suffixes, suffixesCount, prefixes, prefixesCount, queryLengths[i]);
+    }
+    for (size_t i=0; i<=2; i++) {
+        KSOTokenBenchmarkFuzzyQuery(&context, &corpus, masks, i);
+    }
+    for (size_t i=0; i<sizeof(tokenCounts) / sizeof(tokenCounts[0]); i++) {
+        KSOTokenBenchmarkSnapshotRead(&context, &corpus, tokenCounts[i]);
+    }
+    
+    fprintf(context.output, "\n  ]\n}\n");
+    
+    free(prefixes);
+    free(masks);
+    free(suffixes);
+    free(corpus.offsets);
+    free(corpus.foldedCharacters);
+    free(corpus.characters);
+    
+    return 0;
+}
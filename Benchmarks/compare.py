@@ -0,0 +1,49 @@
+#!/usr/bin/env python3
+# Prints the change in latency, throughput and allocations of each benchmark between two results files
+# written by KSOTokenBenchmark or the Demo benchmark runner.
+#
+#   python3 compare.py baseline.json current.json
+
+import json
+import sys
+
+
+def load(path):
+    with open(path) as file:
+        return {benchmark['name']: benchmark for benchmark in json.load(file)['benchmarks']}
+
+
+def change(old, new):
+    return '%+.1f%%' % ((new - old) / old * 100.0) if old else 'n/a'
+
+
+def allocations(benchmark):
+    # KSOTokenBenchmark counts allocations, the Demo benchmark runner measures the change in heap blocks
+    return benchmark['allocations'] if 'allocations' in benchmark else benchmark['heap_blocks_delta']
+
+
+def main(arguments):
+    if len(arguments) != 3:
+        sys.exit('usage: compare.py baseline.json current.json')
+
+    baseline, current = load(arguments[1]), load(arguments[2])
+
+    print('%-24s %14s %9s %9s %11s %12s' % ('benchmark', 'p50 ns', 'p50', 'p99', 'throughput', 'allocations'))
+
+    for name, new in current.items():
+        old = baseline.get(name)
+
+        if old is None:
+            print('%-24s %14.1f %9s %9s %11s %12s' % (name, new['latency_ns']['p50'], 'new', 'new', 'new', 'new'))
+            continue
+
+        print('%-24s %14.1f %9s %9s %11s %12s' % (name,
+                                                  new['latency_ns']['p50'],
+                                                  change(old['latency_ns']['p50'], new['latency_ns']['p50']),
+                                                  change(old['latency_ns']['p99'], new['latency_ns']['p99']),
+                                                  change(old['throughput'], new['throughput']),
+                                                  change(allocations(old), allocations(new))))
+
+
+if __name__ == '__main__':
+    main(sys.argv)
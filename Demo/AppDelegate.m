@@ -20,6 +20,7 @@
 #import "AppDelegate.h"
 #import "ViewController.h"
 #import "CustomViewController.h"
+#import "BenchmarkRunner.h"
 
 @interface AppDelegate ()
 
@@ -31,6 +32,18 @@
 - (BOOL)application:(UIApplication *)application didFinishLaunchingWithOptions:(NSDictionary *)launchOptions {
     [self setWindow:[[UIWindow alloc] initWithFrame:UIScreen.mainScreen.bounds]];
     
+    if (BenchmarkRunner.shouldRunBenchmarks) {
+        [self.window setRootViewController:[[UIViewController alloc] init]];
+        [self.window makeKeyAndVisible];
+        
+        // let launch finish first, the paste benchmarks spin the main run loop
+        dispatch_async(dispatch_get_main_queue(), ^{
+            [[[BenchmarkRunner alloc] init] runBenchmarksAndExit];
+        });
+        
+        return YES;
+    }
+    
     UITabBarController *controller = [[UITabBarController alloc] init];
     
     [controller setViewControllers:@[[[UINavigationController alloc] initWithRootViewController:[[ViewController alloc] init]],
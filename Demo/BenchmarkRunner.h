@@ -0,0 +1,51 @@
+//
+//  BenchmarkRunner.h
+//  Demo
+//
+//  Created by William Towe on 10/17/26.
+//  Copyright © 2021 Kosoku Interactive, LLC. All rights reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ BenchmarkRunner drives KSOTokenTextView and KSOTokenCompletionIndex headlessly with fixed seed workloads and reports latency percentiles, heap growth and throughput as JSON, in the same format as Benchmarks/KSOTokenBenchmark so results can be compared with Benchmarks/compare.py.
+ 
+ Launch the demo with the -KSOTokenBenchmark YES argument to run the benchmarks instead of the demo, for example:
+ 
+ xcrun simctl launch --console booted com.kosoku.Demo -KSOTokenBenchmark YES
+ */
+@interface BenchmarkRunner : NSObject
+
+/**
+ Get whether the app was launched to run the benchmarks.
+ */
+@property (class,readonly,nonatomic) BOOL shouldRunBenchmarks;
+
+/**
+ Runs every benchmark on the main thread and returns the JSON results.
+ 
+ @return The JSON results
+ */
+- (NSData *)runBenchmarks;
+/**
+ Calls runBenchmarks, writes the results to stdout and to benchmark.json in the documents directory, then exits the app.
+ */
+- (void)runBenchmarksAndExit;
+
+@end
+
+NS_ASSUME_NONNULL_END
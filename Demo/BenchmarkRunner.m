@@ -0,0 +1,442 @@
+//
+//  BenchmarkRunner.m
+//  Demo
+//
+//  Created by William Towe on 10/17/26.
+//  Copyright © 2021 Kosoku Interactive, LLC. All rights reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+#import "BenchmarkRunner.h"
+
+#import <KSOToken/KSOToken.h>
+#import <QuartzCore/QuartzCore.h>
+
+#import <malloc/malloc.h>
+#import <mach/mach.h>
+
+// hot paths of KSOTokenTextView that are not public
+@interface KSOTokenTextView (BenchmarkRunnerPrivate)
+- (NSRange)_tokenRangeForRange:(NSRange)range;
+- (NSUInteger)_indexOfTokenTextAttachmentInRange:(NSRange)range textAttachment:(id<KSOTokenTextAttachment> *)textAttachment;
+- (void)_pasteStrings:(NSArray<NSString *> *)strings range:(NSRange)range;
+@end
+
+// keeps the compiler from discarding results that are otherwise unused
+static volatile NSUInteger kBenchmarkRunnerSink;
+
+@interface BenchmarkRunner ()
+@property (copy,nonatomic) NSArray<NSString *> *words;
+@property (assign,nonatomic) uint64_t randomState;
+@property (strong,nonatomic) NSMutableArray<NSDictionary *> *results;
+
+- (void)_benchmarkTokenRangeWithFieldLength:(NSUInteger)fieldLength;
+- (void)_benchmarkIndexOfTokenWithTokenCount:(NSUInteger)tokenCount;
+- (void)_benchmarkSetRepresentedObjectsWithTokenCount:(NSUInteger)tokenCount;
+- (void)_benchmarkRestoreSnapshotWithTokenCount:(NSUInteger)tokenCount;
+- (void)_benchmarkRenderTokensWithTokenCount:(NSUInteger)tokenCount;
+- (void)_benchmarkPasteWithTokenCount:(NSUInteger)tokenCount;
+- (void)_benchmarkCompletionIndex;
+- (void)_benchmarkColdStart;
+
+- (void)_benchmarkWithName:(NSString *)name iterations:(NSUInteger)iterations batch:(NSUInteger)batch unit:(NSString *)unit unitsPerOperation:(double)unitsPerOperation setupBlock:(dispatch_block_t)setupBlock block:(dispatch_block_t)block;
+- (void)_seedWithName:(NSString *)name;
+- (NSUInteger)_randomIndexLessThan:(NSUInteger)upperBound;
+- (NSArray<NSString *> *)_randomWordsWithCount:(NSUInteger)count minimumLength:(NSUInteger)minimumLength;
+- (NSString *)_fieldTextWithLength:(NSUInteger)length;
+- (KSOTokenTextView *)_createTextView;
+
++ (NSUInteger)_defaultIterations;
++ (uint64_t)_residentBytes;
+@end
+
+@implementation BenchmarkRunner
+
+- (instancetype)init {
+    if (!(self = [super init]))
+        return nil;
+    
+    NSData *data = [NSData dataWithContentsOfURL:[[NSBundle mainBundle] URLForResource:@"words" withExtension:@"txt"] options:NSDataReadingMappedIfSafe error:NULL];
+    NSString *text = [[NSString alloc] initWithData:data encoding:NSUTF8StringEncoding];
+    
+    _words = [[text componentsSeparatedByCharactersInSet:NSCharacterSet.newlineCharacterSet] filteredArrayUsingPredicate:[NSPredicate predicateWithFormat:@"length > 0"]];
+    _results = [[NSMutableArray alloc] init];
+    
+    return self;
+}
+
++ (BOOL)shouldRunBenchmarks {
+    return [NSUserDefaults.standardUserDefaults boolForKey:@"KSOTokenBenchmark"];
+}
+
+- (NSData *)runBenchmarks {
+    [self.results removeAllObjects];
+    
+    for (NSNumber *length in @[@1000, @10000, @100000]) {
+        [self _benchmarkTokenRangeWithFieldLength:length.unsignedIntegerValue];
+    }
+    for (NSNumber *count in @[@10, @100, @1000]) {
+        [self _benchmarkIndexOfTokenWithTokenCount:count.unsignedIntegerValue];
+    }
+    for (NSNumber *count in @[@10, @100, @1000, @10000]) {
+        [self _benchmarkSetRepresentedObjectsWithTokenCount:count.unsignedIntegerValue];
+        [self _benchmarkRestoreSnapshotWithTokenCount:count.unsignedIntegerValue];
+    }
+    for (NSNumber *count in @[@10, @100]) {
+        [self _benchmarkRenderTokensWithTokenCount:count.unsignedIntegerValue];
+    }
+    for (NSNumber *count in @[@1000, @10000]) {
+        [self _benchmarkPasteWithTokenCount:count.unsignedIntegerValue];
+    }
+    
+    [self _benchmarkCompletionIndex];
+    [self _benchmarkColdStart];
+    
+    NSDictionary *JSON = @{@"corpus": @{@"path": @"words.txt", @"entries": @(self.words.count)},
+                           @"iterations": @([self.class _defaultIterations]),
+                           @"benchmarks": self.results};
+    
+    return [NSJSONSerialization dataWithJSONObject:JSON options:NSJSONWritingPrettyPrinted error:NULL];
+}
+- (void)runBenchmarksAndExit {
+    NSData *data = [self runBenchmarks];
+    NSURL *URL = [[NSFileManager.defaultManager URLsForDirectory:NSDocumentDirectory inDomains:NSUserDomainMask].firstObject URLByAppendingPathComponent:@"benchmark.json"];
+    
+    [data writeToURL:URL atomically:YES];
+    
+    fwrite(data.bytes, 1, data.length, stdout);
+    fputc('\n', stdout);
+    fflush(stdout);
+    
+    exit(EXIT_SUCCESS);
+}
+
+- (void)_benchmarkTokenRangeWithFieldLength:(NSUInteger)fieldLength; {
+    NSString *name = [NSString stringWithFormat:@"token_range/%lu",(unsigned long)fieldLength];
+    KSOTokenTextView *textView = [self _createTextView];
+    
+    [self _seedWithName:name];
+    [textView setText:[self _fieldTextWithLength:fieldLength]];
+    
+    NSUInteger length = textView.textStorage.length;
+    
+    [self _benchmarkWithName:name iterations:[self.class _defaultIterations] batch:100 unit:@"ops" unitsPerOperation:1.0 setupBlock:nil block:^{
+        kBenchmarkRunnerSink = [textView _tokenRangeForRange:NSMakeRange([self _randomIndexLessThan:length + 1], 0)].length;
+    }];
+}
+- (void)_benchmarkIndexOfTokenWithTokenCount:(NSUInteger)tokenCount; {
+    NSString *name = [NSString stringWithFormat:@"index_of_token/%lu",(unsigned long)tokenCount];
+    KSOTokenTextView *textView = [self _createTextView];
+    
+    [self _seedWithName:name];
+    [textView setRepresentedObjects:[self _randomWordsWithCount:tokenCount minimumLength:1]];
+    
+    NSUInteger length = textView.textStorage.length;
+    
+    [self _benchmarkWithName:name iterations:[self.class _defaultIterations] batch:100 unit:@"ops" unitsPerOperation:1.0 setupBlock:nil block:^{
+        kBenchmarkRunnerSink = [textView _indexOfTokenTextAttachmentInRange:NSMakeRange([self _randomIndexLessThan:length + 1], 0) textAttachment:NULL];
+    }];
+}
+- (void)_benchmarkSetRepresentedObjectsWithTokenCount:(NSUInteger)tokenCount; {
+    NSString *name = [NSString stringWithFormat:@"set_represented_objects/%lu",(unsigned long)tokenCount];
+    KSOTokenTextView *textView = [self _createTextView];
+    
+    [self _seedWithName:name];
+    
+    NSArray *representedObjects = [self _randomWordsWithCount:tokenCount minimumLength:1];
+    
+    // includes laying out the tokens, which is where their sizes are computed
+    [self _benchmarkWithName:name iterations:MAX(3, [self.class _defaultIterations] / tokenCount) batch:1 unit:@"tokens" unitsPerOperation:tokenCount setupBlock:^{
+        [textView setRepresentedObjects:nil];
+    } block:^{
+        [textView setRepresentedObjects:representedObjects];
+        [textView.layoutManager ensureLayoutForTextContainer:textView.textContainer];
+    }];
+}
+- (void)_benchmarkRestoreSnapshotWithTokenCount:(NSUInteger)tokenCount; {
+    NSString *name = [NSString stringWithFormat:@"restore_snapshot/%lu",(unsigned long)tokenCount];
+    KSOTokenTextView *textView = [self _createTextView];
+    
+    // the same seed as set_represented_objects, so the two are directly comparable
+    [self _seedWithName:[NSString stringWithFormat:@"set_represented_objects/%lu",(unsigned long)tokenCount]];
+    [textView setRepresentedObjects:[self _randomWordsWithCount:tokenCount minimumLength:1]];
+    
+    NSData *snapshotData = [textView snapshotData];
+    
+    [self _benchmarkWithName:name iterations:MAX(3, [self.class _defaultIterations] / tokenCount) batch:1 unit:@"tokens" unitsPerOperation:tokenCount setupBlock:^{
+        [textView setRepresentedObjects:nil];
+    } block:^{
+        [textView restoreSnapshotData:snapshotData];
+        [textView.layoutManager ensureLayoutForTextContainer:textView.textContainer];
+    }];
+}
+- (void)_benchmarkRenderTokensWithTokenCount:(NSUInteger)tokenCount; {
+    NSString *name = [NSString stringWithFormat:@"render_tokens/%lu",(unsigned long)tokenCount];
+    KSOTokenTextView *textView = [self _createTextView];
+    
+    [self _seedWithName:name];
+    [textView setRepresentedObjects:[self _randomWordsWithCount:tokenCount minimumLength:1]];
+    [textView setFrame:CGRectMake(0.0, 0.0, 375.0, [textView sizeThatFits:CGSizeMake(375.0, CGFLOAT_MAX)].height)];
+    [textView layoutIfNeeded];
+    
+    UIGraphicsImageRenderer *renderer = [[UIGraphicsImageRenderer alloc] initWithBounds:textView.bounds];
+    
+    [self _benchmarkWithName:name iterations:MAX(10, [self.class _defaultIterations] / 10) batch:1 unit:@"tokens" unitsPerOperation:tokenCount setupBlock:nil block:^{
+        kBenchmarkRunnerSink = (NSUInteger)[renderer imageWithActions:^(UIGraphicsImageRendererContext * _Nonnull rendererContext) {
+            [textView.layer renderInContext:rendererContext.CGContext];
+        }].size.height;
+    }];
+}
+- (void)_benchmarkPasteWithTokenCount:(NSUInteger)tokenCount; {
+    NSString *name = [NSString stringWithFormat:@"paste/%lu",(unsigned long)tokenCount];
+    KSOTokenTextView *textView = [self _createTextView];
+    
+    [self _seedWithName:name];
+    
+    NSString *payload = [[self _randomWordsWithCount:tokenCount minimumLength:1] componentsJoinedByString:@", "];
+    
+    // the paste pipeline splits on a background queue and inserts on later turns of the run loop, so spin it until the paste finishes
+    [self _benchmarkWithName:name iterations:MAX(3, [self.class _defaultIterations] / tokenCount * 10) batch:1 unit:@"tokens" unitsPerOperation:tokenCount setupBlock:^{
+        [textView setRepresentedObjects:nil];
+    } block:^{
+        [textView _pasteStrings:@[payload] range:NSMakeRange(textView.textStorage.length, 0)];
+        
+        while (textView.pasteProgress != nil) {
+            [NSRunLoop.currentRunLoop runMode:NSDefaultRunLoopMode beforeDate:NSDate.distantFuture];
+        }
+    }];
+}
+- (void)_benchmarkCompletionIndex; {
+    __block KSOTokenCompletionIndex *index = nil;
+    NSArray *words = self.words;
+    NSUInteger iterations = [self.class _defaultIterations];
+    
+    [self _benchmarkWithName:@"index_build" iterations:3 batch:1 unit:@"entries" unitsPerOperation:words.count setupBlock:^{
+        index = nil;
+    } block:^{
+        index = [[KSOTokenCompletionIndex alloc] initWithStrings:words];
+    }];
+    
+    for (NSNumber *length in @[@1, @2, @4]) {
+        NSString *name = [NSString stringWithFormat:@"substring_query/%@",length];
+        __block NSArray<NSString *> *queries;
+        __block NSUInteger queryIndex = 0;
+        
+        [self _seedWithName:name];
+        
+        // queries are substrings of random words, so every query has at least one match
+        queries = [[self _randomWordsWithCount:iterations minimumLength:length.unsignedIntegerValue] valueForKey:@"lowercaseString"];
+        
+        [self _benchmarkWithName:name iterations:iterations batch:1 unit:@"ops" unitsPerOperation:1.0 setupBlock:nil block:^{
+            NSString *word = queries[queryIndex++];
+            NSString *query = [word substringWithRange:NSMakeRange([self _randomIndexLessThan:word.length - length.unsignedIntegerValue + 1], length.unsignedIntegerValue)];
+            
+            kBenchmarkRunnerSink = [index completionResultsForSubstring:query offset:0 limit:100 scoringBlock:nil].completionModels.count;
+        }];
+    }
+    
+    for (NSNumber *maximumDistance in @[@0, @1, @2]) {
+        NSString *name = [NSString stringWithFormat:@"fuzzy_query/%@",maximumDistance];
+        NSUInteger fuzzyIterations = MIN(iterations, 100);
+        __block NSArray<NSString *> *queries;
+        __block NSUInteger queryIndex = 0;
+        
+        [self _seedWithName:name];
+        
+        queries = [self _randomWordsWithCount:fuzzyIterations minimumLength:4];
+        
+        [self _benchmarkWithName:name iterations:fuzzyIterations batch:1 unit:@"entries" unitsPerOperation:words.count setupBlock:nil block:^{
+            // the first 4 to 8 characters of a random word, with two adjacent characters transposed when typos are allowed
+            NSString *word = queries[queryIndex++];
+            NSMutableString *query = [[word substringToIndex:4 + [self _randomIndexLessThan:MIN(word.length, 8) - 3]] mutableCopy];
+            
+            if (maximumDistance.unsignedIntegerValue > 0) {
+                NSUInteger position = [self _randomIndexLessThan:query.length - 1];
+                NSString *character = [query substringWithRange:NSMakeRange(position, 1)];
+                
+                [query deleteCharactersInRange:NSMakeRange(position, 1)];
+                [query insertString:character atIndex:position + 1];
+            }
+            
+            kBenchmarkRunnerSink = [index completionResultsForFuzzyString:query maximumDistance:maximumDistance.unsignedIntegerValue offset:0 limit:100 scoringBlock:nil].completionModels.count;
+        }];
+    }
+}
+
+- (void)_benchmarkColdStart; {
+    __block KSOTokenCompletionIndex *index = nil;
+    NSURL *corpusURL = [NSURL fileURLWithPath:[NSTemporaryDirectory() stringByAppendingPathComponent:@"words.corpus"]];
+    
+    // what the words demo did before corpus files, read words.txt into strings and index them, through to the first completion
+    [self _benchmarkWithName:@"cold_start/text" iterations:3 batch:1 unit:@"ops" unitsPerOperation:1.0 setupBlock:^{
+        index = nil;
+    } block:^{
+        NSData *data = [NSData dataWithContentsOfURL:[NSBundle.mainBundle URLForResource:@"words" withExtension:@"txt"] options:NSDataReadingMappedIfSafe error:NULL];
+        NSString *text = [[NSString alloc] initWithData:data encoding:NSUTF8StringEncoding];
+        
+        index = [[KSOTokenCompletionIndex alloc] initWithStrings:[text componentsSeparatedByCharactersInSet:NSCharacterSet.newlineCharacterSet]];
+        
+        kBenchmarkRunnerSink = [index completionResultsForFuzzyString:@"a" maximumDistance:1 offset:0 limit:100 scoringBlock:nil].completionModels.count;
+    }];
+    
+    [index writeCorpusToURL:corpusURL];
+    
+    // what the words demo does now, map the corpus written by the index above, through to the first completion
+    [self _benchmarkWithName:@"cold_start/corpus" iterations:MIN([self.class _defaultIterations], 100) batch:1 unit:@"ops" unitsPerOperation:1.0 setupBlock:^{
+        index = nil;
+    } block:^{
+        index = [[KSOTokenCompletionIndex alloc] initWithContentsOfCorpusURL:corpusURL];
+        
+        kBenchmarkRunnerSink = [index completionResultsForFuzzyString:@"a" maximumDistance:1 offset:0 limit:100 scoringBlock:nil].completionModels.count;
+    }];
+    
+    index = nil;
+    
+    [NSFileManager.defaultManager removeItemAtURL:corpusURL error:NULL];
+}
+
+- (void)_benchmarkWithName:(NSString *)name iterations:(NSUInteger)iterations batch:(NSUInteger)batch unit:(NSString *)unit unitsPerOperation:(double)unitsPerOperation setupBlock:(dispatch_block_t)setupBlock block:(dispatch_block_t)block; {
+    NSMutableArray<NSNumber *> *samples = [[NSMutableArray alloc] initWithCapacity:iterations];
+    double total = 0.0;
+    double heapBlocks = 0.0;
+    double heapBytes = 0.0;
+    // the largest growth of any iteration, freed heap is not always returned to the system so later iterations can grow less than the first
+    uint64_t residentBytes = 0;
+    
+    for (NSUInteger i=0; i<iterations; i++) {
+        if (setupBlock != nil) {
+            setupBlock();
+        }
+        
+        // heap growth is measured before the autorelease pool drains, so it includes temporary objects
+        @autoreleasepool {
+            malloc_statistics_t before;
+            malloc_statistics_t after;
+            
+            malloc_zone_statistics(NULL, &before);
+            
+            uint64_t residentBefore = [self.class _residentBytes];
+            CFTimeInterval start = CACurrentMediaTime();
+            
+            for (NSUInteger j=0; j<batch; j++) {
+                block();
+            }
+            
+            double sample = (CACurrentMediaTime() - start) * 1e9;
+            
+            malloc_zone_statistics(NULL, &after);
+            
+            uint64_t residentAfter = [self.class _residentBytes];
+            
+            if (residentAfter > residentBefore) {
+                residentBytes = MAX(residentBytes, residentAfter - residentBefore);
+            }
+            
+            [samples addObject:@(sample)];
+            
+            total += sample;
+            heapBlocks += (double)after.blocks_in_use - (double)before.blocks_in_use;
+            heapBytes += (double)after.size_in_use - (double)before.size_in_use;
+        }
+    }
+    
+    [samples sortUsingSelector:@selector(compare:)];
+    
+    double operations = (double)(iterations * batch);
+    double (^percentile)(double) = ^double(double value){
+        return samples[(NSUInteger)(value * (double)(samples.count - 1) + 0.5)].doubleValue / (double)batch;
+    };
+    
+    [self.results addObject:@{@"name": name,
+                              @"iterations": @(iterations),
+                              @"batch": @(batch),
+                              @"latency_ns": @{@"mean": @(total / operations),
+                                               @"p50": @(percentile(0.5)),
+                                               @"p90": @(percentile(0.9)),
+                                               @"p99": @(percentile(0.99)),
+                                               @"max": @(samples.lastObject.doubleValue / (double)batch)},
+                              @"throughput": @(total > 0.0 ? operations * unitsPerOperation * 1e9 / total : 0.0),
+                              @"throughput_unit": [unit stringByAppendingString:@"/s"],
+                              @"heap_blocks_delta": @(heapBlocks / operations),
+                              @"heap_bytes_delta": @(heapBytes / operations),
+                              @"resident_bytes": @(residentBytes)}];
+}
+- (void)_seedWithName:(NSString *)name; {
+    // each benchmark gets its own fixed seed, so adding or reordering benchmarks does not change the workload of the others
+    // FNV-1a over the UTF-8 name, NSString's hash is not guaranteed to be stable across releases
+    const char *bytes = name.UTF8String;
+    uint64_t state = 0xCBF29CE484222325ULL;
+    
+    for (size_t i=0; bytes[i] != 0; i++) {
+        state ^= (uint8_t)bytes[i];
+        state *= 0x100000001B3ULL;
+    }
+    
+    [self setRandomState:state | 1];
+}
+- (NSUInteger)_randomIndexLessThan:(NSUInteger)upperBound; {
+    // xorshift64*, matching Benchmarks/KSOTokenBenchmark.c
+    uint64_t state = self.randomState;
+    
+    state ^= state >> 12;
+    state ^= state << 25;
+    state ^= state >> 27;
+    
+    [self setRandomState:state];
+    
+    return upperBound == 0 ? 0 : (NSUInteger)((state * 0x2545F4914F6CDD1DULL) % upperBound);
+}
+- (NSArray<NSString *> *)_randomWordsWithCount:(NSUInteger)count minimumLength:(NSUInteger)minimumLength; {
+    NSMutableArray *retval = [[NSMutableArray alloc] initWithCapacity:count];
+    
+    while (retval.count < count) {
+        NSString *word = self.words[[self _randomIndexLessThan:self.words.count]];
+        
+        if (word.length >= minimumLength) {
+            [retval addObject:word];
+        }
+    }
+    
+    return retval;
+}
+- (NSString *)_fieldTextWithLength:(NSUInteger)length; {
+    NSMutableString *retval = [[NSMutableString alloc] initWithCapacity:length];
+    
+    // runs of one to eight words separated by the default tokenizing character
+    while (retval.length < length) {
+        [retval appendString:[[self _randomWordsWithCount:1 + [self _randomIndexLessThan:8] minimumLength:1] componentsJoinedByString:@" "]];
+        [retval appendString:@", "];
+    }
+    
+    return [retval substringToIndex:length];
+}
+- (KSOTokenTextView *)_createTextView; {
+    KSOTokenTextView *retval = [[KSOTokenTextView alloc] initWithFrame:CGRectMake(0.0, 0.0, 375.0, 44.0)];
+    
+    [retval setScrollEnabled:NO];
+    
+    return retval;
+}
+
++ (NSUInteger)_defaultIterations; {
+    return 1000;
+}
++ (uint64_t)_residentBytes; {
+    // resident rather than footprint, clean pages of a mapped file are resident but not part of the footprint
+    mach_task_basic_info_data_t info;
+    mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+    
+    return task_info(mach_task_self(), MACH_TASK_BASIC_INFO, (task_info_t)&info, &count) == KERN_SUCCESS ? info.resident_size : 0;
+}
+
+@end
@@ -34,12 +34,14 @@
         return nil;
     
     [self setRespondsToTintColorChanges:NO];
-    [self setTokenTextColor:tokenTextView.textColor];
-    [self setTokenBackgroundColor:tokenTextView.tintColor];
-    [self setTokenHighlightedTextColor:tokenTextView.tintColor];
-    [self setTokenHighlightedBackgroundColor:tokenTextView.textColor];
-    [self setTokenCornerRadius:3.0];
-    self.tokenEdgeInsets = UIEdgeInsetsMake(0.0, 8.0, 0.0, 8.0);
+    [self performBatchUpdates:^{
+        [self setTokenTextColor:tokenTextView.textColor];
+        [self setTokenBackgroundColor:tokenTextView.tintColor];
+        [self setTokenHighlightedTextColor:tokenTextView.tintColor];
+        [self setTokenHighlightedBackgroundColor:tokenTextView.textColor];
+        [self setTokenCornerRadius:3.0];
+        [self setTokenEdgeInsets:UIEdgeInsetsMake(0.0, 8.0, 0.0, 8.0)];
+    }];
     
     return self;
 }
@@ -48,8 +50,10 @@
 - (void)setTintColor:(UIColor *)tintColor {
     _tintColor = tintColor;
     
-    [self setTokenBackgroundColor:tintColor];
-    [self setTokenHighlightedTextColor:tintColor];
+    [self performBatchUpdates:^{
+        [self setTokenBackgroundColor:tintColor];
+        [self setTokenHighlightedTextColor:tintColor];
+    }];
 }
 
 @end
@@ -80,39 +84,13 @@
 
 @end
 
-@interface WordCompletion : NSObject <KSOTokenCompletionModel>
-@property (copy,nonatomic) NSString *word;
-@property (copy,nonatomic) NSIndexSet *indexes;
-
-- (instancetype)initWithWord:(NSString *)word indexes:(NSIndexSet *)indexes;
-@end
-
-@implementation WordCompletion
-
-- (NSString *)tokenCompletionModelTitle {
-    return self.word;
-}
-- (NSIndexSet *)tokenCompletionModelIndexes {
-    return self.indexes;
-}
-
-- (instancetype)initWithWord:(NSString *)word indexes:(NSIndexSet *)indexes {
-    if (!(self = [super init]))
-        return nil;
-    
-    _word = [word copy];
-//    _indexes = [indexes copy];
-    
-    return self;
-}
-
-@end
-
 @interface CustomViewController () <KSOTokenTextViewDelegate>
 @property (strong,nonatomic) KSOTokenTextView *textView;
 
-@property (copy,nonatomic) NSArray<NSString *> *words;
+@property (strong,nonatomic) KSOTokenCompletionIndex *wordsIndex;
 @property (strong,nonatomic) dispatch_semaphore_t wordsSemaphore;
+
++ (KSOTokenCompletionIndex *)_createWordsIndex;
 @end
 
 @implementation CustomViewController
@@ -135,6 +113,9 @@
     [self.textView setTextColor:UIColor.whiteColor];
     [self.textView setTokenTextAttachmentClass:TokenTextAttachment.class];
     [self.textView setCompletionsTableViewCellClass:CompletionTableViewCell.class];
+    [self.textView setCompletionsTableViewRowHeight:44.0];
+    [self.textView setTokenCollapsingThreshold:50];
+    [self.textView setCompletionsSchedulingMode:KSOTokenCompletionsSchedulingModeAdaptive];
     [self.textView setPlaceholder:@"Type a word then comma or return"];
     [self.textView setDelegate:self];
     [self.view addSubview:self.textView];
@@ -172,14 +153,11 @@
 - (void)tokenTextView:(KSOTokenTextView *)tokenTextView hideCompletionsTableView:(UITableView *)tableView {
     [tableView removeFromSuperview];
 }
-- (void)tokenTextView:(KSOTokenTextView *)tokenTextView completionModelsForSubstring:(NSString *)substring indexOfRepresentedObject:(NSInteger)index completion:(void (^)(NSArray<id<KSOTokenCompletionModel>> * _Nullable))completion {
+- (void)tokenTextView:(KSOTokenTextView *)tokenTextView completionModelsForSubstring:(NSString *)substring indexOfRepresentedObject:(NSInteger)index cancellationToken:(KSOTokenCompletionCancellationToken *)cancellationToken completion:(void (^)(NSArray<id<KSOTokenCompletionModel>> * _Nullable))completion {
     dispatch_async(dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0), ^{
         dispatch_async(dispatch_get_global_queue(QOS_CLASS_UTILITY, 0), ^{
-            if (self.words == nil) {
-                NSData *data = [NSData dataWithContentsOfURL:[[NSBundle mainBundle] URLForResource:@"words" withExtension:@"txt"] options:NSDataReadingMappedIfSafe error:NULL];
-                NSString *text = [[NSString alloc] initWithData:data encoding:NSUTF8StringEncoding];
-                
-                [self setWords:[text componentsSeparatedByCharactersInSet:[NSCharacterSet newlineCharacterSet]]];
+            if (self.wordsIndex == nil) {
+                [self setWordsIndex:[self.class _createWordsIndex]];
             }
             
             dispatch_semaphore_signal(self.wordsSemaphore);
@@ -187,20 +165,44 @@
         
         dispatch_semaphore_wait(self.wordsSemaphore, DISPATCH_TIME_FOREVER);
         
-        NSMutableArray *models = [[NSMutableArray alloc] init];
+        // the user kept typing while the index was loading
+        if (cancellationToken.isCancelled) {
+            return;
+        }
         
-        for (NSString *word in self.words) {
-            NSRange range = [word rangeOfString:substring options:NSCaseInsensitiveSearch];
-            
-            if (range.length == 0) {
-                continue;
-            }
-            
-            [models addObject:[[WordCompletion alloc] initWithWord:word indexes:[NSIndexSet indexSetWithIndexesInRange:range]]];
+        // fuzzy matching tolerates a typo and highlights the matching letters, a one letter query matches tens of thousands of words, only keep the best ones
+        NSArray *models = [self.wordsIndex completionResultsForFuzzyString:substring maximumDistance:1 offset:0 limit:100 scoringBlock:nil].completionModels;
+        
+        if (cancellationToken.isCancelled) {
+            return;
         }
         
         completion(models);
     });
 }
 
++ (KSOTokenCompletionIndex *)_createWordsIndex; {
+    // a corpus built by Tools/KSOTokenCorpusBuilder can be added to the bundle, otherwise words.txt is indexed on first launch and the corpus is written to caches for the launches after it
+    NSURL *bundleURL = [NSBundle.mainBundle URLForResource:@"words" withExtension:@"corpus"];
+    NSURL *cachesURL = [[NSFileManager.defaultManager URLsForDirectory:NSCachesDirectory inDomains:NSUserDomainMask].firstObject URLByAppendingPathComponent:@"words.corpus"];
+    KSOTokenCompletionIndex *retval = nil;
+    
+    if (bundleURL != nil) {
+        retval = [[KSOTokenCompletionIndex alloc] initWithContentsOfCorpusURL:bundleURL];
+    }
+    if (retval == nil) {
+        retval = [[KSOTokenCompletionIndex alloc] initWithContentsOfCorpusURL:cachesURL];
+    }
+    if (retval == nil) {
+        NSData *data = [NSData dataWithContentsOfURL:[NSBundle.mainBundle URLForResource:@"words" withExtension:@"txt"] options:NSDataReadingMappedIfSafe error:NULL];
+        NSString *text = [[NSString alloc] initWithData:data encoding:NSUTF8StringEncoding];
+        
+        retval = [[KSOTokenCompletionIndex alloc] initWithStrings:[text componentsSeparatedByCharactersInSet:NSCharacterSet.newlineCharacterSet]];
+        
+        [retval writeCorpusToURL:cachesURL];
+    }
+    
+    return retval;
+}
+
 @end
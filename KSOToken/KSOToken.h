@@ -30,3 +30,10 @@ FOUNDATION_EXPORT const unsigned char KSOTokenVersionString[];
 #import <KSOToken/KSOTokenTextView.h>
 #import <KSOToken/KSOTokenDefaultTextAttachment.h>
 #import <KSOToken/KSOTokenDefaultCompletionTableViewCell.h>
+#import <KSOToken/KSOTokenCompletionIndex.h>
+#import <KSOToken/KSOTokenFuzzyMatcher.h>
+#import <KSOToken/KSOTokenCompletionCache.h>
+#import <KSOToken/KSOTokenCompletionCancellationToken.h>
+#import <KSOToken/KSOTokenCompletionStatistics.h>
+#import <KSOToken/KSOTokenMetricsSink.h>
+#import <KSOToken/KSOTokenImageCache.h>
@@ -0,0 +1,99 @@
+//
+//  KSOTokenCompletionCache.h
+//  KSOToken
+//
+//  Created by William Towe on 10/17/26.
+//  Copyright © 2021 Kosoku Interactive, LLC. All rights reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+#import <Foundation/Foundation.h>
+#import <KSOToken/KSOTokenCompletionModel.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ KSOTokenCompletionCache is a size bounded, least recently used cache of completion models keyed by substring and represented object index. Assign an instance to the completionsCache property of KSOTokenTextView to avoid asking the delegate for completions it has already provided. All methods are thread safe.
+ */
+@interface KSOTokenCompletionCache : NSObject
+
+/**
+ Set and get the maximum number of entries retained by the receiver. When the capacity is exceeded, the least recently used entries are removed.
+ 
+ The default is 64.
+ */
+@property (assign,nonatomic) NSUInteger capacity;
+/**
+ Set and get the number of seconds an entry remains valid after it was added. A value <= 0.0 means entries do not expire.
+ 
+ The default is 0.0.
+ */
+@property (assign,nonatomic) NSTimeInterval timeToLive;
+
+/**
+ Get the number of entries currently in the receiver.
+ */
+@property (readonly,nonatomic) NSUInteger count;
+/**
+ Get the number of lookups that returned completion models.
+ */
+@property (readonly,nonatomic) NSUInteger hitCount;
+/**
+ Get the number of lookups that did not return completion models, including lookups of expired entries.
+ */
+@property (readonly,nonatomic) NSUInteger missCount;
+
+/**
+ Creates and returns a cache with the provided *capacity* and *timeToLive*.
+ 
+ @param capacity The maximum number of entries
+ @param timeToLive The number of seconds an entry remains valid
+ @return An initialized instance of the receiver
+ */
+- (instancetype)initWithCapacity:(NSUInteger)capacity timeToLive:(NSTimeInterval)timeToLive NS_DESIGNATED_INITIALIZER;
+
+/**
+ Returns the completion models for *substring* and *index*, or nil if there is no valid entry.
+ 
+ @param substring The substring the completion models were provided for
+ @param index The index of the represented object the completion models were provided for
+ @return The array of completion models or nil
+ */
+- (nullable NSArray<id<KSOTokenCompletionModel>> *)completionModelsForSubstring:(NSString *)substring index:(NSInteger)index;
+/**
+ Sets the *completionModels* for *substring* and *index*, replacing any existing entry.
+ 
+ @param completionModels The completion models to cache
+ @param substring The substring the completion models were provided for
+ @param index The index of the represented object the completion models were provided for
+ */
+- (void)setCompletionModels:(NSArray<id<KSOTokenCompletionModel>> *)completionModels forSubstring:(NSString *)substring index:(NSInteger)index;
+/**
+ Removes the entry for *substring* and *index* if there is one.
+ 
+ @param substring The substring the completion models were provided for
+ @param index The index of the represented object the completion models were provided for
+ */
+- (void)removeCompletionModelsForSubstring:(NSString *)substring index:(NSInteger)index;
+/**
+ Removes all entries. Call this whenever the source of the completion models changes.
+ */
+- (void)removeAllCompletionModels;
+/**
+ Resets hitCount and missCount to 0.
+ */
+- (void)resetStatistics;
+
+@end
+
+NS_ASSUME_NONNULL_END
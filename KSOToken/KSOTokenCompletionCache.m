@@ -0,0 +1,253 @@
+//
+//  KSOTokenCompletionCache.m
+//  KSOToken
+//
+//  Created by William Towe on 10/17/26.
+//  Copyright © 2021 Kosoku Interactive, LLC. All rights reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+#import "KSOTokenCompletionCache.h"
+
+#import <os/lock.h>
+
+@interface KSOTokenCompletionCacheEntry : NSObject
+@property (copy,nonatomic) NSString *key;
+@property (copy,nonatomic) NSArray<id<KSOTokenCompletionModel>> *completionModels;
+@property (assign,nonatomic) NSTimeInterval timestamp;
+
+// the list runs from most to least recently used, next is retained and previous is not
+@property (strong,nonatomic) KSOTokenCompletionCacheEntry *next;
+@property (unsafe_unretained,nonatomic) KSOTokenCompletionCacheEntry *previous;
+@end
+
+@implementation KSOTokenCompletionCacheEntry
+@end
+
+@interface KSOTokenCompletionCache () {
+    os_unfair_lock _lock;
+}
+@property (strong,nonatomic) NSMutableDictionary<NSString *, KSOTokenCompletionCacheEntry *> *entries;
+@property (strong,nonatomic) KSOTokenCompletionCacheEntry *head;
+@property (unsafe_unretained,nonatomic) KSOTokenCompletionCacheEntry *tail;
+
+@property (readwrite,assign,nonatomic) NSUInteger hitCount;
+@property (readwrite,assign,nonatomic) NSUInteger missCount;
+
+- (void)_removeEntry:(KSOTokenCompletionCacheEntry *)entry;
+- (void)_insertEntryAtHead:(KSOTokenCompletionCacheEntry *)entry;
+- (void)_trimToCapacity;
+
++ (NSString *)_keyForSubstring:(NSString *)substring index:(NSInteger)index;
++ (NSUInteger)_defaultCapacity;
+@end
+
+@implementation KSOTokenCompletionCache
+
+- (void)dealloc {
+    // break the chain iteratively, releasing a long list recursively could overflow the stack
+    KSOTokenCompletionCacheEntry *entry = _head;
+    
+    _head = nil;
+    
+    while (entry != nil) {
+        KSOTokenCompletionCacheEntry *next = entry.next;
+        
+        [entry setNext:nil];
+        
+        entry = next;
+    }
+}
+
+- (instancetype)init {
+    return [self initWithCapacity:[self.class _defaultCapacity] timeToLive:0.0];
+}
+
+- (instancetype)initWithCapacity:(NSUInteger)capacity timeToLive:(NSTimeInterval)timeToLive {
+    if (!(self = [super init]))
+        return nil;
+    
+    _lock = OS_UNFAIR_LOCK_INIT;
+    _capacity = capacity;
+    _timeToLive = timeToLive;
+    _entries = [[NSMutableDictionary alloc] init];
+    
+    return self;
+}
+
+- (NSArray<id<KSOTokenCompletionModel>> *)completionModelsForSubstring:(NSString *)substring index:(NSInteger)index {
+    NSString *key = [self.class _keyForSubstring:substring index:index];
+    NSArray *retval = nil;
+    
+    os_unfair_lock_lock(&_lock);
+    
+    KSOTokenCompletionCacheEntry *entry = self.entries[key];
+    
+    if (entry != nil &&
+        self.timeToLive > 0.0 &&
+        NSDate.timeIntervalSinceReferenceDate - entry.timestamp > self.timeToLive) {
+        
+        [self _removeEntry:entry];
+        entry = nil;
+    }
+    
+    if (entry == nil) {
+        self.missCount++;
+    }
+    else {
+        self.hitCount++;
+        
+        // move the entry to the front of the list
+        if (entry != self.head) {
+            [self _removeEntry:entry];
+            [self _insertEntryAtHead:entry];
+        }
+        
+        retval = entry.completionModels;
+    }
+    
+    os_unfair_lock_unlock(&_lock);
+    
+    return retval;
+}
+- (void)setCompletionModels:(NSArray<id<KSOTokenCompletionModel>> *)completionModels forSubstring:(NSString *)substring index:(NSInteger)index {
+    NSString *key = [self.class _keyForSubstring:substring index:index];
+    KSOTokenCompletionCacheEntry *entry = [[KSOTokenCompletionCacheEntry alloc] init];
+    
+    [entry setKey:key];
+    [entry setCompletionModels:completionModels];
+    [entry setTimestamp:NSDate.timeIntervalSinceReferenceDate];
+    
+    os_unfair_lock_lock(&_lock);
+    
+    KSOTokenCompletionCacheEntry *existing = self.entries[key];
+    
+    if (existing != nil) {
+        [self _removeEntry:existing];
+    }
+    
+    [self _insertEntryAtHead:entry];
+    [self _trimToCapacity];
+    
+    os_unfair_lock_unlock(&_lock);
+}
+- (void)removeCompletionModelsForSubstring:(NSString *)substring index:(NSInteger)index {
+    NSString *key = [self.class _keyForSubstring:substring index:index];
+    
+    os_unfair_lock_lock(&_lock);
+    
+    KSOTokenCompletionCacheEntry *entry = self.entries[key];
+    
+    if (entry != nil) {
+        [self _removeEntry:entry];
+    }
+    
+    os_unfair_lock_unlock(&_lock);
+}
+- (void)removeAllCompletionModels {
+    os_unfair_lock_lock(&_lock);
+    
+    // break the chain iteratively, releasing a long list recursively could overflow the stack
+    while (self.head != nil) {
+        [self _removeEntry:self.head];
+    }
+    
+    os_unfair_lock_unlock(&_lock);
+}
+- (void)resetStatistics {
+    os_unfair_lock_lock(&_lock);
+    
+    [self setHitCount:0];
+    [self setMissCount:0];
+    
+    os_unfair_lock_unlock(&_lock);
+}
+
+- (void)setCapacity:(NSUInteger)capacity {
+    os_unfair_lock_lock(&_lock);
+    
+    _capacity = capacity;
+    
+    [self _trimToCapacity];
+    
+    os_unfair_lock_unlock(&_lock);
+}
+- (void)setTimeToLive:(NSTimeInterval)timeToLive {
+    os_unfair_lock_lock(&_lock);
+    
+    _timeToLive = timeToLive;
+    
+    os_unfair_lock_unlock(&_lock);
+}
+- (NSUInteger)count {
+    os_unfair_lock_lock(&_lock);
+    
+    NSUInteger retval = self.entries.count;
+    
+    os_unfair_lock_unlock(&_lock);
+    
+    return retval;
+}
+
+- (void)_removeEntry:(KSOTokenCompletionCacheEntry *)entry; {
+    KSOTokenCompletionCacheEntry *next = entry.next;
+    KSOTokenCompletionCacheEntry *previous = entry.previous;
+    
+    if (previous == nil) {
+        [self setHead:next];
+    }
+    else {
+        [previous setNext:next];
+    }
+    
+    if (next == nil) {
+        [self setTail:previous];
+    }
+    else {
+        [next setPrevious:previous];
+    }
+    
+    [entry setNext:nil];
+    [entry setPrevious:nil];
+    
+    [self.entries removeObjectForKey:entry.key];
+}
+- (void)_insertEntryAtHead:(KSOTokenCompletionCacheEntry *)entry; {
+    [entry setNext:self.head];
+    [entry setPrevious:nil];
+    
+    [self.head setPrevious:entry];
+    [self setHead:entry];
+    
+    if (self.tail == nil) {
+        [self setTail:entry];
+    }
+    
+    self.entries[entry.key] = entry;
+}
+- (void)_trimToCapacity; {
+    while (self.entries.count > self.capacity &&
+           self.tail != nil) {
+        
+        [self _removeEntry:self.tail];
+    }
+}
+
++ (NSString *)_keyForSubstring:(NSString *)substring index:(NSInteger)index; {
+    return [NSString stringWithFormat:@"%ld:%@",(long)index,substring];
+}
++ (NSUInteger)_defaultCapacity; {
+    return 64;
+}
+
+@end
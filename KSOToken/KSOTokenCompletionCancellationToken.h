@@ -0,0 +1,48 @@
+//
+//  KSOTokenCompletionCancellationToken.h
+//  KSOToken
+//
+//  Created by William Towe on 10/17/26.
+//  Copyright © 2021 Kosoku Interactive, LLC. All rights reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ KSOTokenCompletionCancellationToken is handed to completion providers so they can stop working on a query that has been superseded, for example by the next keystroke. Providers can poll isCancelled from inside their search loop, which is a single atomic load, or register a block to be notified. All methods are thread safe.
+ */
+@interface KSOTokenCompletionCancellationToken : NSObject
+
+/**
+ Get whether the receiver has been cancelled.
+ */
+@property (readonly,nonatomic,getter=isCancelled) BOOL cancelled;
+
+/**
+ Adds a block that is invoked once when the receiver is cancelled. If the receiver is already cancelled, the block is invoked immediately. The block is invoked on the thread that cancels the receiver, which is usually the main thread.
+ 
+ @param block The block to invoke
+ */
+- (void)addCancellationBlock:(dispatch_block_t)block;
+
+/**
+ Cancels the receiver and invokes any registered cancellation blocks. This is called by KSOTokenTextView, providers should not need to call it.
+ */
+- (void)cancel;
+
+@end
+
+NS_ASSUME_NONNULL_END
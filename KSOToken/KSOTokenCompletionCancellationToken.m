@@ -0,0 +1,88 @@
+//
+//  KSOTokenCompletionCancellationToken.m
+//  KSOToken
+//
+//  Created by William Towe on 10/17/26.
+//  Copyright © 2021 Kosoku Interactive, LLC. All rights reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+#import "KSOTokenCompletionCancellationToken.h"
+
+#import <stdatomic.h>
+#import <os/lock.h>
+
+@interface KSOTokenCompletionCancellationToken () {
+    atomic_bool _cancelled;
+    os_unfair_lock _lock;
+}
+@property (strong,nonatomic) NSMutableArray<dispatch_block_t> *cancellationBlocks;
+@end
+
+@implementation KSOTokenCompletionCancellationToken
+
+- (instancetype)init {
+    if (!(self = [super init]))
+        return nil;
+    
+    atomic_init(&_cancelled, false);
+    _lock = OS_UNFAIR_LOCK_INIT;
+    
+    return self;
+}
+
+- (void)addCancellationBlock:(dispatch_block_t)block {
+    os_unfair_lock_lock(&_lock);
+    
+    if (!self.isCancelled) {
+        if (self.cancellationBlocks == nil) {
+            [self setCancellationBlocks:[[NSMutableArray alloc] init]];
+        }
+        
+        [self.cancellationBlocks addObject:[block copy]];
+        
+        block = nil;
+    }
+    
+    os_unfair_lock_unlock(&_lock);
+    
+    // already cancelled, invoke outside the lock
+    if (block != nil) {
+        block();
+    }
+}
+- (void)cancel {
+    os_unfair_lock_lock(&_lock);
+    
+    BOOL wasCancelled = atomic_exchange_explicit(&_cancelled, true, memory_order_release);
+    NSArray<dispatch_block_t> *blocks = self.cancellationBlocks;
+    
+    [self setCancellationBlocks:nil];
+    
+    os_unfair_lock_unlock(&_lock);
+    
+    if (wasCancelled) {
+        return;
+    }
+    
+    for (dispatch_block_t block in blocks) {
+        block();
+    }
+}
+
+@dynamic cancelled;
+- (BOOL)isCancelled {
+    return atomic_load_explicit(&_cancelled, memory_order_acquire);
+}
+
+@end
@@ -0,0 +1,206 @@
+//
+//  KSOTokenCompletionIndex.h
+//  KSOToken
+//
+//  Created by William Towe on 10/17/26.
+//  Copyright © 2021 Kosoku Interactive, LLC. All rights reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+#import <Foundation/Foundation.h>
+#import <KSOToken/KSOTokenCompletionModel.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ KSOTokenIndexedCompletionModel is the completion model returned from KSOTokenCompletionIndex queries. Its tokenCompletionModelIndexes are the matching indexes within its title.
+ */
+@interface KSOTokenIndexedCompletionModel : NSObject <KSOTokenCompletionModel>
+
+/**
+ Get the title of the receiver, which is the original string from the corpus.
+ */
+@property (readonly,copy,nonatomic) NSString *title;
+/**
+ Get the index of the title within the array of strings the owning index was created with.
+ */
+@property (readonly,assign,nonatomic) NSUInteger index;
+/**
+ Get the matching indexes within title.
+ */
+@property (readonly,copy,nonatomic) NSIndexSet *indexes;
+
+@end
+
+/**
+ KSOTokenCompletionMatch describes a single match considered while ranking the results of a KSOTokenCompletionIndex query.
+ */
+typedef struct {
+    /**
+     The index of the matching string within the array of strings the index was created with.
+     */
+    NSUInteger index;
+    /**
+     The location of the match within the string, 0 for prefix matches.
+     */
+    NSUInteger location;
+    /**
+     The length of the matching string.
+     */
+    NSUInteger length;
+    /**
+     The number of edits between the query and the matching text, 0 for exact matches.
+     */
+    NSUInteger distance;
+    /**
+     The weight of the matching string, for example its frequency, or 0.0 if the index was created without weights.
+     */
+    double weight;
+    /**
+     The score assigned by fuzzy matching, higher is better, or 0.0 for prefix and substring queries.
+     */
+    double score;
+} KSOTokenCompletionMatch;
+
+/**
+ Block used to score a match, higher scores rank first and matches with equal scores rank by index. The block is called for every match while the query scans the index, so it must be fast. Capture whatever additional state is needed, for example when each string was last used to score recency.
+ 
+ @param match The match to score
+ @return The score of the match
+ */
+typedef double(^KSOTokenCompletionScoringBlock)(KSOTokenCompletionMatch match);
+
+/**
+ KSOTokenCompletionResults is one page of ranked completion models returned from a KSOTokenCompletionIndex query.
+ */
+@interface KSOTokenCompletionResults : NSObject
+
+/**
+ Get the ranked completion models of the receiver.
+ */
+@property (readonly,copy,nonatomic) NSArray<KSOTokenIndexedCompletionModel *> *completionModels;
+/**
+ Get the offset of the first completion model of the receiver within all of the ranked matches.
+ */
+@property (readonly,assign,nonatomic) NSUInteger offset;
+/**
+ Get the offset to pass to the next query to continue after the receiver.
+ */
+@property (readonly,nonatomic) NSUInteger nextOffset;
+/**
+ Get whether there are more ranked matches after the receiver.
+ */
+@property (readonly,assign,nonatomic) BOOL hasMoreResults;
+
+@end
+
+/**
+ KSOTokenCompletionIndex is an immutable index over a corpus of strings that answers case insensitive prefix and substring queries without scanning the entire corpus. Create it once, preferably on a background queue, and query it from the delegate completion methods of KSOTokenTextView. Once created it is safe to query from any thread.
+ 
+ Large corpora that never change, like a dictionary, can be built ahead of time into a corpus file, see writeCorpusToURL: and the build tool in the Tools directory. An index created from a corpus file maps it and queries it in place, so creating it is constant time and only the pages a query touches become resident.
+ 
+ By default results are ranked by match location, so prefix matches rank first, then by title length, then by position within the corpus. Provide a KSOTokenCompletionScoringBlock to rank by anything else. Only the best matches are ever retained while scanning, so the memory used by a query is bounded by the number of results it returns, no matter how many strings match.
+ */
+@interface KSOTokenCompletionIndex : NSObject
+
+/**
+ Get the number of strings in the receiver.
+ */
+@property (readonly,nonatomic) NSUInteger count;
+
+/**
+ Calls initWithStrings:weights:, passing *strings* and nil respectively.
+ 
+ @param strings The strings to index
+ @return An initialized instance of the receiver, or nil if memory could not be allocated
+ */
+- (nullable instancetype)initWithStrings:(NSArray<NSString *> *)strings;
+/**
+ Designated initializer. Building the index is O(n log n) in the total length of *strings*, so this should not be called on the main thread for large corpora.
+ 
+ @param strings The strings to index
+ @param weights The weight of each string, for example its frequency, which is passed to scoring blocks, must be nil or contain one number per string
+ @return An initialized instance of the receiver, or nil if memory could not be allocated
+ */
+- (nullable instancetype)initWithStrings:(NSArray<NSString *> *)strings weights:(nullable NSArray<NSNumber *> *)weights NS_DESIGNATED_INITIALIZER;
+/**
+ Creates and returns an index that maps the corpus file at *URL* and queries it in place, nothing is copied and no objects are created per string. Only the header of the file is validated, so corpus files must come from a trusted source like the bundle of the app.
+ 
+ @param URL The file URL of a corpus written by writeCorpusToURL: or the corpus build tool
+ @return An initialized instance of the receiver, or nil if the file could not be mapped or is not a corpus
+ */
+- (nullable instancetype)initWithContentsOfCorpusURL:(NSURL *)URL NS_DESIGNATED_INITIALIZER;
+- (instancetype)init NS_UNAVAILABLE;
+
+/**
+ Writes the receiver to *URL* as a corpus file that can be passed to initWithContentsOfCorpusURL:. Corpus files are written in the byte order of the host, which is little endian on every supported device.
+ 
+ @param URL The file URL to write to
+ @return YES if the corpus was written, otherwise NO
+ */
+- (BOOL)writeCorpusToURL:(NSURL *)URL;
+
+/**
+ Returns the ranked completion models whose titles begin with *prefix*, ignoring case.
+ 
+ @param prefix The prefix to match
+ @param maximumCount The maximum number of completion models to return, pass 0 to return all matches
+ @return The array of matching completion models
+ */
+- (NSArray<KSOTokenIndexedCompletionModel *> *)completionModelsWithPrefix:(NSString *)prefix maximumCount:(NSUInteger)maximumCount;
+/**
+ Returns the ranked completion models whose titles contain *substring*, ignoring case.
+ 
+ @param substring The substring to match
+ @param maximumCount The maximum number of completion models to return, pass 0 to return all matches
+ @return The array of matching completion models
+ */
+- (NSArray<KSOTokenIndexedCompletionModel *> *)completionModelsForSubstring:(NSString *)substring maximumCount:(NSUInteger)maximumCount;
+
+/**
+ Returns the page of completion models whose titles begin with *prefix*, ignoring case, ranked by *scoringBlock*.
+ 
+ @param prefix The prefix to match
+ @param offset The offset of the first ranked match to return, pass the nextOffset of the previous results to continue them
+ @param limit The maximum number of completion models to return, pass 0 to return all matches
+ @param scoringBlock The block used to score matches, pass nil to use the default ranking
+ @return The page of matching completion models
+ */
+- (KSOTokenCompletionResults *)completionResultsWithPrefix:(NSString *)prefix offset:(NSUInteger)offset limit:(NSUInteger)limit scoringBlock:(nullable KSOTokenCompletionScoringBlock)scoringBlock;
+/**
+ Returns the page of completion models whose titles contain *substring*, ignoring case, ranked by *scoringBlock*.
+ 
+ @param substring The substring to match
+ @param offset The offset of the first ranked match to return, pass the nextOffset of the previous results to continue them
+ @param limit The maximum number of completion models to return, pass 0 to return all matches
+ @param scoringBlock The block used to score matches, pass nil to use the default ranking
+ @return The page of matching completion models
+ */
+- (KSOTokenCompletionResults *)completionResultsForSubstring:(NSString *)substring offset:(NSUInteger)offset limit:(NSUInteger)limit scoringBlock:(nullable KSOTokenCompletionScoringBlock)scoringBlock;
+/**
+ Returns the page of completion models whose titles fuzzy match *string*, ignoring case, ranked by *scoringBlock*. A title matches if the characters of *string* appear within it in order, or if a prefix of it is within *maximumDistance* edits of *string*. The indexes of each completion model are the matching characters, which are not necessarily contiguous. The default ranking is by the score of each match, which favors consecutive characters, characters at the start of words and fewer edits.
+ 
+ Every title is considered, so this is slower than the other queries, but cheap character checks reject most titles before they are matched.
+ 
+ @param string The string to match
+ @param maximumDistance The maximum number of edits, which is limited to a third of the length of *string* and at most 3
+ @param offset The offset of the first ranked match to return, pass the nextOffset of the previous results to continue them
+ @param limit The maximum number of completion models to return, pass 0 to return all matches
+ @param scoringBlock The block used to score matches, pass nil to use the default ranking
+ @return The page of matching completion models
+ */
+- (KSOTokenCompletionResults *)completionResultsForFuzzyString:(NSString *)string maximumDistance:(NSUInteger)maximumDistance offset:(NSUInteger)offset limit:(NSUInteger)limit scoringBlock:(nullable KSOTokenCompletionScoringBlock)scoringBlock;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,549 @@
+//
+//  KSOTokenCompletionIndex.m
+//  KSOToken
+//
+//  Created by William Towe on 10/17/26.
+//  Copyright © 2021 Kosoku Interactive, LLC. All rights reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+#import "KSOTokenCompletionIndex.h"
+#import "KSOTokenCompletionIndexFunctions.h"
+#import "KSOTokenFuzzyMatchFunctions.h"
+#import "KSOTokenCorpusFunctions.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+@interface KSOTokenIndexedCompletionModel ()
+@property (readwrite,copy,nonatomic) NSString *title;
+@property (readwrite,assign,nonatomic) NSUInteger index;
+@property (readwrite,copy,nonatomic) NSIndexSet *indexes;
+
+- (instancetype)initWithTitle:(NSString *)title index:(NSUInteger)index indexes:(NSIndexSet *)indexes;
+@end
+
+@implementation KSOTokenIndexedCompletionModel
+
+- (BOOL)isEqual:(id)object {
+    if (self == object) {
+        return YES;
+    }
+    else if (![object isKindOfClass:KSOTokenIndexedCompletionModel.class]) {
+        return NO;
+    }
+    return self.index == [(KSOTokenIndexedCompletionModel *)object index];
+}
+- (NSUInteger)hash {
+    return self.index;
+}
+
+- (NSString *)tokenCompletionModelTitle {
+    return self.title;
+}
+- (NSIndexSet *)tokenCompletionModelIndexes {
+    return self.indexes;
+}
+
+- (instancetype)initWithTitle:(NSString *)title index:(NSUInteger)index indexes:(NSIndexSet *)indexes {
+    if (!(self = [super init]))
+        return nil;
+    
+    _title = [title copy];
+    _index = index;
+    _indexes = [indexes copy];
+    
+    return self;
+}
+
+@end
+
+@interface KSOTokenCompletionResults ()
+@property (readwrite,copy,nonatomic) NSArray<KSOTokenIndexedCompletionModel *> *completionModels;
+@property (readwrite,assign,nonatomic) NSUInteger offset;
+@property (readwrite,assign,nonatomic) BOOL hasMoreResults;
+
+- (instancetype)initWithCompletionModels:(NSArray<KSOTokenIndexedCompletionModel *> *)completionModels offset:(NSUInteger)offset hasMoreResults:(BOOL)hasMoreResults;
+@end
+
+@implementation KSOTokenCompletionResults
+
+- (instancetype)initWithCompletionModels:(NSArray<KSOTokenIndexedCompletionModel *> *)completionModels offset:(NSUInteger)offset hasMoreResults:(BOOL)hasMoreResults {
+    if (!(self = [super init]))
+        return nil;
+    
+    _completionModels = [completionModels copy];
+    _offset = offset;
+    _hasMoreResults = hasMoreResults;
+    
+    return self;
+}
+
+- (NSUInteger)nextOffset {
+    return self.offset + self.completionModels.count;
+}
+
+@end
+
+@interface KSOTokenCompletionIndex ()
+// original characters of each string, each terminated by 0
+@property (assign,nonatomic) unichar *characters;
+// case folded characters, parallel to characters
+@property (assign,nonatomic) unichar *foldedCharacters;
+@property (assign,nonatomic) size_t charactersLength;
+// start of each string within characters, followed by charactersLength
+@property (assign,nonatomic) uint32_t *offsets;
+// suffix array over foldedCharacters
+@property (assign,nonatomic) uint32_t *suffixes;
+@property (assign,nonatomic) size_t suffixesCount;
+// weight of each string, NULL if the index was created without weights
+@property (assign,nonatomic) float *weights;
+// start of each non-empty string, sorted by its folded characters
+@property (assign,nonatomic) uint32_t *prefixes;
+@property (assign,nonatomic) size_t prefixesCount;
+// character class mask of each string, used to reject strings before fuzzy matching them
+@property (assign,nonatomic) uint64_t *masks;
+// the mapped corpus file all of the above point into, NULL if the index was created from strings
+@property (assign,nonatomic) void *mappedBytes;
+@property (assign,nonatomic) size_t mappedLength;
+
+- (KSOTokenCompletionResults *)_completionResultsForString:(NSString *)string offset:(NSUInteger)offset limit:(NSUInteger)limit prefixOnly:(BOOL)prefixOnly scoringBlock:(KSOTokenCompletionScoringBlock)scoringBlock;
+- (KSOTokenIndexedCompletionModel *)_completionModelAtIndex:(size_t)index indexes:(NSIndexSet *)indexes;
+- (KSOTokenCorpus)_corpus;
+
++ (size_t)_fuzzyBatchSize;
+@end
+
+@implementation KSOTokenCompletionIndex
+
+- (void)dealloc {
+    // the sections point into the mapping and are not freed on their own
+    if (_mappedBytes != NULL) {
+        munmap(_mappedBytes, _mappedLength);
+        return;
+    }
+    
+    free(_characters);
+    free(_foldedCharacters);
+    free(_offsets);
+    free(_suffixes);
+    free(_prefixes);
+    free(_weights);
+    free(_masks);
+}
+
+- (instancetype)initWithStrings:(NSArray<NSString *> *)strings {
+    return [self initWithStrings:strings weights:nil];
+}
+- (instancetype)initWithStrings:(NSArray<NSString *> *)strings weights:(NSArray<NSNumber *> *)weights {
+    if (!(self = [super init]))
+        return nil;
+    
+    _count = strings.count;
+    
+    if (weights != nil) {
+        NSParameterAssert(weights.count == strings.count);
+        
+        _weights = malloc(sizeof(float) * (_count > 0 ? _count : 1));
+        
+        if (_weights == NULL) {
+            return nil;
+        }
+        
+        for (NSUInteger i=0; i<_count; i++) {
+            _weights[i] = i < weights.count ? weights[i].floatValue : 0.0;
+        }
+    }
+    
+    size_t length = 0;
+    
+    for (NSString *string in strings) {
+        length += string.length + 1;
+    }
+    
+    _charactersLength = length;
+    _characters = malloc(sizeof(unichar) * (length + 1));
+    _offsets = malloc(sizeof(uint32_t) * (_count + 1));
+    
+    if (_characters == NULL ||
+        _offsets == NULL ||
+        length > UINT32_MAX) {
+        
+        return nil;
+    }
+    
+    size_t offset = 0;
+    NSUInteger index = 0;
+    
+    for (NSString *string in strings) {
+        NSUInteger stringLength = string.length;
+        
+        _offsets[index++] = (uint32_t)offset;
+        
+        [string getCharacters:_characters + offset range:NSMakeRange(0, stringLength)];
+        
+        // embedded terminators would split the string in two, replace them
+        for (NSUInteger i=0; i<stringLength; i++) {
+            if (_characters[offset + i] == 0) {
+                _characters[offset + i] = ' ';
+            }
+        }
+        
+        offset += stringLength;
+        _characters[offset++] = 0;
+    }
+    
+    _offsets[_count] = (uint32_t)length;
+    
+    // the same sections the corpus build tool creates, so an index created from strings writes the same corpus
+    KSOTokenCorpus corpus = {.characters = _characters, .charactersLength = length, .offsets = _offsets, .count = _count};
+    
+    if (!KSOTokenCorpusCreateSections(&corpus)) {
+        return nil;
+    }
+    
+    _foldedCharacters = (unichar *)corpus.foldedCharacters;
+    _suffixes = (uint32_t *)corpus.suffixes;
+    _suffixesCount = corpus.suffixesCount;
+    _prefixes = (uint32_t *)corpus.prefixes;
+    _prefixesCount = corpus.prefixesCount;
+    _masks = (uint64_t *)corpus.masks;
+    
+    return self;
+}
+- (instancetype)initWithContentsOfCorpusURL:(NSURL *)URL {
+    if (!(self = [super init]))
+        return nil;
+    
+    int fileDescriptor = open(URL.fileSystemRepresentation, O_RDONLY);
+    
+    if (fileDescriptor == -1) {
+        return nil;
+    }
+    
+    struct stat fileStatus;
+    void *bytes = MAP_FAILED;
+    
+    if (fstat(fileDescriptor, &fileStatus) == 0 &&
+        fileStatus.st_size > 0) {
+        
+        bytes = mmap(NULL, (size_t)fileStatus.st_size, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+    }
+    
+    // the mapping keeps the file alive
+    close(fileDescriptor);
+    
+    if (bytes == MAP_FAILED) {
+        return nil;
+    }
+    
+    _mappedBytes = bytes;
+    _mappedLength = (size_t)fileStatus.st_size;
+    
+    KSOTokenCorpus corpus;
+    
+    if (!KSOTokenCorpusOpen(&corpus, bytes, _mappedLength)) {
+        return nil;
+    }
+    
+    // queries only read the sections, so they can point straight into the mapping
+    _count = corpus.count;
+    _characters = (unichar *)corpus.characters;
+    _foldedCharacters = (unichar *)corpus.foldedCharacters;
+    _charactersLength = corpus.charactersLength;
+    _offsets = (uint32_t *)corpus.offsets;
+    _suffixes = (uint32_t *)corpus.suffixes;
+    _suffixesCount = corpus.suffixesCount;
+    _prefixes = (uint32_t *)corpus.prefixes;
+    _prefixesCount = corpus.prefixesCount;
+    _masks = (uint64_t *)corpus.masks;
+    _weights = (float *)corpus.weights;
+    
+    return self;
+}
+
+- (BOOL)writeCorpusToURL:(NSURL *)URL {
+    KSOTokenCorpus corpus = [self _corpus];
+    size_t length = KSOTokenCorpusWriteLength(&corpus);
+    
+    if (length == 0) {
+        return NO;
+    }
+    
+    NSMutableData *data = [[NSMutableData alloc] initWithLength:length];
+    
+    if (data == nil) {
+        return NO;
+    }
+    
+    KSOTokenCorpusWrite(&corpus, data.mutableBytes);
+    
+    return [data writeToURL:URL atomically:YES];
+}
+
+- (NSArray<KSOTokenIndexedCompletionModel *> *)completionModelsWithPrefix:(NSString *)prefix maximumCount:(NSUInteger)maximumCount {
+    return [self _completionResultsForString:prefix offset:0 limit:maximumCount prefixOnly:YES scoringBlock:nil].completionModels;
+}
+- (NSArray<KSOTokenIndexedCompletionModel *> *)completionModelsForSubstring:(NSString *)substring maximumCount:(NSUInteger)maximumCount {
+    return [self _completionResultsForString:substring offset:0 limit:maximumCount prefixOnly:NO scoringBlock:nil].completionModels;
+}
+- (KSOTokenCompletionResults *)completionResultsWithPrefix:(NSString *)prefix offset:(NSUInteger)offset limit:(NSUInteger)limit scoringBlock:(KSOTokenCompletionScoringBlock)scoringBlock {
+    return [self _completionResultsForString:prefix offset:offset limit:limit prefixOnly:YES scoringBlock:scoringBlock];
+}
+- (KSOTokenCompletionResults *)completionResultsForSubstring:(NSString *)substring offset:(NSUInteger)offset limit:(NSUInteger)limit scoringBlock:(KSOTokenCompletionScoringBlock)scoringBlock {
+    return [self _completionResultsForString:substring offset:offset limit:limit prefixOnly:NO scoringBlock:scoringBlock];
+}
+- (KSOTokenCompletionResults *)completionResultsForFuzzyString:(NSString *)string maximumDistance:(NSUInteger)maximumDistance offset:(NSUInteger)offset limit:(NSUInteger)limit scoringBlock:(KSOTokenCompletionScoringBlock)scoringBlock {
+    size_t patternLength = string.length;
+    
+    if (patternLength == 0 ||
+        self.count == 0) {
+        
+        return [[KSOTokenCompletionResults alloc] initWithCompletionModels:@[] offset:offset hasMoreResults:NO];
+    }
+    
+    size_t batchSize = [self.class _fuzzyBatchSize];
+    unichar *pattern = malloc(sizeof(unichar) * patternLength);
+    uint32_t *candidates = malloc(sizeof(uint32_t) * batchSize);
+    
+    if (pattern == NULL ||
+        candidates == NULL) {
+        
+        free(pattern);
+        free(candidates);
+        return [[KSOTokenCompletionResults alloc] initWithCompletionModels:@[] offset:offset hasMoreResults:NO];
+    }
+    
+    [string getCharacters:pattern range:NSMakeRange(0, patternLength)];
+    KSOTokenFoldCharacters(pattern, pattern, patternLength);
+    
+    KSOTokenFuzzyPattern fuzzyPattern;
+    
+    KSOTokenFuzzyPatternInit(&fuzzyPattern, pattern, patternLength, maximumDistance);
+    
+    // pull everything into locals, the loops below can run many thousands of times
+    const unichar *foldedCharacters = self.foldedCharacters;
+    const uint32_t *offsets = self.offsets;
+    const uint64_t *masks = self.masks;
+    const float *weights = self.weights;
+    size_t count = self.count;
+    size_t capacity = limit > 0 ? offset + limit : count;
+    size_t matchesCount = 0;
+    KSOTokenBoundedHeap heap;
+    
+    if (!KSOTokenBoundedHeapInit(&heap, capacity)) {
+        free(pattern);
+        free(candidates);
+        return [[KSOTokenCompletionResults alloc] initWithCompletionModels:@[] offset:offset hasMoreResults:NO];
+    }
+    
+    // reject strings a batch at a time using only their masks, which keeps the scan over masks sequential
+    for (size_t first=0; first<count; first+=batchSize) {
+        size_t candidatesCount = KSOTokenFuzzyFilterMasks(masks + first, MIN(batchSize, count - first), &fuzzyPattern, candidates);
+        
+        for (size_t i=0; i<candidatesCount; i++) {
+            size_t index = first + candidates[i];
+            size_t length = offsets[index + 1] - offsets[index] - 1;
+            KSOTokenFuzzyMatchResult result;
+            
+            if (!KSOTokenFuzzyMatch(&fuzzyPattern, foldedCharacters + offsets[index], length, masks[index], NULL, &result)) {
+                continue;
+            }
+            
+            matchesCount++;
+            
+            double score = result.score;
+            
+            if (scoringBlock != nil) {
+                score = scoringBlock((KSOTokenCompletionMatch){index, result.location, length, result.distance, weights == NULL ? 0.0 : weights[index], result.score});
+            }
+            
+            KSOTokenBoundedHeapInsertScore(&heap, score, index);
+        }
+    }
+    
+    KSOTokenBoundedHeapSort(&heap);
+    
+    size_t first = MIN(offset, heap.count);
+    NSMutableArray *completionModels = [[NSMutableArray alloc] initWithCapacity:heap.count - first];
+    uint32_t *positions = malloc(sizeof(uint32_t) * KSOTokenFuzzyPatternPositionsCapacity(&fuzzyPattern));
+    
+    // match the few strings that are returned again to find their positions
+    for (size_t i=first; i<heap.count && positions != NULL; i++) {
+        size_t index = KSOTokenCompletionRankKeyIndex(heap.keys[i]);
+        KSOTokenFuzzyMatchResult result;
+        NSMutableIndexSet *indexes = [[NSMutableIndexSet alloc] init];
+        
+        KSOTokenFuzzyMatch(&fuzzyPattern, foldedCharacters + offsets[index], offsets[index + 1] - offsets[index] - 1, masks[index], positions, &result);
+        
+        for (uint32_t j=0; j<result.positionsCount; j++) {
+            [indexes addIndex:positions[j]];
+        }
+        
+        [completionModels addObject:[self _completionModelAtIndex:index indexes:indexes]];
+    }
+    
+    BOOL hasMoreResults = matchesCount > heap.count;
+    
+    KSOTokenBoundedHeapDestroy(&heap);
+    free(positions);
+    free(candidates);
+    free(pattern);
+    
+    return [[KSOTokenCompletionResults alloc] initWithCompletionModels:completionModels offset:offset hasMoreResults:hasMoreResults];
+}
+
+- (KSOTokenCompletionResults *)_completionResultsForString:(NSString *)string offset:(NSUInteger)offset limit:(NSUInteger)limit prefixOnly:(BOOL)prefixOnly scoringBlock:(KSOTokenCompletionScoringBlock)scoringBlock; {
+    size_t patternLength = string.length;
+    
+    if (patternLength == 0 ||
+        self.count == 0) {
+        
+        return [[KSOTokenCompletionResults alloc] initWithCompletionModels:@[] offset:offset hasMoreResults:NO];
+    }
+    
+    unichar *pattern = malloc(sizeof(unichar) * patternLength);
+    
+    if (pattern == NULL) {
+        return [[KSOTokenCompletionResults alloc] initWithCompletionModels:@[] offset:offset hasMoreResults:NO];
+    }
+    
+    [string getCharacters:pattern range:NSMakeRange(0, patternLength)];
+    KSOTokenFoldCharacters(pattern, pattern, patternLength);
+    
+    // pull everything into locals, the loops below can run many thousands of times
+    const unichar *foldedCharacters = self.foldedCharacters;
+    size_t charactersLength = self.charactersLength;
+    const uint32_t *offsets = self.offsets;
+    const uint32_t *prefixes = self.prefixes;
+    const uint32_t *suffixes = self.suffixes;
+    const float *weights = self.weights;
+    size_t count = self.count;
+    size_t prefixesLength;
+    size_t prefixesFirst = KSOTokenSuffixArrayFind(foldedCharacters, charactersLength, prefixes, self.prefixesCount, pattern, patternLength, &prefixesLength);
+    size_t suffixesLength = 0;
+    size_t suffixesFirst = 0;
+    
+    if (!prefixOnly) {
+        suffixesFirst = KSOTokenSuffixArrayFind(foldedCharacters, charactersLength, suffixes, self.suffixesCount, pattern, patternLength, &suffixesLength);
+    }
+    
+    // only the best offset + limit matches are ever retained, no matter how many strings match
+    size_t capacity = limit > 0 ? offset + limit : prefixesLength + suffixesLength;
+    // the number of strings that match, which tells whether there are more results than were returned
+    size_t matchesCount = 0;
+    KSOTokenBoundedHeap heap;
+    
+    if (!KSOTokenBoundedHeapInit(&heap, capacity)) {
+        free(pattern);
+        return [[KSOTokenCompletionResults alloc] initWithCompletionModels:@[] offset:offset hasMoreResults:NO];
+    }
+    
+    for (size_t i=prefixesFirst; i<prefixesFirst + prefixesLength; i++) {
+        size_t index = KSOTokenOffsetsFind(offsets, count, prefixes[i]);
+        size_t length = offsets[index + 1] - offsets[index] - 1;
+        
+        matchesCount++;
+        
+        if (scoringBlock == nil) {
+            KSOTokenBoundedHeapInsert(&heap, KSOTokenCompletionRankKey(0, length, index));
+        }
+        else {
+            KSOTokenBoundedHeapInsertScore(&heap, scoringBlock((KSOTokenCompletionMatch){index, 0, length, 0, weights == NULL ? 0.0 : weights[index]}), index);
+        }
+    }
+    
+    // by default prefix matches always outrank other matches, so once the heap is full the remaining suffixes can only tell whether there are more results
+    BOOL rankSuffixes = (scoringBlock != nil || heap.count < heap.capacity);
+    
+    for (size_t i=suffixesFirst; i<suffixesFirst + suffixesLength; i++) {
+        uint32_t position = suffixes[i];
+        size_t index = KSOTokenOffsetsFind(offsets, count, position);
+        size_t location = position - offsets[index];
+        size_t length = offsets[index + 1] - offsets[index] - 1;
+        
+        // prefix matches were handled above
+        if (location == 0) {
+            continue;
+        }
+        // only rank the first occurrence within each string
+        if (KSOTokenCharactersContainPattern(foldedCharacters + offsets[index], location + patternLength - 1, pattern, patternLength)) {
+            continue;
+        }
+        
+        matchesCount++;
+        
+        if (!rankSuffixes) {
+            break;
+        }
+        else if (scoringBlock == nil) {
+            KSOTokenBoundedHeapInsert(&heap, KSOTokenCompletionRankKey(location, length, index));
+        }
+        else {
+            KSOTokenBoundedHeapInsertScore(&heap, scoringBlock((KSOTokenCompletionMatch){index, location, length, 0, weights == NULL ? 0.0 : weights[index]}), index);
+        }
+    }
+    
+    KSOTokenBoundedHeapSort(&heap);
+    
+    size_t first = MIN(offset, heap.count);
+    NSMutableArray *completionModels = [[NSMutableArray alloc] initWithCapacity:heap.count - first];
+    
+    for (size_t i=first; i<heap.count; i++) {
+        size_t index = KSOTokenCompletionRankKeyIndex(heap.keys[i]);
+        size_t location = scoringBlock == nil ? KSOTokenCompletionRankKeyLocation(heap.keys[i]) : SIZE_MAX;
+        
+        // scored keys do not encode the location and ranked keys clamp it, find it again for the few matches that are returned
+        if (location == SIZE_MAX) {
+            location = KSOTokenCharactersFindPattern(foldedCharacters + offsets[index], offsets[index + 1] - offsets[index] - 1, pattern, patternLength);
+        }
+        
+        [completionModels addObject:[self _completionModelAtIndex:index indexes:[NSIndexSet indexSetWithIndexesInRange:NSMakeRange(location, patternLength)]]];
+    }
+    
+    BOOL hasMoreResults = matchesCount > heap.count;
+    
+    KSOTokenBoundedHeapDestroy(&heap);
+    free(pattern);
+    
+    return [[KSOTokenCompletionResults alloc] initWithCompletionModels:completionModels offset:offset hasMoreResults:hasMoreResults];
+}
+- (KSOTokenIndexedCompletionModel *)_completionModelAtIndex:(size_t)index indexes:(NSIndexSet *)indexes; {
+    uint32_t offset = self.offsets[index];
+    NSString *title = [[NSString alloc] initWithCharacters:self.characters + offset length:self.offsets[index + 1] - offset - 1];
+    
+    return [[KSOTokenIndexedCompletionModel alloc] initWithTitle:title index:index indexes:indexes];
+}
+- (KSOTokenCorpus)_corpus; {
+    return (KSOTokenCorpus){
+        .characters = self.characters,
+        .foldedCharacters = self.foldedCharacters,
+        .charactersLength = self.charactersLength,
+        .offsets = self.offsets,
+        .count = self.count,
+        .suffixes = self.suffixes,
+        .suffixesCount = self.suffixesCount,
+        .prefixes = self.prefixes,
+        .prefixesCount = self.prefixesCount,
+        .masks = self.masks,
+        .weights = self.weights
+    };
+}
+
++ (size_t)_fuzzyBatchSize; {
+    return 4096;
+}
+
+@end
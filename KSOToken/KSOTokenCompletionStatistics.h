@@ -0,0 +1,97 @@
+//
+//  KSOTokenCompletionStatistics.h
+//  KSOToken
+//
+//  Created by William Towe on 10/17/26.
+//  Copyright © 2021 Kosoku Interactive, LLC. All rights reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ Enum describing when a KSOTokenTextView sends a completion query after a keystroke.
+ */
+typedef NS_ENUM(NSInteger, KSOTokenCompletionsSchedulingPolicy) {
+    /**
+     A query is sent on every keystroke.
+     */
+    KSOTokenCompletionsSchedulingPolicyImmediate = 0,
+    /**
+     A query is sent on the first keystroke, then at most once per average query latency, so results keep arriving while the user types.
+     */
+    KSOTokenCompletionsSchedulingPolicyThrottle = 1,
+    /**
+     A query is sent once the user stops typing for the scheduling delay.
+     */
+    KSOTokenCompletionsSchedulingPolicyDebounce = 2
+};
+
+/**
+ KSOTokenCompletionStatistics counts the completion queries a KSOTokenTextView sends to its delegate. A query is started when one of the completion delegate methods is called, and ends either completed, when its results are displayed, or cancelled, when it is superseded before that. Lookups answered by the completionsCache or by refinement do not query the delegate and are not counted. All methods are thread safe.
+ */
+@interface KSOTokenCompletionStatistics : NSObject
+
+/**
+ Get the number of queries sent to the delegate.
+ */
+@property (readonly,nonatomic) NSUInteger startedCount;
+/**
+ Get the number of queries that were superseded before their results were displayed.
+ */
+@property (readonly,nonatomic) NSUInteger cancelledCount;
+/**
+ Get the number of queries whose results were displayed.
+ */
+@property (readonly,nonatomic) NSUInteger completedCount;
+
+/**
+ Get the total time, in seconds, the receiver's text view spent on the main thread looking up completions. This includes starting queries, answering them from the completionsCache or by refinement, and displaying their results. When completionsExecutionMode is KSOTokenCompletionsExecutionModeMainThread it also includes the time spent in the delegate.
+ */
+@property (readonly,nonatomic) NSTimeInterval totalMainThreadTime;
+/**
+ Get the average time, in seconds, spent on the main thread per keystroke that looked up completions.
+ */
+@property (readonly,nonatomic) NSTimeInterval averageMainThreadTime;
+/**
+ Get the longest time, in seconds, spent on the main thread at once.
+ */
+@property (readonly,nonatomic) NSTimeInterval maximumMainThreadTime;
+
+/**
+ Get the policy used to schedule the query for the most recent keystroke. When completionsSchedulingMode is KSOTokenCompletionsSchedulingModeFixed this is KSOTokenCompletionsSchedulingPolicyDebounce if completionsDelay is greater than 0, otherwise KSOTokenCompletionsSchedulingPolicyImmediate.
+ */
+@property (readonly,nonatomic) KSOTokenCompletionsSchedulingPolicy schedulingPolicy;
+/**
+ Get the delay, in seconds, the query for the most recent keystroke was scheduled after.
+ */
+@property (readonly,nonatomic) NSTimeInterval schedulingDelay;
+/**
+ Get the moving average, in seconds, of the time between sending a query to the delegate and its results arriving, or 0 if no query has been measured. Cancelled queries only count when they were outstanding for longer than the average.
+ */
+@property (readonly,nonatomic) NSTimeInterval averageQueryLatency;
+/**
+ Get the moving average, in seconds, of the time between keystrokes, or 0 if the user has not typed. Pauses longer than a second are not counted.
+ */
+@property (readonly,nonatomic) NSTimeInterval averageKeystrokeInterval;
+
+/**
+ Resets all counts and times to 0.
+ */
+- (void)reset;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,209 @@
+//
+//  KSOTokenCompletionStatistics.m
+//  KSOToken
+//
+//  Created by William Towe on 10/17/26.
+//  Copyright © 2021 Kosoku Interactive, LLC. All rights reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+#import "KSOTokenCompletionStatistics.h"
+#import "KSOTokenCompletionStatistics+Private.h"
+
+#import <os/lock.h>
+
+@interface KSOTokenCompletionStatistics () {
+    os_unfair_lock _lock;
+}
+@property (readwrite,assign,nonatomic) NSUInteger startedCount;
+@property (readwrite,assign,nonatomic) NSUInteger cancelledCount;
+@property (readwrite,assign,nonatomic) NSUInteger completedCount;
+@property (readwrite,assign,nonatomic) NSTimeInterval totalMainThreadTime;
+@property (readwrite,assign,nonatomic) NSTimeInterval maximumMainThreadTime;
+@property (assign,nonatomic) NSUInteger keystrokeCount;
+@property (readwrite,assign,nonatomic) KSOTokenCompletionsSchedulingPolicy schedulingPolicy;
+@property (readwrite,assign,nonatomic) NSTimeInterval schedulingDelay;
+@property (readwrite,assign,nonatomic) NSTimeInterval averageQueryLatency;
+@property (readwrite,assign,nonatomic) NSTimeInterval averageKeystrokeInterval;
+@end
+
+@implementation KSOTokenCompletionStatistics
+
+- (instancetype)init {
+    if (!(self = [super init]))
+        return nil;
+    
+    _lock = OS_UNFAIR_LOCK_INIT;
+    
+    return self;
+}
+
+- (NSString *)description {
+    return [NSString stringWithFormat:@"<%@: %p> started=%@ cancelled=%@ completed=%@ averageMainThreadTime=%.3fms maximumMainThreadTime=%.3fms schedulingPolicy=%@ schedulingDelay=%.3fms averageQueryLatency=%.3fms averageKeystrokeInterval=%.3fms",NSStringFromClass(self.class),self,@(self.startedCount),@(self.cancelledCount),@(self.completedCount),self.averageMainThreadTime * 1000.0,self.maximumMainThreadTime * 1000.0,@(self.schedulingPolicy),self.schedulingDelay * 1000.0,self.averageQueryLatency * 1000.0,self.averageKeystrokeInterval * 1000.0];
+}
+
+- (void)reset {
+    os_unfair_lock_lock(&_lock);
+    
+    _startedCount = 0;
+    _cancelledCount = 0;
+    _completedCount = 0;
+    _totalMainThreadTime = 0.0;
+    _maximumMainThreadTime = 0.0;
+    _keystrokeCount = 0;
+    _schedulingPolicy = KSOTokenCompletionsSchedulingPolicyImmediate;
+    _schedulingDelay = 0.0;
+    _averageQueryLatency = 0.0;
+    _averageKeystrokeInterval = 0.0;
+    
+    os_unfair_lock_unlock(&_lock);
+}
+
+- (NSUInteger)startedCount {
+    os_unfair_lock_lock(&_lock);
+    
+    NSUInteger retval = _startedCount;
+    
+    os_unfair_lock_unlock(&_lock);
+    
+    return retval;
+}
+- (NSUInteger)cancelledCount {
+    os_unfair_lock_lock(&_lock);
+    
+    NSUInteger retval = _cancelledCount;
+    
+    os_unfair_lock_unlock(&_lock);
+    
+    return retval;
+}
+- (NSUInteger)completedCount {
+    os_unfair_lock_lock(&_lock);
+    
+    NSUInteger retval = _completedCount;
+    
+    os_unfair_lock_unlock(&_lock);
+    
+    return retval;
+}
+- (NSTimeInterval)totalMainThreadTime {
+    os_unfair_lock_lock(&_lock);
+    
+    NSTimeInterval retval = _totalMainThreadTime;
+    
+    os_unfair_lock_unlock(&_lock);
+    
+    return retval;
+}
+- (NSTimeInterval)averageMainThreadTime {
+    os_unfair_lock_lock(&_lock);
+    
+    NSTimeInterval retval = _keystrokeCount == 0 ? 0.0 : _totalMainThreadTime / (NSTimeInterval)_keystrokeCount;
+    
+    os_unfair_lock_unlock(&_lock);
+    
+    return retval;
+}
+- (NSTimeInterval)maximumMainThreadTime {
+    os_unfair_lock_lock(&_lock);
+    
+    NSTimeInterval retval = _maximumMainThreadTime;
+    
+    os_unfair_lock_unlock(&_lock);
+    
+    return retval;
+}
+
+- (KSOTokenCompletionsSchedulingPolicy)schedulingPolicy {
+    os_unfair_lock_lock(&_lock);
+    
+    KSOTokenCompletionsSchedulingPolicy retval = _schedulingPolicy;
+    
+    os_unfair_lock_unlock(&_lock);
+    
+    return retval;
+}
+- (NSTimeInterval)schedulingDelay {
+    os_unfair_lock_lock(&_lock);
+    
+    NSTimeInterval retval = _schedulingDelay;
+    
+    os_unfair_lock_unlock(&_lock);
+    
+    return retval;
+}
+- (NSTimeInterval)averageQueryLatency {
+    os_unfair_lock_lock(&_lock);
+    
+    NSTimeInterval retval = _averageQueryLatency;
+    
+    os_unfair_lock_unlock(&_lock);
+    
+    return retval;
+}
+- (NSTimeInterval)averageKeystrokeInterval {
+    os_unfair_lock_lock(&_lock);
+    
+    NSTimeInterval retval = _averageKeystrokeInterval;
+    
+    os_unfair_lock_unlock(&_lock);
+    
+    return retval;
+}
+
+- (void)_recordStartedQuery; {
+    os_unfair_lock_lock(&_lock);
+    
+    _startedCount++;
+    
+    os_unfair_lock_unlock(&_lock);
+}
+- (void)_recordCancelledQuery; {
+    os_unfair_lock_lock(&_lock);
+    
+    _cancelledCount++;
+    
+    os_unfair_lock_unlock(&_lock);
+}
+- (void)_recordCompletedQuery; {
+    os_unfair_lock_lock(&_lock);
+    
+    _completedCount++;
+    
+    os_unfair_lock_unlock(&_lock);
+}
+- (void)_recordMainThreadTime:(NSTimeInterval)time keystroke:(BOOL)keystroke; {
+    os_unfair_lock_lock(&_lock);
+    
+    _totalMainThreadTime += time;
+    _maximumMainThreadTime = MAX(_maximumMainThreadTime, time);
+    
+    if (keystroke) {
+        _keystrokeCount++;
+    }
+    
+    os_unfair_lock_unlock(&_lock);
+}
+- (void)_recordScheduler:(const KSOTokenCompletionScheduler *)scheduler policy:(KSOTokenCompletionsSchedulingPolicy)policy delay:(NSTimeInterval)delay; {
+    os_unfair_lock_lock(&_lock);
+    
+    _schedulingPolicy = policy;
+    _schedulingDelay = delay;
+    // the scheduler uses negative values for averages it has not measured yet
+    _averageQueryLatency = MAX(0.0, scheduler->latency);
+    _averageKeystrokeInterval = MAX(0.0, scheduler->keystrokeInterval);
+    
+    os_unfair_lock_unlock(&_lock);
+}
+
+@end
@@ -18,6 +18,7 @@
 //  limitations under the License.
 
 #import "KSOTokenDefaultCompletionTableViewCell.h"
+#import "KSOTokenCompletionTitleCacheKey.h"
 
 #import <Stanley/KSTScopeMacros.h>
 
@@ -26,10 +27,13 @@ static void *kObservingContext = &kObservingContext;
 @interface KSOTokenDefaultCompletionTableViewCell ()
 @property (strong,nonatomic) UILabel *titleLabel;
 
-@property (copy,nonatomic) NSArray<NSLayoutConstraint *> *activeConstraints;
+@property (strong,nonatomic) NSLayoutConstraint *titleLabelTopConstraint;
+@property (strong,nonatomic) NSLayoutConstraint *titleLabelBottomConstraint;
 
 - (void)_updateTitleLabel;
 
++ (NSCache<KSOTokenCompletionTitleCacheKey *, NSAttributedString *> *)_attributedTitleCache;
+
 + (UIFont *)_defaultTitleFont;
 + (UIColor *)_defaultTitleTextColor;
 + (UIColor *)_defaultHighlightedBackgroundColor;
@@ -57,6 +61,18 @@ static void *kObservingContext = &kObservingContext;
     
     [NSLayoutConstraint activateConstraints:[NSLayoutConstraint constraintsWithVisualFormat:@"V:[view(>=height@priority)]" options:0 metrics:@{@"height": @44.0, @"priority": @(UILayoutPriorityDefaultHigh)} views:@{@"view": self.contentView}]];
     
+    // the constraints are created once, only the vertical constants follow the layout margins
+    _titleLabelTopConstraint = [_titleLabel.topAnchor constraintGreaterThanOrEqualToAnchor:self.contentView.topAnchor constant:self.layoutMargins.top];
+    _titleLabelBottomConstraint = [self.contentView.bottomAnchor constraintGreaterThanOrEqualToAnchor:_titleLabel.bottomAnchor constant:self.layoutMargins.bottom];
+    
+    [NSLayoutConstraint activateConstraints:@[
+        [_titleLabel.leadingAnchor constraintEqualToAnchor:self.contentView.layoutMarginsGuide.leadingAnchor],
+        [self.contentView.layoutMarginsGuide.trailingAnchor constraintEqualToAnchor:_titleLabel.trailingAnchor],
+        [_titleLabel.centerYAnchor constraintEqualToAnchor:self.contentView.centerYAnchor],
+        _titleLabelTopConstraint,
+        _titleLabelBottomConstraint
+    ]];
+    
     [self addObserver:self forKeyPath:@kstKeypath(self,titleFont) options:0 context:kObservingContext];
     [self addObserver:self forKeyPath:@kstKeypath(self,titleTextColor) options:0 context:kObservingContext];
     [self addObserver:self forKeyPath:@kstKeypath(self,highlightBackgroundColor) options:0 context:kObservingContext];
@@ -73,24 +89,11 @@ static void *kObservingContext = &kObservingContext;
     }
 }
 
-+ (BOOL)requiresConstraintBasedLayout {
-    return YES;
-}
-- (void)updateConstraints {
-    NSMutableArray *constraints = [[NSMutableArray alloc] init];
-    
-    [constraints addObjectsFromArray:[NSLayoutConstraint constraintsWithVisualFormat:@"H:|-[view]-|" options:0 metrics:nil views:@{@"view": _titleLabel}]];
-    [constraints addObjectsFromArray:[NSLayoutConstraint constraintsWithVisualFormat:@"V:|->=top-[view]->=bottom-|" options:0 metrics:@{@"top": @(self.layoutMargins.top), @"bottom": @(self.layoutMargins.bottom)} views:@{@"view": _titleLabel}]];
-    
-    [self setActiveConstraints:constraints];
-    
-    [super updateConstraints];
-}
-
 - (void)layoutMarginsDidChange {
     [super layoutMarginsDidChange];
     
-    [self setNeedsUpdateConstraints];
+    [self.titleLabelTopConstraint setConstant:self.layoutMargins.top];
+    [self.titleLabelBottomConstraint setConstant:self.layoutMargins.bottom];
 }
 
 + (CGFloat)estimatedRowHeight {
@@ -119,18 +122,45 @@ static void *kObservingContext = &kObservingContext;
         return;
     }
     
-    NSMutableAttributedString *temp = [[NSMutableAttributedString alloc] initWithString:self.completionModel.tokenCompletionModelTitle attributes:@{NSFontAttributeName: [UIFont systemFontOfSize:17.0], NSForegroundColorAttributeName: self.titleTextColor}];
+    NSString *title = self.completionModel.tokenCompletionModelTitle;
+    NSIndexSet *matchingIndexes = nil;
     
     if ([self.completionModel respondsToSelector:@selector(tokenCompletionModelIndexes)]) {
-        [self.completionModel.tokenCompletionModelIndexes enumerateRangesUsingBlock:^(NSRange range, BOOL * _Nonnull stop) {
-            [temp addAttributes:@{NSBackgroundColorAttributeName: self.highlightBackgroundColor} range:range];
-        }];
+        matchingIndexes = self.completionModel.tokenCompletionModelIndexes;
     }
     else if ([self.completionModel respondsToSelector:@selector(tokenCompletionModelRange)]) {
-        [temp addAttributes:@{NSBackgroundColorAttributeName: self.highlightBackgroundColor} range:self.completionModel.tokenCompletionModelRange];
+        matchingIndexes = [NSIndexSet indexSetWithIndexesInRange:self.completionModel.tokenCompletionModelRange];
     }
     
-    [self.titleLabel setAttributedText:temp];
+    // scrolling a long list of completions shows the same titles over and over, only build each attributed title once
+    KSOTokenCompletionTitleCacheKey *key = [[KSOTokenCompletionTitleCacheKey alloc] initWithTitle:title matchingIndexes:matchingIndexes font:self.titleFont textColor:self.titleTextColor highlightBackgroundColor:self.highlightBackgroundColor];
+    NSAttributedString *attributedTitle = [[self.class _attributedTitleCache] objectForKey:key];
+    
+    if (attributedTitle == nil) {
+        NSMutableAttributedString *temp = [[NSMutableAttributedString alloc] initWithString:title attributes:@{NSFontAttributeName: self.titleFont, NSForegroundColorAttributeName: self.titleTextColor}];
+        
+        [matchingIndexes enumerateRangesUsingBlock:^(NSRange range, BOOL * _Nonnull stop) {
+            [temp addAttributes:@{NSBackgroundColorAttributeName: self.highlightBackgroundColor} range:range];
+        }];
+        
+        attributedTitle = [temp copy];
+        
+        [[self.class _attributedTitleCache] setObject:attributedTitle forKey:key];
+    }
+    
+    [self.titleLabel setAttributedText:attributedTitle];
+}
+
++ (NSCache<KSOTokenCompletionTitleCacheKey *, NSAttributedString *> *)_attributedTitleCache; {
+    static NSCache *kRetval;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        kRetval = [[NSCache alloc] init];
+        
+        [kRetval setName:@"com.kosoku.ksotoken.completion-title-cache"];
+        [kRetval setCountLimit:2048];
+    });
+    return kRetval;
 }
 
 + (UIFont *)_defaultTitleFont; {
@@ -143,12 +173,4 @@ static void *kObservingContext = &kObservingContext;
     return UIColor.yellowColor;
 }
 
-- (void)setActiveConstraints:(NSArray<NSLayoutConstraint *> *)activeConstraints {
-    [NSLayoutConstraint deactivateConstraints:_activeConstraints];
-    
-    _activeConstraints = activeConstraints;
-    
-    [NSLayoutConstraint activateConstraints:_activeConstraints];
-}
-
 @end
@@ -19,6 +19,7 @@
 
 #import <UIKit/UIKit.h>
 #import <KSOToken/KSOTokenTextAttachment.h>
+#import <KSOToken/KSOTokenImageCache.h>
 
 NS_ASSUME_NONNULL_BEGIN
 
@@ -87,6 +88,21 @@ NS_ASSUME_NONNULL_BEGIN
  The default is UIEdgeInsets(0.0, 0.0, 0.0, 0.0).
  */
 @property (assign,nonatomic) UIEdgeInsets tokenEdgeInsets;
+/**
+ Set and get the image cache used to share rendered images between tokens that look identical. Set this to nil to have the receiver always render its own images.
+ 
+ The default is KSOTokenImageCache.sharedImageCache.
+ 
+ @see KSOTokenImageCache
+ */
+@property (strong,nonatomic,nullable) KSOTokenImageCache *tokenImageCache;
+
+/**
+ Performs *updates*, which should set any number of the token properties of the receiver, and updates the appearance of the receiver once afterwards. Calls can be nested. Changes made outside of this method are also coalesced, a token that is already displayed is laid out and drawn again at most once per run loop turn, but batching avoids the intermediate invalidations.
+ 
+ @param updates The block that updates the receiver
+ */
+- (void)performBatchUpdates:(void(NS_NOESCAPE ^)(void))updates;
 
 @end
 
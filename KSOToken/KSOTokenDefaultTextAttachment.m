@@ -18,7 +18,10 @@
 //  limitations under the License.
 
 #import "KSOTokenDefaultTextAttachment.h"
+#import "KSOTokenDefaultTextAttachment+Private.h"
 #import "KSOTokenTextView.h"
+#import "KSOTokenTextView+Private.h"
+#import "KSOTokenImageCacheKey.h"
 
 #import <Stanley/KSTGeometryFunctions.h>
 #import <Stanley/KSTScopeMacros.h>
@@ -30,9 +33,17 @@ static void *kObservingContext = &kObservingContext;
 @property (readwrite,strong,nonatomic) id<KSOTokenRepresentedObject> representedObject;
 @property (copy,nonatomic) NSString *text;
 @property (strong,nonatomic) UIImage *highlightedImage;
+// the size of text drawn with tokenFont and the size of the images, CGSizeZero until they are computed
+@property (assign,nonatomic) CGSize textSize;
+@property (assign,nonatomic) CGSize imageSize;
+@property (assign,nonatomic) NSInteger batchUpdatesCount;
+@property (assign,nonatomic) BOOL needsUpdateImagesAfterBatchUpdates;
 
-- (void)_updateImages;
-- (void)_updateImage:(BOOL)highlighted maxWidth:(CGFloat)maxWidth;
+- (void)_updateImage:(BOOL)highlighted;
+- (UIImage *)_renderImageWithTextColor:(UIColor *)textColor backgroundColor:(UIColor *)backgroundColor;
+- (CGSize)_textSize;
+- (CGSize)_imageSize;
+- (CGFloat)_maximumImageWidth;
 - (UIFont *)_defaultTokenFont;
 - (UIColor *)_defaultTokenTextColor;
 + (UIColor *)_defaultTokenBackgroundColor;
@@ -58,19 +69,44 @@ static void *kObservingContext = &kObservingContext;
 }
 
 - (UIImage *)imageForBounds:(CGRect)imageBounds textContainer:(NSTextContainer *)textContainer characterIndex:(NSUInteger)charIndex {
-    return NSLocationInRange(charIndex, self.tokenTextView.selectedRange) ? self.highlightedImage : self.image;
+    // each variant is rendered the first time it is drawn, most tokens are never highlighted
+    if (NSLocationInRange(charIndex, self.tokenTextView.selectedRange)) {
+        if (self.highlightedImage == nil) {
+            [self _updateImage:YES];
+        }
+        return self.highlightedImage;
+    }
+    
+    if (self.image == nil) {
+        [self _updateImage:NO];
+    }
+    return self.image;
 }
 - (CGRect)attachmentBoundsForTextContainer:(NSTextContainer *)textContainer proposedLineFragment:(CGRect)lineFrag glyphPosition:(CGPoint)position characterIndex:(NSUInteger)charIndex {
-    CGRect retval = [super attachmentBoundsForTextContainer:textContainer proposedLineFragment:lineFrag glyphPosition:position characterIndex:charIndex];
+    // layout only needs the size, which is measured without rendering anything
+    CGSize size = [self _imageSize];
     
-    retval.origin.y = ceil(self.tokenFont.descender);
+    return CGRectMake(0, ceil(self.tokenFont.descender), size.width, size.height);
+}
+
+- (void)performBatchUpdates:(void (NS_NOESCAPE ^)(void))updates {
+    self.batchUpdatesCount++;
     
-    return retval;
+    updates();
+    
+    self.batchUpdatesCount--;
+    
+    if (self.batchUpdatesCount == 0 &&
+        self.needsUpdateImagesAfterBatchUpdates) {
+        
+        [self setNeedsUpdateImagesAfterBatchUpdates:NO];
+        [self _setNeedsUpdateImages];
+    }
 }
 
 - (void)observeValueForKeyPath:(NSString *)keyPath ofObject:(id)object change:(NSDictionary<NSKeyValueChangeKey,id> *)change context:(void *)context {
     if (context == kObservingContext) {
-        [self _updateImages];
+        [self _setNeedsUpdateImages];
     }
     else {
         [super observeValueForKeyPath:keyPath ofObject:object change:change context:context];
@@ -97,6 +133,7 @@ static void *kObservingContext = &kObservingContext;
     _tokenDisabledTextColor = [self _defaultTokenDisabledTextColor];
     _tokenDisabledBackgroundColor = [self.class _defaultTokenDisabledBackgroundColor];
     _tokenCornerRadius = [self.class _defaultTokenCornerRadius];
+    _tokenImageCache = KSOTokenImageCache.sharedImageCache;
     
     [self addObserver:self forKeyPath:@kstKeypath(self,tokenFont) options:0 context:kObservingContext];
     [self addObserver:self forKeyPath:@kstKeypath(self,tokenTextColor) options:0 context:kObservingContext];
@@ -108,8 +145,6 @@ static void *kObservingContext = &kObservingContext;
     [self addObserver:self forKeyPath:@kstKeypath(self,tokenCornerRadius) options:0 context:kObservingContext];
     [self addObserver:self forKeyPath:@kstKeypath(self,tokenEdgeInsets) options:0 context:kObservingContext];
     
-    [self _updateImages];
-    
     return self;
 }
 
@@ -118,7 +153,7 @@ static void *kObservingContext = &kObservingContext;
     return self.tokenTextView.isUserInteractionEnabled;
 }
 - (void)setEnabled:(BOOL)enabled {
-    [self _updateImages];
+    [self _setNeedsUpdateImages];
 }
 @dynamic font;
 - (UIFont *)font {
@@ -127,6 +162,17 @@ static void *kObservingContext = &kObservingContext;
 - (void)setFont:(UIFont *)font {
     [self setTokenFont:font];
 }
+@dynamic tokenSize;
+- (CGSize)tokenSize {
+    CGSize size = [self _textSize];
+    
+    return CGSizeMake(ceil(size.width) + self.tokenEdgeInsets.left + self.tokenEdgeInsets.right, ceil(size.height) + self.tokenEdgeInsets.top + self.tokenEdgeInsets.bottom);
+}
+- (void)setTokenSize:(CGSize)tokenSize {
+    // _imageSize derives the image size from the text size, limiting it to the current width of the text view
+    [self setTextSize:CGSizeMake(MAX(tokenSize.width - self.tokenEdgeInsets.left - self.tokenEdgeInsets.right, 0.0), MAX(tokenSize.height - self.tokenEdgeInsets.top - self.tokenEdgeInsets.bottom, 0.0))];
+    [self setImageSize:CGSizeZero];
+}
 @dynamic tintColor;
 - (UIColor *)tintColor {
     return self.tokenTextView.tintColor;
@@ -136,8 +182,10 @@ static void *kObservingContext = &kObservingContext;
         return;
     }
     
-    [self setTokenTextColor:tintColor];
-    [self setTokenHighlightedBackgroundColor:tintColor];
+    [self performBatchUpdates:^{
+        [self setTokenTextColor:tintColor];
+        [self setTokenHighlightedBackgroundColor:tintColor];
+    }];
 }
 
 - (void)setTokenFont:(UIFont *)tokenFont {
@@ -162,45 +210,109 @@ static void *kObservingContext = &kObservingContext;
     _tokenDisabledBackgroundColor = tokenDisabledBackgroundColor ?: [self.class _defaultTokenDisabledBackgroundColor];
 }
 
-- (void)_updateImages {
-    CGFloat maxWidth = CGRectGetWidth(self.tokenTextView.frame);
+- (void)_setNeedsUpdateImages; {
+    if (self.batchUpdatesCount > 0) {
+        [self setNeedsUpdateImagesAfterBatchUpdates:YES];
+        return;
+    }
     
-    if (isnan(maxWidth) ||
-        maxWidth <= 0.0) {
+    // nothing has been measured or rendered yet, there is nothing to invalidate
+    if (self.image == nil &&
+        self.highlightedImage == nil &&
+        CGSizeEqualToSize(self.textSize, CGSizeZero) &&
+        CGSizeEqualToSize(self.imageSize, CGSizeZero)) {
         
-        maxWidth = CGRectGetWidth(UIScreen.mainScreen.bounds);
+        return;
     }
     
-    [self _updateImage:NO maxWidth:maxWidth];
-    [self _updateImage:YES maxWidth:maxWidth];
+    // the images are rendered again the next time they are drawn
+    [self setImage:nil];
+    [self setHighlightedImage:nil];
+    [self setTextSize:CGSizeZero];
+    [self setImageSize:CGSizeZero];
+    
+    [self.tokenTextView _setNeedsLayoutTokenTextAttachments];
 }
-- (void)_updateImage:(BOOL)highlighted maxWidth:(CGFloat)maxWidth; {
-    CGSize size = [self.text sizeWithAttributes:@{NSFontAttributeName: self.tokenFont}];
-    CGRect rect = CGRectMake(0, 0, ceil(size.width), ceil(size.height));
+- (void)_maximumImageWidthDidChange; {
+    if (CGSizeEqualToSize(self.imageSize, CGSizeZero)) {
+        return;
+    }
     
-    rect.size.width += self.tokenEdgeInsets.left + self.tokenEdgeInsets.right;
-    rect.size.height += self.tokenEdgeInsets.top + self.tokenEdgeInsets.bottom;
+    CGSize size = [self _textSize];
+    CGFloat width = ceil(size.width) + self.tokenEdgeInsets.left + self.tokenEdgeInsets.right;
     
-    if (CGRectGetWidth(rect) > maxWidth) {
-        rect.size.width = maxWidth;
+    if (self.imageSize.width < width ||
+        width > [self _maximumImageWidth]) {
+        
+        [self _setNeedsUpdateImages];
     }
+}
+- (void)_updateImage:(BOOL)highlighted; {
+    KSOTokenTextView *tokenTextView = self.tokenTextView;
+    KSOTokenMetricsInterval interval = [tokenTextView _beginMetricsStage:KSOTokenMetricsStageRenderToken];
+    KSOTokenImageCacheKeyState state = KSOTokenImageCacheKeyStateNormal;
+    UIColor *backgroundColor = self.tokenBackgroundColor;
+    UIColor *textColor = self.tokenTextColor;
     
-    UIGraphicsBeginImageContextWithOptions(rect.size, NO, 0);
+    if (highlighted) {
+        state = KSOTokenImageCacheKeyStateHighlighted;
+        backgroundColor = self.tokenHighlightedBackgroundColor;
+        textColor = self.tokenHighlightedTextColor;
+    }
+    else if (!self.isEnabled) {
+        state = KSOTokenImageCacheKeyStateDisabled;
+        backgroundColor = self.tokenDisabledBackgroundColor;
+        textColor = self.tokenDisabledTextColor;
+    }
+    
+    // dynamic colors like the default tint color are resolved for the current appearance, so the cache never serves an image rendered in another one
+    UITraitCollection *traitCollection = tokenTextView.traitCollection ?: UITraitCollection.currentTraitCollection;
+    
+    backgroundColor = [backgroundColor resolvedColorWithTraitCollection:traitCollection];
+    textColor = [textColor resolvedColorWithTraitCollection:traitCollection];
+    
+    KSOTokenImageCacheKey *key = nil;
+    UIImage *retval = nil;
+    
+    if (self.tokenImageCache != nil) {
+        key = [[KSOTokenImageCacheKey alloc] initWithText:self.text font:self.tokenFont textColor:textColor backgroundColor:backgroundColor cornerRadius:self.tokenCornerRadius edgeInsets:self.tokenEdgeInsets state:state maxWidth:[self _imageSize].width];
+        retval = [self.tokenImageCache imageForKey:key];
+        
+        if (retval != nil) {
+            [tokenTextView _incrementMetricsCounter:KSOTokenMetricsCounterTokenImageCacheHit];
+        }
+    }
     
-    UIColor *color = self.tokenBackgroundColor;
+    if (retval == nil) {
+        retval = [self _renderImageWithTextColor:textColor backgroundColor:backgroundColor];
+        
+        [tokenTextView _incrementMetricsCounter:KSOTokenMetricsCounterTokenRendered];
+        
+        if (key != nil) {
+            [self.tokenImageCache setImage:retval forKey:key];
+        }
+    }
     
     if (highlighted) {
-        color = self.tokenHighlightedBackgroundColor;
+        [self setHighlightedImage:retval];
     }
-    else if (!self.isEnabled) {
-        color = self.tokenDisabledBackgroundColor;
+    else {
+        [self setImage:retval];
     }
     
-    [color setFill];
+    [tokenTextView _endMetricsStage:KSOTokenMetricsStageRenderToken interval:interval];
+}
+- (UIImage *)_renderImageWithTextColor:(UIColor *)textColor backgroundColor:(UIColor *)backgroundColor; {
+    CGSize size = [self _imageSize];
+    CGRect rect = CGRectMake(0, 0, size.width, size.height);
+    
+    UIGraphicsBeginImageContextWithOptions(rect.size, NO, 0);
+    
+    [backgroundColor setFill];
     [[UIBezierPath bezierPathWithRoundedRect:CGRectInset(rect, 2.0, 1.0) cornerRadius:self.tokenCornerRadius] fill];
     
     UIFont *drawFont = self.tokenFont;
-    CGSize drawSize = [self.text sizeWithAttributes:@{NSFontAttributeName: drawFont}];
+    CGSize drawSize = [self _textSize];
     
     if (drawSize.width > CGRectGetWidth(rect)) {
         drawSize.width = CGRectGetWidth(rect) - (self.tokenEdgeInsets.left + self.tokenEdgeInsets.right);
@@ -211,28 +323,43 @@ static void *kObservingContext = &kObservingContext;
     [style setLineBreakMode:NSLineBreakByTruncatingTail];
     [style setAlignment:NSTextAlignmentCenter];
     
-    if (highlighted) {
-        color = self.tokenHighlightedTextColor;
-    }
-    else if (!self.isEnabled) {
-        color = self.tokenDisabledTextColor;
-    }
-    else {
-        color = self.tokenTextColor;
-    }
-    
-    [self.text drawInRect:KSTCGRectCenterInRect(CGRectMake(0, 0, drawSize.width, drawSize.height), rect) withAttributes:@{NSFontAttributeName: drawFont, NSForegroundColorAttributeName: color, NSParagraphStyleAttributeName: style}];
+    [self.text drawInRect:KSTCGRectCenterInRect(CGRectMake(0, 0, drawSize.width, drawSize.height), rect) withAttributes:@{NSFontAttributeName: drawFont, NSForegroundColorAttributeName: textColor, NSParagraphStyleAttributeName: style}];
     
     UIImage *retval = UIGraphicsGetImageFromCurrentImageContext();
     
     UIGraphicsEndImageContext();
     
-    if (highlighted) {
-        [self setHighlightedImage:retval];
+    return retval;
+}
+- (CGSize)_textSize; {
+    if (CGSizeEqualToSize(_textSize, CGSizeZero)) {
+        _textSize = [self.text sizeWithAttributes:@{NSFontAttributeName: self.tokenFont}];
     }
-    else {
-        [self setImage:retval];
+    return _textSize;
+}
+- (CGSize)_imageSize; {
+    if (CGSizeEqualToSize(_imageSize, CGSizeZero)) {
+        CGSize size = [self _textSize];
+        CGSize retval = CGSizeMake(ceil(size.width), ceil(size.height));
+        
+        retval.width += self.tokenEdgeInsets.left + self.tokenEdgeInsets.right;
+        retval.height += self.tokenEdgeInsets.top + self.tokenEdgeInsets.bottom;
+        retval.width = MIN(retval.width, [self _maximumImageWidth]);
+        
+        _imageSize = retval;
+    }
+    return _imageSize;
+}
+- (CGFloat)_maximumImageWidth; {
+    CGFloat retval = CGRectGetWidth(self.tokenTextView.frame);
+    
+    if (isnan(retval) ||
+        retval <= 0.0) {
+        
+        retval = CGRectGetWidth(UIScreen.mainScreen.bounds);
     }
+    
+    return retval;
 }
 
 - (UIFont *)_defaultTokenFont; {
@@ -0,0 +1,60 @@
+//
+//  KSOTokenFuzzyMatcher.h
+//  KSOToken
+//
+//  Created by William Towe on 10/17/26.
+//  Copyright © 2021 Kosoku Interactive, LLC. All rights reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ KSOTokenFuzzyMatcher matches a pattern against arbitrary strings using the same fuzzy matching as KSOTokenCompletionIndex, for completion providers that do not use an index. The matching indexes it returns can be returned directly from tokenCompletionModelIndexes to highlight them in KSOTokenDefaultCompletionTableViewCell. Once created it is safe to use from any thread.
+ */
+@interface KSOTokenFuzzyMatcher : NSObject
+
+/**
+ Get the pattern the receiver matches.
+ */
+@property (readonly,copy,nonatomic) NSString *pattern;
+/**
+ Get the maximum number of edits the receiver allows, after it was limited to a third of the length of pattern and at most 3.
+ */
+@property (readonly,assign,nonatomic) NSUInteger maximumDistance;
+
+/**
+ Designated initializer.
+ 
+ @param pattern The pattern to match
+ @param maximumDistance The maximum number of edits
+ @return An initialized instance of the receiver
+ */
+- (instancetype)initWithPattern:(NSString *)pattern maximumDistance:(NSUInteger)maximumDistance NS_DESIGNATED_INITIALIZER;
+- (instancetype)init NS_UNAVAILABLE;
+
+/**
+ Returns the matching indexes of pattern within *string*, ignoring case, or nil if *string* does not match. A string matches if the characters of pattern appear within it in order, or if a prefix of it is within maximumDistance edits of pattern.
+ 
+ @param string The string to match
+ @param outScore On return the score of the match, higher is better, comparable between strings matched by the receiver
+ @param outDistance On return the number of edits, 0 if the characters of pattern appear in order
+ @return The matching indexes or nil
+ */
+- (nullable NSIndexSet *)matchingIndexesInString:(NSString *)string score:(nullable double *)outScore distance:(nullable NSUInteger *)outDistance;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,111 @@
+//
+//  KSOTokenFuzzyMatcher.m
+//  KSOToken
+//
+//  Created by William Towe on 10/17/26.
+//  Copyright © 2021 Kosoku Interactive, LLC. All rights reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+#import "KSOTokenFuzzyMatcher.h"
+#import "KSOTokenCompletionIndexFunctions.h"
+#import "KSOTokenFuzzyMatchFunctions.h"
+
+// most strings are short, match them without allocating
+#define KSOTokenFuzzyMatcherStackBufferLength 128
+
+@interface KSOTokenFuzzyMatcher ()
+@property (readwrite,copy,nonatomic) NSString *pattern;
+@property (readwrite,assign,nonatomic) NSUInteger maximumDistance;
+
+// case folded characters of pattern, owned by the receiver
+@property (assign,nonatomic) unichar *patternCharacters;
+@property (assign,nonatomic) KSOTokenFuzzyPattern fuzzyPattern;
+@end
+
+@implementation KSOTokenFuzzyMatcher
+
+- (void)dealloc {
+    free(_patternCharacters);
+}
+
+- (instancetype)initWithPattern:(NSString *)pattern maximumDistance:(NSUInteger)maximumDistance {
+    if (!(self = [super init]))
+        return nil;
+    
+    _pattern = [pattern copy];
+    _patternCharacters = malloc(sizeof(unichar) * (_pattern.length > 0 ? _pattern.length : 1));
+    
+    if (_patternCharacters == NULL) {
+        return nil;
+    }
+    
+    [_pattern getCharacters:_patternCharacters range:NSMakeRange(0, _pattern.length)];
+    KSOTokenFoldCharacters(_patternCharacters, _patternCharacters, _pattern.length);
+    KSOTokenFuzzyPatternInit(&_fuzzyPattern, _patternCharacters, _pattern.length, maximumDistance);
+    
+    _maximumDistance = _fuzzyPattern.maximumDistance;
+    
+    return self;
+}
+
+- (NSIndexSet *)matchingIndexesInString:(NSString *)string score:(double *)outScore distance:(NSUInteger *)outDistance {
+    NSUInteger length = string.length;
+    KSOTokenFuzzyPattern fuzzyPattern = self.fuzzyPattern;
+    size_t positionsCapacity = KSOTokenFuzzyPatternPositionsCapacity(&fuzzyPattern);
+    
+    if (fuzzyPattern.length == 0) {
+        return nil;
+    }
+    
+    unichar stackCharacters[KSOTokenFuzzyMatcherStackBufferLength];
+    uint32_t stackPositions[KSOTokenFuzzyMatcherStackBufferLength];
+    unichar *characters = length <= KSOTokenFuzzyMatcherStackBufferLength ? stackCharacters : malloc(sizeof(unichar) * length);
+    uint32_t *positions = positionsCapacity <= KSOTokenFuzzyMatcherStackBufferLength ? stackPositions : malloc(sizeof(uint32_t) * positionsCapacity);
+    NSMutableIndexSet *retval = nil;
+    
+    if (characters != NULL &&
+        positions != NULL) {
+        
+        [string getCharacters:characters range:NSMakeRange(0, length)];
+        KSOTokenFoldCharacters(characters, characters, length);
+        
+        KSOTokenFuzzyMatchResult result;
+        
+        if (KSOTokenFuzzyMatch(&fuzzyPattern, characters, length, KSOTokenFuzzyCharactersMask(characters, length), positions, &result)) {
+            retval = [[NSMutableIndexSet alloc] init];
+            
+            for (uint32_t i=0; i<result.positionsCount; i++) {
+                [retval addIndex:positions[i]];
+            }
+            
+            if (outScore != NULL) {
+                *outScore = result.score;
+            }
+            if (outDistance != NULL) {
+                *outDistance = result.distance;
+            }
+        }
+    }
+    
+    if (characters != stackCharacters) {
+        free(characters);
+    }
+    if (positions != stackPositions) {
+        free(positions);
+    }
+    
+    return retval;
+}
+
+@end
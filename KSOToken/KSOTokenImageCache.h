@@ -0,0 +1,83 @@
+//
+//  KSOTokenImageCache.h
+//  KSOToken
+//
+//  Created by William Towe on 10/17/26.
+//  Copyright © 2021 Kosoku Interactive, LLC. All rights reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+#import <UIKit/UIKit.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ KSOTokenImageCache is a memory bounded cache of rendered token images. KSOTokenDefaultTextAttachment uses sharedImageCache by default, so tokens that look identical, for example the same display text drawn with the same font, colors and state, share a single bitmap. The cache evicts images when its byteLimit is exceeded and removes all images when the application receives a memory warning. All methods are thread safe.
+ */
+@interface KSOTokenImageCache : NSObject
+
+/**
+ Get the shared image cache.
+ */
+@property (class,readonly,strong,nonatomic) KSOTokenImageCache *sharedImageCache;
+
+/**
+ Set and get the maximum number of bytes of bitmap data the receiver retains. This is a soft limit, see NSCache. A value of 0 means no limit.
+ 
+ The default is 16MB.
+ */
+@property (assign,nonatomic) NSUInteger byteLimit;
+
+/**
+ Get the number of images currently in the receiver.
+ */
+@property (readonly,nonatomic) NSUInteger count;
+/**
+ Get the number of bytes of bitmap data currently retained by the receiver.
+ */
+@property (readonly,nonatomic) NSUInteger byteCount;
+/**
+ Get the number of lookups that returned an image.
+ */
+@property (readonly,nonatomic) NSUInteger hitCount;
+/**
+ Get the number of lookups that did not return an image.
+ */
+@property (readonly,nonatomic) NSUInteger missCount;
+
+/**
+ Returns the image for *key*, or nil if there is no image.
+ 
+ @param key The key of the image
+ @return The image or nil
+ */
+- (nullable UIImage *)imageForKey:(id<NSCopying>)key;
+/**
+ Sets *image* for *key*, replacing any existing image.
+ 
+ @param image The image to cache
+ @param key The key of the image
+ */
+- (void)setImage:(UIImage *)image forKey:(id<NSCopying>)key;
+/**
+ Removes all images.
+ */
+- (void)removeAllImages;
+/**
+ Resets hitCount and missCount to 0.
+ */
+- (void)resetStatistics;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,171 @@
+//
+//  KSOTokenImageCache.m
+//  KSOToken
+//
+//  Created by William Towe on 10/17/26.
+//  Copyright © 2021 Kosoku Interactive, LLC. All rights reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+#import "KSOTokenImageCache.h"
+
+#import <os/lock.h>
+
+@interface KSOTokenImageCache () <NSCacheDelegate> {
+    os_unfair_lock _lock;
+}
+@property (strong,nonatomic) NSCache *cache;
+// the cost of each cached image keyed by address, NSCache does not report the cost of an evicted object
+@property (strong,nonatomic) NSMapTable<UIImage *, NSNumber *> *costs;
+
+@property (readwrite,assign,nonatomic) NSUInteger byteCount;
+@property (readwrite,assign,nonatomic) NSUInteger hitCount;
+@property (readwrite,assign,nonatomic) NSUInteger missCount;
+
+- (void)_applicationDidReceiveMemoryWarning:(NSNotification *)note;
+
++ (NSUInteger)_costForImage:(UIImage *)image;
++ (NSUInteger)_defaultByteLimit;
+@end
+
+@implementation KSOTokenImageCache
+
+- (void)dealloc {
+    [NSNotificationCenter.defaultCenter removeObserver:self];
+}
+
+- (instancetype)init {
+    if (!(self = [super init]))
+        return nil;
+    
+    _lock = OS_UNFAIR_LOCK_INIT;
+    _costs = [NSMapTable mapTableWithKeyOptions:NSPointerFunctionsOpaqueMemory|NSPointerFunctionsOpaquePersonality valueOptions:NSPointerFunctionsStrongMemory];
+    
+    _cache = [[NSCache alloc] init];
+    [_cache setName:@"com.kosoku.ksotoken.image-cache"];
+    [_cache setTotalCostLimit:[self.class _defaultByteLimit]];
+    [_cache setDelegate:self];
+    
+    [NSNotificationCenter.defaultCenter addObserver:self selector:@selector(_applicationDidReceiveMemoryWarning:) name:UIApplicationDidReceiveMemoryWarningNotification object:nil];
+    
+    return self;
+}
+
+- (void)cache:(NSCache *)cache willEvictObject:(id)obj {
+    os_unfair_lock_lock(&_lock);
+    
+    NSNumber *cost = [self.costs objectForKey:obj];
+    
+    if (cost != nil) {
+        _byteCount -= MIN(_byteCount, cost.unsignedIntegerValue);
+        
+        [self.costs removeObjectForKey:obj];
+    }
+    
+    os_unfair_lock_unlock(&_lock);
+}
+
++ (KSOTokenImageCache *)sharedImageCache {
+    static KSOTokenImageCache *kRetval;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        kRetval = [[KSOTokenImageCache alloc] init];
+    });
+    return kRetval;
+}
+
+- (UIImage *)imageForKey:(id<NSCopying>)key {
+    UIImage *retval = [self.cache objectForKey:key];
+    
+    os_unfair_lock_lock(&_lock);
+    
+    if (retval == nil) {
+        self.missCount++;
+    }
+    else {
+        self.hitCount++;
+    }
+    
+    os_unfair_lock_unlock(&_lock);
+    
+    return retval;
+}
+- (void)setImage:(UIImage *)image forKey:(id<NSCopying>)key {
+    NSUInteger cost = [self.class _costForImage:image];
+    
+    // removing and adding may evict images, which calls cache:willEvictObject: and takes the lock, so they must be called outside of it
+    [self.cache removeObjectForKey:key];
+    
+    os_unfair_lock_lock(&_lock);
+    
+    [self.costs setObject:@(cost) forKey:image];
+    _byteCount += cost;
+    
+    os_unfair_lock_unlock(&_lock);
+    
+    [self.cache setObject:image forKey:key cost:cost];
+}
+- (void)removeAllImages {
+    [self.cache removeAllObjects];
+}
+- (void)resetStatistics {
+    os_unfair_lock_lock(&_lock);
+    
+    [self setHitCount:0];
+    [self setMissCount:0];
+    
+    os_unfair_lock_unlock(&_lock);
+}
+
+- (NSUInteger)byteLimit {
+    return self.cache.totalCostLimit;
+}
+- (void)setByteLimit:(NSUInteger)byteLimit {
+    [self.cache setTotalCostLimit:byteLimit];
+}
+- (NSUInteger)count {
+    os_unfair_lock_lock(&_lock);
+    
+    NSUInteger retval = self.costs.count;
+    
+    os_unfair_lock_unlock(&_lock);
+    
+    return retval;
+}
+- (NSUInteger)byteCount {
+    os_unfair_lock_lock(&_lock);
+    
+    NSUInteger retval = _byteCount;
+    
+    os_unfair_lock_unlock(&_lock);
+    
+    return retval;
+}
+
+- (void)_applicationDidReceiveMemoryWarning:(NSNotification *)note; {
+    [self removeAllImages];
+}
+
++ (NSUInteger)_costForImage:(UIImage *)image; {
+    CGImageRef imageRef = image.CGImage;
+    
+    if (imageRef == NULL) {
+        return (NSUInteger)(image.size.width * image.scale * image.size.height * image.scale * 4.0);
+    }
+    return CGImageGetBytesPerRow(imageRef) * CGImageGetHeight(imageRef);
+}
++ (NSUInteger)_defaultByteLimit; {
+    return 16 * 1024 * 1024;
+}
+
+@end
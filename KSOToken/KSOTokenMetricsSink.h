@@ -0,0 +1,106 @@
+//
+//  KSOTokenMetricsSink.h
+//  KSOToken
+//
+//  Created by William Towe on 10/17/26.
+//  Copyright © 2021 Kosoku Interactive, LLC. All rights reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+@class KSOTokenTextView;
+
+/**
+ Enum describing the stages of KSOTokenTextView that are measured when it has a metricsSink. Stages nest, so the duration of a stage includes the durations of the stages that ran within it, for example KSOTokenMetricsStageShouldChangeText includes KSOTokenMetricsStageTokenize.
+ */
+typedef NS_ENUM(NSInteger, KSOTokenMetricsStage) {
+    /**
+     Deciding whether to accept a change to the text, which runs for every keystroke.
+     */
+    KSOTokenMetricsStageShouldChangeText = 0,
+    /**
+     Converting text into tokens, including asking the delegate for represented objects.
+     */
+    KSOTokenMetricsStageTokenize,
+    /**
+     Looking up completions for the current text on the main thread, including the completionsCache, refinement and, when completionsExecutionMode is KSOTokenCompletionsExecutionModeMainThread, the synchronous delegate method.
+     */
+    KSOTokenMetricsStageReloadCompletions,
+    /**
+     The lifetime of a completion query sent to the delegate, from when it was created until its results were displayed or it was cancelled. This includes provider latency and the hops between threads.
+     */
+    KSOTokenMetricsStageCompletionOperation,
+    /**
+     Displaying completion models in the completions table view.
+     */
+    KSOTokenMetricsStageSetCompletionModels,
+    /**
+     Providing the image of a token text attachment, either from the token image cache or by rendering it.
+     */
+    KSOTokenMetricsStageRenderToken
+};
+
+/**
+ Enum describing the events of KSOTokenTextView that are counted when it has a metricsSink.
+ */
+typedef NS_ENUM(NSInteger, KSOTokenMetricsCounter) {
+    /**
+     Completions were answered by the completionsCache.
+     */
+    KSOTokenMetricsCounterCompletionCacheHit = 0,
+    /**
+     Completions were not in the completionsCache.
+     */
+    KSOTokenMetricsCounterCompletionCacheMiss,
+    /**
+     A completion query sent to the delegate was superseded before its results were displayed.
+     */
+    KSOTokenMetricsCounterCompletionCancellation,
+    /**
+     The image of a token text attachment was answered by the token image cache.
+     */
+    KSOTokenMetricsCounterTokenImageCacheHit,
+    /**
+     The image of a token text attachment was rendered.
+     */
+    KSOTokenMetricsCounterTokenRendered
+};
+
+/**
+ Protocol for objects that receive the metrics of a KSOTokenTextView, assign one to its metricsSink property. All methods are called on the main thread, immediately after the stage or event they describe, so they should only record what they receive and aggregate it later.
+ 
+ While a sink is assigned, each stage is also emitted as an os_signpost interval with the subsystem "com.kosoku.ksotoken" and the category "Metrics", so the stages show up in Instruments alongside everything else.
+ */
+@protocol KSOTokenMetricsSink <NSObject>
+@required
+/**
+ Called when a stage of *tokenTextView* finishes.
+ 
+ @param tokenTextView The token text view that was measured
+ @param stage The stage that finished
+ @param duration The duration of the stage, in seconds
+ */
+- (void)tokenTextView:(KSOTokenTextView *)tokenTextView didMeasureStage:(KSOTokenMetricsStage)stage duration:(NSTimeInterval)duration;
+/**
+ Called when an event of *tokenTextView* is counted.
+ 
+ @param tokenTextView The token text view that was measured
+ @param counter The counter of the event
+ */
+- (void)tokenTextView:(KSOTokenTextView *)tokenTextView didIncrementCounter:(KSOTokenMetricsCounter)counter;
+@end
+
+NS_ASSUME_NONNULL_END
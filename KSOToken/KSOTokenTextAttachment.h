@@ -64,6 +64,10 @@ NS_ASSUME_NONNULL_BEGIN
  Set and get the tint color used when drawing the attachment. How the tint color is used is up to the implementation. Whenever the tint color of the owning KSOTokenTextView changes, this property will be set on all text attachments if it is implemented.
  */
 @property (strong,nonatomic,nullable) UIColor *tintColor;
+/**
+ Set and get the size of the token before it is limited to the width of the owning KSOTokenTextView. Implement this to let snapshots of the owning KSOTokenTextView save the measured size of the receiver, it is set when a snapshot is restored so the token can be laid out without being measured again. Setting it must not render anything.
+ */
+@property (assign,nonatomic) CGSize tokenSize;
 @end
 
 NS_ASSUME_NONNULL_END
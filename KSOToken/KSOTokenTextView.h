@@ -22,11 +22,43 @@
 #import <KSOToken/KSOTokenCompletionModel.h>
 #import <KSOToken/KSOTokenTextAttachment.h>
 #import <KSOToken/KSOTokenCompletionTableViewCell.h>
+#import <KSOToken/KSOTokenCompletionCache.h>
+#import <KSOToken/KSOTokenCompletionCancellationToken.h>
+#import <KSOToken/KSOTokenCompletionStatistics.h>
+#import <KSOToken/KSOTokenMetricsSink.h>
 
 NS_ASSUME_NONNULL_BEGIN
 
 @protocol KSOTokenTextViewDelegate;
 
+/**
+ Enum describing where the completion delegate methods are called.
+ */
+typedef NS_ENUM(NSInteger, KSOTokenCompletionsExecutionMode) {
+    /**
+     The completion delegate methods are called on the main thread.
+     */
+    KSOTokenCompletionsExecutionModeMainThread = 0,
+    /**
+     The completion delegate methods, including tokenTextView:completionModelsForSubstring:indexOfRepresentedObject:, are called on a serial background queue with a snapshot of the substring and index. Only displaying the results happens on the main thread. The delegate must not access the token text view from these methods.
+     */
+    KSOTokenCompletionsExecutionModeBackground
+};
+
+/**
+ Enum describing how the completion query for a keystroke is scheduled.
+ */
+typedef NS_ENUM(NSInteger, KSOTokenCompletionsSchedulingMode) {
+    /**
+     The query is sent once the user stops typing for completionsDelay.
+     */
+    KSOTokenCompletionsSchedulingModeFixed = 0,
+    /**
+     The receiver measures how long the delegate takes to answer and how fast the user types, and chooses a KSOTokenCompletionsSchedulingPolicy for each keystroke. Delegates that answer within a frame are queried on every keystroke, delegates that answer faster than the user types are queried at most once per answer, and slower delegates are queried once the user pauses. The query is never sent sooner than completionsDelay.
+     */
+    KSOTokenCompletionsSchedulingModeAdaptive
+};
+
 /**
  KSOTokenTextView mirrors the functionality provided by NSTokenField on macOS.
  */
@@ -59,11 +91,65 @@ NS_ASSUME_NONNULL_BEGIN
  */
 @property (strong,nonatomic,null_resettable) Class<KSOTokenTextAttachment> tokenTextAttachmentClass;
 /**
- Set and get the completion delay of the receiver.
+ Set and get the number of tokens above which the receiver collapses its leading tokens into a single token that displays how many there are, for example "+120 more". Only the tokens that remain displayed are laid out, so the cost of layout does not grow with the number of represented objects. Tapping the collapsed token, or deleting backwards into it, displays up to this many more of them.
+ 
+ Tokens are collapsed when represented objects are set or inserted, and only the tokens at the beginning of the text that precede the selection are collapsed. The collapsed represented objects are still part of representedObjects and the indexes passed to the delegate include them. Deleting or cutting a selection that includes the collapsed token removes all of them. Tokens inserted in front of the collapsed token are inserted right after it. The collapsed token is always drawn by KSOTokenDefaultTextAttachment, regardless of tokenTextAttachmentClass.
+ 
+ The default is 0, which never collapses tokens.
+ */
+@property (assign,nonatomic) NSUInteger tokenCollapsingThreshold;
+/**
+ Get the number of represented objects that are collapsed, see tokenCollapsingThreshold.
+ */
+@property (readonly,nonatomic) NSUInteger collapsedRepresentedObjectsCount;
+/**
+ Set and get the completion delay of the receiver. When completionsSchedulingMode is KSOTokenCompletionsSchedulingModeAdaptive this is the minimum delay.
  
  The default is 0.0.
  */
 @property (assign,nonatomic) NSTimeInterval completionsDelay;
+/**
+ Set and get how the receiver schedules the completion query after each keystroke. The chosen policy, the delay and the measured query latency and keystroke interval are reported by completionStatistics in either mode.
+ 
+ The default is KSOTokenCompletionsSchedulingModeFixed.
+ */
+@property (assign,nonatomic) KSOTokenCompletionsSchedulingMode completionsSchedulingMode;
+/**
+ Set and get whether the receiver refines its current completion models when the user extends the substring being completed, rather than asking the delegate for completions again. For example, typing "a", then "ab", then "abc" will only query the delegate for "a" and narrow those results for "ab" and "abc". The delegate is queried again when the substring is shortened or the token range changes.
+ 
+ If the delegate implements tokenTextView:completionModelsForSubstring:indexOfRepresentedObject:refiningCompletionModels: it is used to narrow the previous results, otherwise the completion models whose title contains the substring, ignoring case, are kept and the match of the substring is highlighted in place of their own matching ranges. Delegate methods are always passed the completion models the delegate provided. Do not enable this if the delegate returns a truncated set of completion models.
+ 
+ The default is NO.
+ */
+@property (assign,nonatomic,getter=isCompletionsRefinementEnabled) BOOL completionsRefinementEnabled;
+/**
+ Set and get the completions cache of the receiver. If non-nil, completion models provided by the delegate are stored in the cache and reused when the same substring and index are completed again, without asking the delegate. Call removeAllCompletionModels on the cache whenever the source of completions changes. Calling reloadCompletionsTableView always asks the delegate.
+ 
+ The default is nil.
+ 
+ @see KSOTokenCompletionCache
+ */
+@property (strong,nonatomic,nullable) KSOTokenCompletionCache *completionsCache;
+/**
+ Get the completion statistics of the receiver, which count the completion queries sent to the delegate and whether they completed or were cancelled.
+ 
+ @see KSOTokenCompletionStatistics
+ */
+@property (readonly,strong,nonatomic) KSOTokenCompletionStatistics *completionStatistics;
+/**
+ Set and get the metrics sink of the receiver. While it is set, the receiver measures the duration of its hot paths and counts cache hits, cancellations and rendered tokens, and reports them to it. While it is nil, nothing is measured.
+ 
+ The default is nil.
+ 
+ @see KSOTokenMetricsSink
+ */
+@property (weak,nonatomic,nullable) id<KSOTokenMetricsSink> metricsSink;
+/**
+ Set and get where the completion delegate methods are called. Use KSOTokenCompletionsExecutionModeBackground when the delegate does synchronous work to provide completions, the main thread time of each keystroke is reported by completionStatistics.
+ 
+ The default is KSOTokenCompletionsExecutionModeMainThread.
+ */
+@property (assign,nonatomic) KSOTokenCompletionsExecutionMode completionsExecutionMode;
 /**
  Set and get the completion table view class of the receiver. This must be a subclass of UITableView.
  
@@ -76,11 +162,47 @@ NS_ASSUME_NONNULL_BEGIN
  The default is KSOTokenDefaultCompletionTableViewCell.class.
  */
 @property (strong,nonatomic,null_resettable) Class<KSOTokenCompletionTableViewCell> completionsTableViewCellClass;
+/**
+ Set and get the fixed row height of the completions table view. Set this to a value > 0.0 when every completion row has the same height, the table view then skips self sizing which makes scrolling long lists of completions much cheaper.
+ 
+ The default is UITableViewAutomaticDimension.
+ */
+@property (assign,nonatomic) CGFloat completionsTableViewRowHeight;
 
 /**
  Returns whether the completions table view is currently showing. This can be used to determine when to call showCompletionsTableView and hideCompletionsTableView to manually control display of the completions table view.
  */
 @property (readonly,nonatomic,getter=isCompletionsTableViewShowing) BOOL completionsTableViewShowing;
+/**
+ Get the progress of the paste that is in progress, or nil if there is none. Pastes of large amounts of text, or any text if the delegate implements tokenTextView:representedObjectsForEditingTexts:completion:, are split into token texts off the main thread and their represented objects are resolved in batches, after which all of the tokens are inserted in a single text storage edit. While the paste is in progress, the text of the receiver cannot be edited. The progress can be cancelled, in which case nothing is inserted.
+ 
+ This property is KVO compliant, observe it to show progress to the user.
+ */
+@property (readonly,strong,nonatomic,nullable) NSProgress *pasteProgress;
+
+/**
+ Inserts *representedObjects* as tokens before the token at *index*, or after the last token if *index* is greater than or equal to the number of tokens. All of the tokens are inserted in a single text storage edit and tokenTextView:didAddRepresentedObjects:atIndex: is called once for all of them, which makes this much faster than inserting them one at a time. Unlike user initiated insertions, tokenTextView:shouldAddRepresentedObjects:atIndex: is not called.
+ 
+ @param representedObjects The represented objects to insert
+ @param index The index of the token to insert before
+ */
+- (void)insertRepresentedObjects:(NSArray<id<KSOTokenRepresentedObject>> *)representedObjects atIndex:(NSInteger)index;
+
+/**
+ Returns a compact binary snapshot of the represented objects of the receiver, including collapsed ones, along with the text and measured size of each token. Save it with a draft and pass it to restoreSnapshotData: to show the tokens again much faster than setting representedObjects.
+ 
+ NSString and NSURL represented objects are saved as they are. Other represented objects are saved using tokenTextView:snapshotDataForRepresentedObject:, if the delegate does not implement it or returns nil, they are saved as their display name.
+ 
+ @return The snapshot data
+ */
+- (NSData *)snapshotData;
+/**
+ Replaces the represented objects of the receiver with those saved in *snapshotData*, like setting representedObjects. The tokens display the saved text without asking the represented objects for their display names. If the font of the receiver matches the one the snapshot was taken with, the tokens use their saved sizes and are laid out without being measured, their images are rendered when they are first drawn. Represented objects that were saved using the delegate are restored using tokenTextView:representedObjectForSnapshotData:, or as their display name if it is not implemented or returns nil.
+ 
+ @param snapshotData The data returned from snapshotData
+ @return YES if the snapshot was restored, NO if it is invalid, in which case the receiver is unchanged
+ */
+- (BOOL)restoreSnapshotData:(NSData *)snapshotData;
 
 /**
  Attempts to tokenize the text at the selectedRange of the receiver. Returns YES, if the text was tokenized, otherwise NO. Returns by reference the range of text for which tokenization was attempted.
@@ -89,6 +211,10 @@ NS_ASSUME_NONNULL_BEGIN
  @return YES if the text was tokenized, otherwise NO
  */
 - (BOOL)tokenizeTextAndGetTokenRange:(nullable NSRangePointer)tokenRange;
+/**
+ Displays up to tokenCollapsingThreshold more of the collapsed tokens, or all of them if tokenCollapsingThreshold is 0. This is what tapping the collapsed token does. If no tokens are collapsed, this method does nothing.
+ */
+- (void)expandCollapsedTokens;
 /**
  Returns the token range for the selectedRange of the receiver, but does not attempt to tokenize it. This could be used to highlight the token range after an error, for example. If you want to force the receiver to attempt tokenization of its text, use tokenizeTextAndGetTokenRange: instead. This returns an NSRange with length == 0 on failure.
  
@@ -132,9 +258,25 @@ NS_ASSUME_NONNULL_BEGIN
  @return The represented object for editing text
  */
 - (nullable id<KSOTokenRepresentedObject>)tokenTextView:(KSOTokenTextView *)tokenTextView representedObjectForEditingText:(NSString *)editingText;
+/**
+ Return the represented objects for an array of editing texts, for example the pieces of pasted text. This is preferred over tokenTextView:representedObjectForEditingText: and is called once per edit, which lets the delegate look up all of the editing texts at once. The returned array does not need to contain one represented object per editing text. If this method returns nil, the editing texts are used as the represented objects.
+ 
+ @param tokenTextView The token text view that sent the message
+ @param editingTexts The array of editing texts
+ @return The represented objects for editing texts
+ */
+- (nullable NSArray<id<KSOTokenRepresentedObject>> *)tokenTextView:(KSOTokenTextView *)tokenTextView representedObjectsForEditingTexts:(NSArray<NSString *> *)editingTexts;
+/**
+ Asynchronous version of tokenTextView:representedObjectsForEditingTexts:, *completion* can be invoked on any thread. This is used when pasting text, which is resolved in batches while pasteProgress reports progress. Tokenizing typed text and selecting a completion must insert the new tokens immediately, so they continue to use the synchronous methods.
+ 
+ @param tokenTextView The token text view that sent the message
+ @param editingTexts The array of editing texts
+ @param completion The block to invoke with the represented objects, passing nil uses the editing texts as the represented objects
+ */
+- (void)tokenTextView:(KSOTokenTextView *)tokenTextView representedObjectsForEditingTexts:(NSArray<NSString *> *)editingTexts completion:(void(^)(NSArray<id<KSOTokenRepresentedObject>> * _Nullable representedObjects))completion;
 
 /**
- Return the filtered array of represented objects from the array of provided represented objects that should be added to the token text view.
+ Return the filtered array of represented objects from the array of provided represented objects that should be added to the token text view. This is called exactly once per edit with all of the represented objects the edit would add.
  
  @param tokenTextView The token text view that sent the message
  @param representedObjects The representedObjects that will be added to the token text view
@@ -167,6 +309,31 @@ NS_ASSUME_NONNULL_BEGIN
  @param index The first index of the represented objects that were removed
  */
 - (void)tokenTextView:(KSOTokenTextView *)tokenTextView didRemoveRepresentedObjects:(NSArray<id<KSOTokenRepresentedObject>> *)representedObjects atIndex:(NSInteger)index;
+/**
+ Return the text of the token that stands for the collapsed represented objects, see tokenCollapsingThreshold. If this method is not implemented, "+*count* more" is displayed.
+ 
+ @param tokenTextView The token text view that sent the message
+ @param count The number of collapsed represented objects
+ @return The text of the collapsed token
+ */
+- (NSString *)tokenTextView:(KSOTokenTextView *)tokenTextView textForCollapsedRepresentedObjectsCount:(NSUInteger)count;
+
+/**
+ Return data that can be used to restore *representedObject* from a snapshot, see snapshotData. Return nil to save it as its display name.
+ 
+ @param tokenTextView The token text view that sent the message
+ @param representedObject The represented object to save
+ @return The data to save
+ */
+- (nullable NSData *)tokenTextView:(KSOTokenTextView *)tokenTextView snapshotDataForRepresentedObject:(id<KSOTokenRepresentedObject>)representedObject;
+/**
+ Return the represented object for *snapshotData*, which was returned from tokenTextView:snapshotDataForRepresentedObject:. Return nil to restore it as its display name.
+ 
+ @param tokenTextView The token text view that sent the message
+ @param snapshotData The data that was saved
+ @return The represented object
+ */
+- (nullable id<KSOTokenRepresentedObject>)tokenTextView:(KSOTokenTextView *)tokenTextView representedObjectForSnapshotData:(NSData *)snapshotData;
 
 /**
  Called to determine which editing commands should be displayed by the receiver. The action parameter represents the relevant command (e.g. cut:, copy:, paste:).
@@ -239,6 +406,45 @@ NS_ASSUME_NONNULL_BEGIN
  @param completion The completion block to invoke with the array of completion model objects
  */
 - (void)tokenTextView:(KSOTokenTextView *)tokenTextView completionModelsForSubstring:(NSString *)substring indexOfRepresentedObject:(NSInteger)index completion:(void(^)(NSArray<id<KSOTokenCompletionModel>> * _Nullable completionModels))completion;
+/**
+ Determine the possible completions for the provided substring and index and deliver them in batches by invoking the batch completion block as many times as needed, passing YES for *finished* on the last invocation. The first batch replaces the displayed completions and subsequent batches are inserted after them, so results can be displayed before the entire search is done. Batches delivered after the user changes the substring are ignored, check the *finished* parameter or stop searching at that point. If this method is implemented, it is preferred over tokenTextView:completionModelsForSubstring:indexOfRepresentedObject:completion: and tokenTextView:completionModelsForSubstring:indexOfRepresentedObject:cancellationToken:completion:.
+ 
+ @param tokenTextView The token text view that sent the message
+ @param substring The substring to provide completions for
+ @param index The index of the represented object where the completion would be inserted
+ @param batchCompletion The block to invoke with each batch of completion model objects, pass YES for finished with the final batch, which may be empty
+ */
+- (void)tokenTextView:(KSOTokenTextView *)tokenTextView completionModelsForSubstring:(NSString *)substring indexOfRepresentedObject:(NSInteger)index batchCompletion:(void(^)(NSArray<id<KSOTokenCompletionModel>> * _Nullable completionModels, BOOL finished))batchCompletion;
+/**
+ Behaves like tokenTextView:completionModelsForSubstring:indexOfRepresentedObject:completion: but also passes a *cancellationToken* that is cancelled as soon as the query is superseded, for example by the next keystroke. Long running searches should check isCancelled periodically and return without invoking *completion* once it is YES. If this method is implemented, it is preferred over tokenTextView:completionModelsForSubstring:indexOfRepresentedObject:completion:.
+ 
+ @param tokenTextView The token text view that sent the message
+ @param substring The substring to provide completions for
+ @param index The index of the represented object where the completion would be inserted
+ @param cancellationToken The token that is cancelled when the query is superseded
+ @param completion The completion block to invoke with the array of completion model objects
+ */
+- (void)tokenTextView:(KSOTokenTextView *)tokenTextView completionModelsForSubstring:(NSString *)substring indexOfRepresentedObject:(NSInteger)index cancellationToken:(KSOTokenCompletionCancellationToken *)cancellationToken completion:(void(^)(NSArray<id<KSOTokenCompletionModel>> * _Nullable completionModels))completion;
+/**
+ Behaves like tokenTextView:completionModelsForSubstring:indexOfRepresentedObject:batchCompletion: but also passes a *cancellationToken* that is cancelled as soon as the query is superseded. Stop searching without invoking *batchCompletion* again once isCancelled is YES. If this method is implemented, it is preferred over all other completion methods.
+ 
+ @param tokenTextView The token text view that sent the message
+ @param substring The substring to provide completions for
+ @param index The index of the represented object where the completion would be inserted
+ @param cancellationToken The token that is cancelled when the query is superseded
+ @param batchCompletion The block to invoke with each batch of completion model objects, pass YES for finished with the final batch, which may be empty
+ */
+- (void)tokenTextView:(KSOTokenTextView *)tokenTextView completionModelsForSubstring:(NSString *)substring indexOfRepresentedObject:(NSInteger)index cancellationToken:(KSOTokenCompletionCancellationToken *)cancellationToken batchCompletion:(void(^)(NSArray<id<KSOTokenCompletionModel>> * _Nullable completionModels, BOOL finished))batchCompletion;
+/**
+ Return the subset of *completionModels*, which were previously returned for a shorter substring, that match the provided substring. This is only called if completionsRefinementEnabled is YES. If this method is not implemented the completion models whose title contains substring, ignoring case, are used.
+ 
+ @param tokenTextView The token text view that sent the message
+ @param substring The substring to provide completions for
+ @param index The index of the represented object where the completion would be inserted
+ @param completionModels The completion models previously returned for a shorter substring
+ @return An array of objects conforming to KSOTokenCompletionModel
+ */
+- (nullable NSArray<id<KSOTokenCompletionModel>> *)tokenTextView:(KSOTokenTextView *)tokenTextView completionModelsForSubstring:(NSString *)substring indexOfRepresentedObject:(NSInteger)index refiningCompletionModels:(NSArray<id<KSOTokenCompletionModel>> *)completionModels;
 /**
  Return whether the completions table view should be hidden if no completions were provided from either tokenTextView:completionModelsForSubstring:indexOfRepresentedObject: or tokenTextView:completionModelsForSubstring:indexOfRepresentedObject:completion:. If this method is not implemented or returns YES the tokenTextView:hideCompletionsTableView: method will be called to hide the completions table view.
  
@@ -19,14 +19,44 @@
 
 #import "KSOTokenTextView.h"
 #import "KSOTokenDefaultTextAttachment.h"
+#import "KSOTokenDefaultTextAttachment+Private.h"
+#import "KSOTokenCollapsedTextAttachment.h"
 #import "KSOTokenDefaultCompletionTableViewCell.h"
 #import "KSOTokenCompletionOperation.h"
+#import "KSOTokenCompletionStatistics+Private.h"
+#import "KSOTokenTextView+Private.h"
+#import "KSOTokenTokenizer.h"
+#import "KSOTokenSnapshotFunctions.h"
+#import "KSOTokenCompletionSchedulerFunctions.h"
 
 #import <Ditko/Ditko.h>
 #import <Stanley/Stanley.h>
 
 #import <objc/runtime.h>
 
+// signpost names must be string literals, so each stage needs its own call
+#define KSOTokenMetricsSignpost(function, log, signpostID, stage) \
+switch (stage) { \
+    case KSOTokenMetricsStageShouldChangeText: \
+        function(log, signpostID, "ShouldChangeText"); \
+        break; \
+    case KSOTokenMetricsStageTokenize: \
+        function(log, signpostID, "Tokenize"); \
+        break; \
+    case KSOTokenMetricsStageReloadCompletions: \
+        function(log, signpostID, "ReloadCompletions"); \
+        break; \
+    case KSOTokenMetricsStageCompletionOperation: \
+        function(log, signpostID, "CompletionOperation"); \
+        break; \
+    case KSOTokenMetricsStageSetCompletionModels: \
+        function(log, signpostID, "SetCompletionModels"); \
+        break; \
+    case KSOTokenMetricsStageRenderToken: \
+        function(log, signpostID, "RenderToken"); \
+        break; \
+}
+
 @interface KSOTokenTextViewGestureRecognizerDelegate : NSObject <UIGestureRecognizerDelegate>
 @property (copy,nonatomic) NSArray *gestureRecognizers;
 @property (weak,nonatomic) UITextView *textView;
@@ -76,6 +106,7 @@
 }
 
 - (BOOL)textView:(UITextView *)textView shouldChangeTextInRange:(NSRange)range replacementText:(NSString *)text {
+    KSOTokenMetricsInterval interval = [(KSOTokenTextView *)textView _beginMetricsStage:KSOTokenMetricsStageShouldChangeText];
     BOOL retval = [(id<UITextViewDelegate>)textView textView:textView shouldChangeTextInRange:range replacementText:text];
     
     if (retval &&
@@ -84,6 +115,8 @@
         retval = [self.delegate textView:textView shouldChangeTextInRange:range replacementText:text];
     }
     
+    [(KSOTokenTextView *)textView _endMetricsStage:KSOTokenMetricsStageShouldChangeText interval:interval];
+    
     return retval;
 }
 - (void)textViewDidChangeSelection:(UITextView *)textView {
@@ -103,6 +136,65 @@
 
 @end
 
+// wraps a completion model kept by refinement, its own matching indexes are for the shorter substring it was provided for
+@interface KSOTokenRefinedCompletionModel : NSObject <KSOTokenCompletionModel>
+@property (readonly,strong,nonatomic) id<KSOTokenCompletionModel> completionModel;
+@property (readonly,copy,nonatomic) NSIndexSet *indexes;
+
+- (instancetype)initWithCompletionModel:(id<KSOTokenCompletionModel>)completionModel indexes:(NSIndexSet *)indexes;
+@end
+
+@implementation KSOTokenRefinedCompletionModel
+
+// only equal to another refined completion model, so equality stays symmetric with the completion models it wraps
+- (BOOL)isEqual:(id)object {
+    if (self == object) {
+        return YES;
+    }
+    else if (![object isKindOfClass:KSOTokenRefinedCompletionModel.class]) {
+        return NO;
+    }
+    
+    KSOTokenRefinedCompletionModel *other = (KSOTokenRefinedCompletionModel *)object;
+    
+    return ([self.completionModel isEqual:other.completionModel] &&
+            [self.indexes isEqualToIndexSet:other.indexes]);
+}
+- (NSUInteger)hash {
+    return self.completionModel.hash ^ self.indexes.hash;
+}
+
+// custom completion cells can still call the methods of the wrapped completion model
+- (BOOL)respondsToSelector:(SEL)aSelector {
+    return ([super respondsToSelector:aSelector] ||
+            [self.completionModel respondsToSelector:aSelector]);
+}
+- (id)forwardingTargetForSelector:(SEL)aSelector {
+    return self.completionModel;
+}
+
+- (NSString *)tokenCompletionModelTitle {
+    return self.completionModel.tokenCompletionModelTitle;
+}
+- (NSRange)tokenCompletionModelRange {
+    return NSMakeRange(self.indexes.firstIndex, self.indexes.count);
+}
+- (NSIndexSet *)tokenCompletionModelIndexes {
+    return self.indexes;
+}
+
+- (instancetype)initWithCompletionModel:(id<KSOTokenCompletionModel>)completionModel indexes:(NSIndexSet *)indexes {
+    if (!(self = [super init]))
+        return nil;
+    
+    _completionModel = completionModel;
+    _indexes = [indexes copy];
+    
+    return self;
+}
+
+@end
+
 @interface KSOTokenTextView () <UITextViewDelegate,NSTextStorageDelegate,UIGestureRecognizerDelegate,UITableViewDataSource,UITableViewDelegate>
 @property (strong,nonatomic) KSOTokenTextViewInternalDelegate *internalDelegate;
 @property (strong,nonatomic) KSOTokenTextViewGestureRecognizerDelegate *gestureRecognizerDelegate;
@@ -112,19 +204,74 @@
 @property (strong,nonatomic) UITableView *tableView;
 @property (copy,nonatomic) NSArray<id<KSOTokenCompletionModel> > *completionModels;
 @property (strong,nonatomic) NSOperationQueue *completionOperationQueue;
+// incremented for every completion request, results are only applied if they belong to the latest one
+@property (assign,nonatomic) NSUInteger completionRequestGeneration;
+// measures query latency and keystroke intervals in either scheduling mode, so switching to adaptive starts with what was already measured
+@property (assign,nonatomic) KSOTokenCompletionScheduler completionScheduler;
+// the substring, token range and index that completionModels were provided for, used to refine them
+@property (copy,nonatomic) NSString *completionModelsSubstring;
+@property (assign,nonatomic) NSRange completionModelsTokenRange;
+@property (assign,nonatomic) NSInteger completionModelsIndex;
+
+// character offsets of the token text attachments in textStorage, maintained in textStorage:didProcessEditing:range:changeInLength:
+@property (strong,nonatomic) NSMutableIndexSet *tokenTextAttachmentIndexes;
+// the cached return value of representedObjects, nil when textStorage has changed since it was built
+@property (copy,nonatomic) NSArray *cachedRepresentedObjects;
+// built from font, textColor and textAlignment, which are the only things that invalidate them
+@property (copy,nonatomic) NSDictionary<NSAttributedStringKey, id> *cachedDefaultAttributes;
+@property (copy,nonatomic) NSAttributedString *cachedEmptyAttributedString;
+// the tint color last passed to the token text attachments
+@property (strong,nonatomic) UIColor *tokenTextAttachmentsTintColor;
+// the width last used to limit the width of the token text attachments
+@property (assign,nonatomic) CGFloat tokenTextAttachmentsWidth;
+// the represented objects in front of the displayed tokens, they are owned by collapsedTextAttachment which stands for all of them and is always the first character
+@property (readonly,nonatomic) NSArray *collapsedRepresentedObjects;
+@property (readonly,nonatomic) KSOTokenCollapsedTextAttachment *collapsedTextAttachment;
+@property (assign,nonatomic) BOOL needsLayoutTokenTextAttachments;
+@property (strong,nonatomic) KSOTokenTokenizer *tokenizer;
+@property (readwrite,strong,nonatomic) NSProgress *pasteProgress;
 
 - (void)_KSOTokenTextViewInit;
 
 - (BOOL)_tokenizeTextInRange:(NSRange)range tokenRange:(NSRangePointer)tokenRange;
 - (NSRange)_tokenRangeForRange:(NSRange)range;
 - (NSUInteger)_indexOfTokenTextAttachmentInRange:(NSRange)range textAttachment:(id<KSOTokenTextAttachment> *)textAttachment;
+- (void)_updateTokenTextAttachmentIndexesForEditedRange:(NSRange)editedRange changeInLength:(NSInteger)delta;
+- (NSUInteger)_locationOfTokenTextAttachmentAtIndex:(NSUInteger)index;
+- (void)_layoutTokenTextAttachmentsIfNeeded;
 - (NSArray *)_copyTokenTextAttachmentsInRange:(NSRange)range;
 - (NSTextAttachment<KSOTokenTextAttachment> *)_textAttachmentWithRepresentedObject:(id<KSOTokenRepresentedObject>)representedObject text:(NSString *)text;
+- (NSDictionary<NSAttributedStringKey, id> *)_defaultAttributes;
+- (void)_invalidateDefaultAttributes;
 - (NSAttributedString *)_emptyAttributedStringWithDefaultAttributes;
+- (void)_enumerateTokenTextAttachmentsUsingBlock:(void(^)(id<KSOTokenTextAttachment> textAttachment))block;
+- (NSAttributedString *)_attributedStringWithRepresentedObjects:(NSArray<id<KSOTokenRepresentedObject>> *)representedObjects;
+- (NSAttributedString *)_attributedStringWithRepresentedObjects:(NSArray<id<KSOTokenRepresentedObject>> *)representedObjects texts:(NSArray<NSString *> *)texts tokenSizes:(const CGSize *)tokenSizes;
+- (NSAttributedString *)_attributedStringWithCollapsedRepresentedObjects:(NSArray *)collapsedRepresentedObjects representedObjects:(NSArray<id<KSOTokenRepresentedObject>> *)representedObjects;
+- (NSAttributedString *)_attributedStringWithCollapsedRepresentedObjects:(NSArray *)collapsedRepresentedObjects representedObjects:(NSArray<id<KSOTokenRepresentedObject>> *)representedObjects texts:(NSArray<NSString *> *)texts tokenSizes:(const CGSize *)tokenSizes;
+- (void)_setRepresentedObjects:(NSArray *)representedObjects texts:(NSArray<NSString *> *)texts tokenSizes:(const CGSize *)tokenSizes;
+- (void)_collapseTokensIfNeeded;
+- (void)_expandCollapsedTokens;
+- (NSArray *)_representedObjectsForEditingTexts:(NSArray<NSString *> *)editingTexts;
+- (NSArray *)_shouldAddRepresentedObjects:(NSArray *)representedObjects atIndex:(NSInteger)index;
+
+- (NSRange)_insertionRangeForRange:(NSRange)range;
+- (void)_pasteStrings:(NSArray<NSString *> *)strings range:(NSRange)range;
+- (void)_resolvePastedTokenTexts:(NSArray<NSString *> *)tokenTexts representedObjects:(NSMutableArray *)representedObjects range:(NSRange)range progress:(NSProgress *)progress;
+- (void)_insertPastedRepresentedObjects:(NSArray *)representedObjects index:(NSInteger)index range:(NSRange)range;
 
 - (void)_showCompletionsTableView;
 - (void)_hideCompletionsTableViewAndSelectCompletionModel:(id<KSOTokenCompletionModel>)completionModel;
-- (void)_reloadCompletionsTableView;
+- (void)_updateCompletionsTableViewRowHeight;
+- (void)_reloadCompletionsTableViewIgnoringCache:(BOOL)ignoringCache;
+- (BOOL)_requestCompletionModelsIgnoringCache:(BOOL)ignoringCache;
+- (BOOL)_refineCompletionModelsForSubstring:(NSString *)substring tokenRange:(NSRange)tokenRange index:(NSInteger)index;
+- (id<KSOTokenCompletionModel>)_completionModelForDelegate:(id<KSOTokenCompletionModel>)completionModel;
+- (NSArray<id<KSOTokenCompletionModel>> *)_completionModelsForDelegate:(NSArray<id<KSOTokenCompletionModel>> *)completionModels;
+- (void)_setCompletionModels:(NSArray<id<KSOTokenCompletionModel>> *)completionModels substring:(NSString *)substring tokenRange:(NSRange)tokenRange index:(NSInteger)index;
+- (void)_appendCompletionModels:(NSArray<id<KSOTokenCompletionModel>> *)completionModels;
+- (void)_updateCompletionsTableViewFromCompletionModels:(NSArray<id<KSOTokenCompletionModel>> *)oldCompletionModels;
+- (void)_recordCompletionScheduler;
 
 + (NSCharacterSet *)_defaultTokenizingCharacterSet;
 + (Class<KSOTokenTextAttachment>)_defaultTokenTextAttachmentClass;
@@ -132,6 +279,10 @@
 + (Class)_defaultCompletionTableViewClass;
 + (Class<KSOTokenCompletionTableViewCell>)_defaultCompletionTableViewCellClass;
 + (UIColor *)_defaultTextColor;
++ (NSUInteger)_bulkPasteLengthThreshold;
++ (NSUInteger)_bulkPasteBatchSize;
++ (NSUInteger)_maximumDiffableCompletionModelsCount;
++ (os_log_t)_metricsLog;
 @end
 
 @implementation KSOTokenTextView
@@ -153,6 +304,26 @@
     return self;
 }
 #pragma mark -
+- (void)layoutSubviews {
+    [super layoutSubviews];
+    
+    CGFloat width = CGRectGetWidth(self.frame);
+    
+    // scrolling also lays out subviews, only a change in width affects the tokens
+    if (width == self.tokenTextAttachmentsWidth) {
+        return;
+    }
+    
+    [self setTokenTextAttachmentsWidth:width];
+    
+    // tokens are limited to the width of the text view, for example after a rotation or a split view resize
+    [self _enumerateTokenTextAttachmentsUsingBlock:^(id<KSOTokenTextAttachment> textAttachment) {
+        if ([textAttachment isKindOfClass:KSOTokenDefaultTextAttachment.class]) {
+            [(KSOTokenDefaultTextAttachment *)textAttachment _maximumImageWidthDidChange];
+        }
+    }];
+}
+#pragma mark -
 - (BOOL)canPerformAction:(SEL)action withSender:(id)sender {
     if ([self.delegate respondsToSelector:@selector(tokenTextView:canPerformAction:withSender:)]) {
         return [self.delegate tokenTextView:self canPerformAction:action withSender:sender];
@@ -200,98 +371,93 @@
     [self _copyTokenTextAttachmentsInRange:self.selectedRange];
 }
 - (void)paste:(id)sender {
-    NSArray *representedObjects;
-    NSInteger index = [self _indexOfTokenTextAttachmentInRange:self.selectedRange textAttachment:NULL];
+    // a large paste is still being tokenized
+    if (self.pasteProgress != nil) {
+        return;
+    }
+    
     UIPasteboard *pasteboard = [UIPasteboard generalPasteboard];
     
+    NSRange range = [self _insertionRangeForRange:self.selectedRange];
+    
     if ([self.delegate respondsToSelector:@selector(tokenTextView:readFromPasteboard:)]) {
-        representedObjects = [self.delegate tokenTextView:self readFromPasteboard:pasteboard];
-    }
-    else {
-        NSMutableArray *temp = [[NSMutableArray alloc] init];
-        NSCharacterSet *characterSet = self.tokenizingCharacterSet;
-        
-        for (NSString *string in pasteboard.strings) {
-            for (NSString *subString in [string componentsSeparatedByCharactersInSet:characterSet]) {
-                NSString *tokenText = [subString stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceAndNewlineCharacterSet]];
-                id representedObject = tokenText;
-                
-                if ([self.delegate respondsToSelector:@selector(tokenTextView:representedObjectForEditingText:)]) {
-                    representedObject = [self.delegate tokenTextView:self representedObjectForEditingText:tokenText];
-                }
-                
-                [temp addObject:representedObject];
-            }
-        }
+        NSInteger index = [self _indexOfTokenTextAttachmentInRange:range textAttachment:NULL];
         
-        if (temp.count > 0) {
-            if ([self.delegate respondsToSelector:@selector(tokenTextView:shouldAddRepresentedObjects:atIndex:)]) {
-                representedObjects = [self.delegate tokenTextView:self shouldAddRepresentedObjects:temp atIndex:index];
-            }
-            else {
-                representedObjects = temp;
-            }
-        }
+        [self _insertPastedRepresentedObjects:[self.delegate tokenTextView:self readFromPasteboard:pasteboard] index:index range:range];
+        return;
     }
     
-    if (representedObjects.count > 0) {
-        NSMutableAttributedString *temp = [[self _emptyAttributedStringWithDefaultAttributes] mutableCopy];
-        
-        // loop through each represented object and ask the delegate for the display text for each one
-        for (id<KSOTokenRepresentedObject> representedObject in representedObjects) {
-            NSString *displayText = representedObject.tokenRepresentedObjectDisplayName;
-            
-            [temp appendAttributedString:[NSAttributedString attributedStringWithAttachment:[self _textAttachmentWithRepresentedObject:representedObject text:displayText]]];
-        }
-        
-        NSMutableArray *deletedRepresentedObjects = [[NSMutableArray alloc] init];
-        
-        if (self.selectedRange.length > 0) {
-            [self.textStorage enumerateAttribute:NSAttachmentAttributeName inRange:self.selectedRange options:NSAttributedStringEnumerationLongestEffectiveRangeNotRequired usingBlock:^(id<KSOTokenTextAttachment> _Nullable value, NSRange range, BOOL * _Nonnull stop) {
-                if (value.representedObject != nil) {
-                    [deletedRepresentedObjects addObject:value.representedObject];
-                }
-            }];
-        }
-        
-        NSRange newSelectedRange = NSMakeRange(self.selectedRange.location + temp.length, 0);
-        
-        // replace all characters in token range with the text attachments
-        [self.textStorage replaceCharactersInRange:self.selectedRange withAttributedString:temp];
-        
-        [self setSelectedRange:newSelectedRange];
-        
-        // hide the completion table view if it was visible
-        [self _hideCompletionsTableViewAndSelectCompletionModel:nil];
-        
-        if ([self.delegate respondsToSelector:@selector(tokenTextView:didAddRepresentedObjects:atIndex:)]) {
-            [self.delegate tokenTextView:self didAddRepresentedObjects:representedObjects atIndex:index];
-        }
+    NSArray<NSString *> *strings = pasteboard.strings;
+    NSUInteger length = 0;
+    
+    for (NSString *string in strings) {
+        length += string.length;
+    }
+    
+    // the async delegate method can only be used by the paste pipeline
+    if (length >= [self.class _bulkPasteLengthThreshold] ||
+        [self.delegate respondsToSelector:@selector(tokenTextView:representedObjectsForEditingTexts:completion:)]) {
         
-        if (deletedRepresentedObjects.count > 0) {
-            if ([self.delegate respondsToSelector:@selector(tokenTextView:didRemoveRepresentedObjects:atIndex:)]) {
-                [self.delegate tokenTextView:self didRemoveRepresentedObjects:deletedRepresentedObjects atIndex:MAX(0, index - 1)];
-            }
-        }
+        [self _pasteStrings:strings range:range];
+        return;
+    }
+    
+    NSMutableArray *tokenTexts = [[NSMutableArray alloc] init];
+    
+    for (NSString *string in strings) {
+        [tokenTexts addObjectsFromArray:[self.tokenizer tokenTextsInString:string]];
     }
+    
+    NSInteger index = [self _indexOfTokenTextAttachmentInRange:range textAttachment:NULL];
+    
+    [self _insertPastedRepresentedObjects:[self _shouldAddRepresentedObjects:[self _representedObjectsForEditingTexts:tokenTexts] atIndex:index] index:index range:range];
 }
 #pragma mark -
 - (void)tintColorDidChange {
     [super tintColorDidChange];
     
-    [self.textStorage enumerateAttribute:NSAttachmentAttributeName inRange:NSMakeRange(0, self.textStorage.length) options:NSAttributedStringEnumerationLongestEffectiveRangeNotRequired usingBlock:^(id  _Nullable value, NSRange range, BOOL * _Nonnull stop) {
-        if ([value respondsToSelector:@selector(setTintColor:)]) {
-            [value setTintColor:self.tintColor];
+    UIColor *tintColor = self.tintColor;
+    
+    // this is also called when the tint adjustment mode changes or the view moves, which often leaves the tint color as it was
+    if ([tintColor isEqual:self.tokenTextAttachmentsTintColor]) {
+        return;
+    }
+    
+    [self setTokenTextAttachmentsTintColor:tintColor];
+    
+    [self _enumerateTokenTextAttachmentsUsingBlock:^(id<KSOTokenTextAttachment> textAttachment) {
+        if ([textAttachment respondsToSelector:@selector(setTintColor:)]) {
+            [textAttachment setTintColor:tintColor];
+        }
+    }];
+}
+- (void)traitCollectionDidChange:(UITraitCollection *)previousTraitCollection {
+    [super traitCollectionDidChange:previousTraitCollection];
+    
+    if (![self.traitCollection hasDifferentColorAppearanceComparedToTraitCollection:previousTraitCollection]) {
+        return;
+    }
+    
+    // the default attachments render with resolved colors, so they must render again in the new appearance
+    [self _enumerateTokenTextAttachmentsUsingBlock:^(id<KSOTokenTextAttachment> textAttachment) {
+        if ([textAttachment isKindOfClass:KSOTokenDefaultTextAttachment.class]) {
+            [(KSOTokenDefaultTextAttachment *)textAttachment _setNeedsUpdateImages];
         }
     }];
 }
 #pragma mark -
 - (void)setUserInteractionEnabled:(BOOL)userInteractionEnabled {
+    BOOL changed = userInteractionEnabled != self.isUserInteractionEnabled;
+    
     [super setUserInteractionEnabled:userInteractionEnabled];
     
-    [self.textStorage enumerateAttribute:NSAttachmentAttributeName inRange:NSMakeRange(0, self.textStorage.length) options:NSAttributedStringEnumerationLongestEffectiveRangeNotRequired usingBlock:^(id  _Nullable value, NSRange range, BOOL * _Nonnull stop) {
-        if ([value respondsToSelector:@selector(setEnabled:)]) {
-            [value setEnabled:userInteractionEnabled];
+    if (!changed) {
+        return;
+    }
+    
+    [self _enumerateTokenTextAttachmentsUsingBlock:^(id<KSOTokenTextAttachment> textAttachment) {
+        if ([textAttachment respondsToSelector:@selector(setEnabled:)]) {
+            [textAttachment setEnabled:userInteractionEnabled];
         }
     }];
 }
@@ -299,9 +465,16 @@
 - (void)setFont:(UIFont *)font {
     [super setFont:font];
     
-    [self.textStorage enumerateAttribute:NSAttachmentAttributeName inRange:NSMakeRange(0, self.textStorage.length) options:NSAttributedStringEnumerationLongestEffectiveRangeNotRequired usingBlock:^(id  _Nullable value, NSRange range, BOOL * _Nonnull stop) {
-        if ([value respondsToSelector:@selector(setFont:)]) {
-            [value setFont:self.font];
+    [self _invalidateDefaultAttributes];
+    
+    UIFont *newFont = self.font;
+    
+    // only restyle the attachments whose font actually changed, each one that does renders again
+    [self _enumerateTokenTextAttachmentsUsingBlock:^(id<KSOTokenTextAttachment> textAttachment) {
+        if ([textAttachment respondsToSelector:@selector(setFont:)] &&
+            ![textAttachment.font isEqual:newFont]) {
+            
+            [textAttachment setFont:newFont];
         }
     }];
 }
@@ -310,26 +483,62 @@
 }
 - (void)setTextColor:(UIColor *)textColor {
     [super setTextColor:textColor ?: [self.class _defaultTextColor]];
+    
+    [self _invalidateDefaultAttributes];
+}
+- (void)setTextAlignment:(NSTextAlignment)textAlignment {
+    [super setTextAlignment:textAlignment];
+    
+    [self _invalidateDefaultAttributes];
 }
 #pragma mark NSTextStorageDelegate
 - (void)textStorage:(NSTextStorage *)textStorage didProcessEditing:(NSTextStorageEditActions)editedMask range:(NSRange)editedRange changeInLength:(NSInteger)delta {
+    [self.tokenizer invalidate];
+    
+    [self _updateTokenTextAttachmentIndexesForEditedRange:editedRange changeInLength:delta];
+    
     // fix up our attributes so that everything, including the attachments, use our desired font and text color
-    [textStorage addAttributes:@{NSFontAttributeName: self.font, NSForegroundColorAttributeName: self.textColor, NSParagraphStyleAttributeName: [NSParagraphStyle KDI_paragraphStyleWithTextAlignment:self.textAlignment]} range:editedRange];
+    [textStorage addAttributes:[self _defaultAttributes] range:editedRange];
 }
 #pragma mark UITextViewDelegate
 - (BOOL)textView:(UITextView *)textView shouldChangeTextInRange:(NSRange)range replacementText:(NSString *)text {
-    if ([text rangeOfCharacterFromSet:self.tokenizingCharacterSet].length > 0) {
+    // the pasted tokens replace the range that was selected when the paste began, it must not change until they are inserted
+    if (self.pasteProgress != nil) {
+        return NO;
+    }
+    // the collapsed token must stay the first character
+    else if (self.collapsedTextAttachment != nil &&
+             NSEqualRanges(range, NSMakeRange(0, 0))) {
+        
+        return NO;
+    }
+    else if ([text rangeOfCharacterFromSet:self.tokenizingCharacterSet].length > 0) {
         [self _tokenizeTextInRange:range tokenRange:NULL];
         return NO;
     }
     // delete
     else if (text.length == 0) {
         if (self.text.length > 0) {
+            // deleting backwards into the collapsed token displays more of the tokens it stands for, rather than deleting all of them
+            if (self.collapsedTextAttachment != nil &&
+                self.selectedRange.length == 0 &&
+                NSEqualRanges(range, NSMakeRange(0, 1))) {
+                
+                [self _expandCollapsedTokens];
+                return NO;
+            }
+            
             NSMutableArray *representedObjects = [[NSMutableArray alloc] init];
             
             // enumerate text attachments in the range to be deleted and add their represented object to the array
             [self.textStorage enumerateAttribute:NSAttachmentAttributeName inRange:range options:NSAttributedStringEnumerationLongestEffectiveRangeNotRequired usingBlock:^(id<KSOTokenTextAttachment> value, NSRange range, BOOL *stop) {
-                if (value) {
+                if (value == nil) {
+                    return;
+                }
+                else if ([value isKindOfClass:KSOTokenCollapsedTextAttachment.class]) {
+                    [representedObjects addObjectsFromArray:((KSOTokenCollapsedTextAttachment *)value).collapsedRepresentedObjects];
+                }
+                else {
                     [representedObjects addObject:value.representedObject];
                 }
             }];
@@ -344,9 +553,7 @@
                 }
             }
             
-            NSAttributedString *temp = [[NSAttributedString alloc] initWithString:@"" attributes:@{NSFontAttributeName: self.font, NSForegroundColorAttributeName: self.textColor, NSParagraphStyleAttributeName: [NSParagraphStyle KDI_paragraphStyleWithTextAlignment:self.textAlignment]}];
-            
-            [self.textStorage replaceCharactersInRange:range withAttributedString:temp];
+            [self.textStorage replaceCharactersInRange:range withAttributedString:[self _emptyAttributedStringWithDefaultAttributes]];
             
             [self setSelectedRange:NSMakeRange(range.location, 0)];
             
@@ -379,13 +586,15 @@
 - (void)textViewDidChange:(UITextView *)textView {
     [NSObject cancelPreviousPerformRequestsWithTarget:self selector:@selector(_showCompletionsTableView) object:nil];
     
-    [self performSelector:@selector(_showCompletionsTableView) withObject:nil afterDelay:self.completionsDelay];
+    NSTimeInterval delay = KSOTokenCompletionSchedulerKeystroke(&_completionScheduler, CACurrentMediaTime());
+    
+    [self _recordCompletionScheduler];
+    
+    // a throttled keystroke keeps the time of the query it is waiting on, a debounced one pushes it out
+    [self performSelector:@selector(_showCompletionsTableView) withObject:nil afterDelay:self.completionsSchedulingMode == KSOTokenCompletionsSchedulingModeAdaptive ? MAX(self.completionsDelay, delay) : self.completionsDelay];
 }
 - (void)textViewDidChangeSelection:(UITextView *)textView {
-    [self setTypingAttributes:@{NSFontAttributeName: self.font,
-                                NSForegroundColorAttributeName: self.textColor,
-                                NSParagraphStyleAttributeName: [NSParagraphStyle KDI_paragraphStyleWithTextAlignment:self.textAlignment]
-                                }];
+    [self setTypingAttributes:[self _defaultAttributes]];
     
     if (self.selectedRange.length == 0) {
         [self setSelectedTextAttachmentRanges:nil];
@@ -420,24 +629,24 @@
 #pragma mark UITableViewDelegate
 - (UISwipeActionsConfiguration *)tableView:(UITableView *)tableView leadingSwipeActionsConfigurationForRowAtIndexPath:(NSIndexPath *)indexPath {
     if ([self.delegate respondsToSelector:@selector(tokenTextView:leadingSwipeActionsConfigurationForCompletionModel:)]) {
-        return [self.delegate tokenTextView:self leadingSwipeActionsConfigurationForCompletionModel:self.completionModels[indexPath.row]];
+        return [self.delegate tokenTextView:self leadingSwipeActionsConfigurationForCompletionModel:[self _completionModelForDelegate:self.completionModels[indexPath.row]]];
     }
     return nil;
 }
 - (UISwipeActionsConfiguration *)tableView:(UITableView *)tableView trailingSwipeActionsConfigurationForRowAtIndexPath:(NSIndexPath *)indexPath {
     if ([self.delegate respondsToSelector:@selector(tokenTextView:trailingSwipeActionsConfigurationForCompletionModel:)]) {
-        return [self.delegate tokenTextView:self trailingSwipeActionsConfigurationForCompletionModel:self.completionModels[indexPath.row]];
+        return [self.delegate tokenTextView:self trailingSwipeActionsConfigurationForCompletionModel:[self _completionModelForDelegate:self.completionModels[indexPath.row]]];
     }
     return nil;
 }
 - (void)tableView:(UITableView *)tableView willDisplayCell:(UITableViewCell *)cell forRowAtIndexPath:(NSIndexPath *)indexPath {
     if ([self.delegate respondsToSelector:@selector(tokenTextView:willDisplayCompletionTableViewCell:completionModel:)]) {
-        [self.delegate tokenTextView:self willDisplayCompletionTableViewCell:(UITableViewCell<KSOTokenCompletionTableViewCell> *)cell completionModel:self.completionModels[indexPath.row]];
+        [self.delegate tokenTextView:self willDisplayCompletionTableViewCell:(UITableViewCell<KSOTokenCompletionTableViewCell> *)cell completionModel:[self _completionModelForDelegate:self.completionModels[indexPath.row]]];
     }
 }
 - (void)tableView:(UITableView *)tableView didSelectRowAtIndexPath:(NSIndexPath *)indexPath {
     // hide the completions table view and insert the selected completion
-    [self _hideCompletionsTableViewAndSelectCompletionModel:self.completionModels[indexPath.row]];
+    [self _hideCompletionsTableViewAndSelectCompletionModel:[self _completionModelForDelegate:self.completionModels[indexPath.row]]];
 }
 #pragma mark Properties
 @dynamic delegate;
@@ -454,9 +663,170 @@
     }
 }
 #pragma mark *** Public Methods ***
+- (void)insertRepresentedObjects:(NSArray<id<KSOTokenRepresentedObject>> *)representedObjects atIndex:(NSInteger)index; {
+    if (representedObjects.count == 0) {
+        return;
+    }
+    
+    NSArray *collapsedRepresentedObjects = self.collapsedRepresentedObjects;
+    NSUInteger collapsedCount = collapsedRepresentedObjects.count;
+    NSUInteger count = collapsedCount + self.tokenTextAttachmentIndexes.count;
+    NSUInteger clampedIndex = (NSUInteger)MIN(MAX(index, 0), (NSInteger)count);
+    NSRange range;
+    NSAttributedString *temp;
+    NSRange selectedRange = self.selectedRange;
+    
+    // inserting among the collapsed tokens only changes the count displayed by the collapsed token
+    if (clampedIndex < collapsedCount) {
+        NSMutableArray *insertedCollapsedRepresentedObjects = [collapsedRepresentedObjects mutableCopy];
+        
+        [insertedCollapsedRepresentedObjects replaceObjectsInRange:NSMakeRange(clampedIndex, 0) withObjectsFromArray:representedObjects];
+        
+        range = NSMakeRange(0, 1);
+        temp = [self _attributedStringWithCollapsedRepresentedObjects:insertedCollapsedRepresentedObjects representedObjects:@[]];
+    }
+    else {
+        range = NSMakeRange([self _locationOfTokenTextAttachmentAtIndex:clampedIndex - collapsedCount], 0);
+        temp = [self _attributedStringWithRepresentedObjects:representedObjects];
+    }
+    
+    [self.textStorage beginEditing];
+    [self.textStorage replaceCharactersInRange:range withAttributedString:temp];
+    [self.textStorage endEditing];
+    
+    // keep the selection on the same characters
+    if (selectedRange.location >= NSMaxRange(range)) {
+        selectedRange.location += temp.length - range.length;
+    }
+    
+    [self setSelectedRange:selectedRange];
+    [self _collapseTokensIfNeeded];
+    
+    if ([self.delegate respondsToSelector:@selector(tokenTextView:didAddRepresentedObjects:atIndex:)]) {
+        [self.delegate tokenTextView:self didAddRepresentedObjects:representedObjects atIndex:clampedIndex];
+    }
+}
 - (BOOL)tokenizeTextAndGetTokenRange:(NSRangePointer)tokenRange; {
     return [self _tokenizeTextInRange:self.selectedRange tokenRange:tokenRange];
 }
+- (void)expandCollapsedTokens; {
+    [self _expandCollapsedTokens];
+}
+- (NSData *)snapshotData; {
+    NSUInteger count = self.collapsedRepresentedObjects.count + self.tokenTextAttachmentIndexes.count;
+    NSString *fontName = self.font.fontName;
+    KSOTokenSnapshotHeader header = {(const uint8_t *)fontName.UTF8String, [fontName lengthOfBytesUsingEncoding:NSUTF8StringEncoding], (float)self.font.pointSize, count};
+    __block KSOTokenSnapshotWriter writer;
+    
+    // most tokens take less than 32 bytes
+    if (!KSOTokenSnapshotWriterInit(&writer, 32 + count * 32)) {
+        return [[NSData alloc] init];
+    }
+    
+    __block BOOL success = KSOTokenSnapshotWriteHeader(&writer, &header);
+    BOOL respondsToSnapshotData = [self.delegate respondsToSelector:@selector(tokenTextView:snapshotDataForRepresentedObject:)];
+    void(^writeRecord)(id<KSOTokenRepresentedObject>, id<KSOTokenTextAttachment>) = ^(id<KSOTokenRepresentedObject> representedObject, id<KSOTokenTextAttachment> textAttachment){
+        KSOTokenSnapshotRecord record = {KSOTokenSnapshotRecordKindString, NULL, 0, 0.0, 0.0, NULL, 0};
+        NSString *text = representedObject.tokenRepresentedObjectDisplayName;
+        NSData *payload = respondsToSnapshotData ? [self.delegate tokenTextView:self snapshotDataForRepresentedObject:representedObject] : nil;
+        NSString *URLString = nil;
+        
+        if (payload != nil) {
+            record.kind = KSOTokenSnapshotRecordKindData;
+            record.payload = payload.bytes;
+            record.payloadLength = payload.length;
+        }
+        else if ([(id)representedObject isKindOfClass:NSURL.class]) {
+            URLString = [(NSURL *)representedObject absoluteString];
+            
+            record.kind = KSOTokenSnapshotRecordKindURL;
+            record.payload = (const uint8_t *)URLString.UTF8String;
+            record.payloadLength = [URLString lengthOfBytesUsingEncoding:NSUTF8StringEncoding];
+        }
+        
+        record.text = (const uint8_t *)text.UTF8String;
+        record.textLength = [text lengthOfBytesUsingEncoding:NSUTF8StringEncoding];
+        
+        // collapsed represented objects do not have an attachment and are measured when they are expanded
+        if ([textAttachment respondsToSelector:@selector(tokenSize)]) {
+            CGSize size = textAttachment.tokenSize;
+            
+            record.width = (float)size.width;
+            record.height = (float)size.height;
+        }
+        
+        success = success && KSOTokenSnapshotWriteRecord(&writer, &record);
+    };
+    
+    for (id<KSOTokenRepresentedObject> representedObject in self.collapsedRepresentedObjects) {
+        writeRecord(representedObject, nil);
+    }
+    
+    [self.tokenTextAttachmentIndexes enumerateRangesUsingBlock:^(NSRange range, BOOL * _Nonnull stop) {
+        [self.textStorage enumerateAttribute:NSAttachmentAttributeName inRange:range options:NSAttributedStringEnumerationLongestEffectiveRangeNotRequired usingBlock:^(id<KSOTokenTextAttachment> _Nullable value, NSRange valueRange, BOOL * _Nonnull stop) {
+            writeRecord(value.representedObject, value);
+        }];
+    }];
+    
+    NSData *retval = success ? [[NSData alloc] initWithBytes:writer.bytes length:writer.length] : [[NSData alloc] init];
+    
+    KSOTokenSnapshotWriterDestroy(&writer);
+    
+    return retval;
+}
+- (BOOL)restoreSnapshotData:(NSData *)snapshotData; {
+    KSOTokenSnapshotReader reader;
+    KSOTokenSnapshotHeader header;
+    
+    KSOTokenSnapshotReaderInit(&reader, snapshotData.bytes, snapshotData.length);
+    
+    if (!KSOTokenSnapshotReadHeader(&reader, &header)) {
+        return NO;
+    }
+    
+    NSString *fontName = [[NSString alloc] initWithBytes:header.fontName length:header.fontNameLength encoding:NSUTF8StringEncoding];
+    // the saved sizes are only valid for the font they were measured with
+    BOOL usesTokenSizes = ([fontName isEqualToString:self.font.fontName] &&
+                           header.fontSize == (float)self.font.pointSize);
+    NSMutableArray *representedObjects = [[NSMutableArray alloc] initWithCapacity:header.count];
+    NSMutableArray *texts = [[NSMutableArray alloc] initWithCapacity:header.count];
+    NSMutableData *tokenSizes = usesTokenSizes ? [[NSMutableData alloc] initWithLength:sizeof(CGSize) * header.count] : nil;
+    CGSize *tokenSizesBytes = tokenSizes.mutableBytes;
+    BOOL respondsToSnapshotData = [self.delegate respondsToSelector:@selector(tokenTextView:representedObjectForSnapshotData:)];
+    
+    for (size_t i=0; i<header.count; i++) {
+        KSOTokenSnapshotRecord record;
+        
+        if (!KSOTokenSnapshotReadRecord(&reader, &record)) {
+            return NO;
+        }
+        
+        NSString *text = [[NSString alloc] initWithBytes:record.text length:record.textLength encoding:NSUTF8StringEncoding] ?: @"";
+        id<KSOTokenRepresentedObject> representedObject = nil;
+        
+        if (record.kind == KSOTokenSnapshotRecordKindURL) {
+            NSString *URLString = [[NSString alloc] initWithBytes:record.payload length:record.payloadLength encoding:NSUTF8StringEncoding];
+            
+            representedObject = URLString == nil ? nil : [NSURL URLWithString:URLString];
+        }
+        else if (record.kind == KSOTokenSnapshotRecordKindData &&
+                 respondsToSnapshotData) {
+            
+            representedObject = [self.delegate tokenTextView:self representedObjectForSnapshotData:[[NSData alloc] initWithBytes:record.payload length:record.payloadLength]];
+        }
+        
+        [representedObjects addObject:representedObject ?: text];
+        [texts addObject:text];
+        
+        if (tokenSizesBytes != NULL) {
+            tokenSizesBytes[i] = CGSizeMake(record.width, record.height);
+        }
+    }
+    
+    [self _setRepresentedObjects:representedObjects texts:texts tokenSizes:tokenSizesBytes];
+    
+    return YES;
+}
 - (NSRange)tokenRangeForSelectedRange; {
     return [self _tokenRangeForRange:self.selectedRange];
 }
@@ -474,38 +844,62 @@
         return;
     }
     
-    [self _reloadCompletionsTableView];
+    [self _reloadCompletionsTableViewIgnoringCache:YES];
 }
 #pragma mark Properties
 @dynamic representedObjects;
 - (NSArray *)representedObjects {
-    NSMutableArray *retval = [[NSMutableArray alloc] init];
-    
-    [self.textStorage enumerateAttribute:NSAttachmentAttributeName inRange:NSMakeRange(0, self.textStorage.length) options:NSAttributedStringEnumerationLongestEffectiveRangeNotRequired usingBlock:^(id<KSOTokenTextAttachment> value, NSRange range, BOOL *stop) {
-        if (value) {
-            [retval addObject:value.representedObject];
-        }
-    }];
-    
-    return retval;
+    if (self.cachedRepresentedObjects == nil) {
+        NSMutableArray *retval = [[NSMutableArray alloc] initWithCapacity:self.collapsedRepresentedObjects.count + self.tokenTextAttachmentIndexes.count];
+        
+        [retval addObjectsFromArray:self.collapsedRepresentedObjects];
+        
+        [self.tokenTextAttachmentIndexes enumerateIndexesUsingBlock:^(NSUInteger idx, BOOL * _Nonnull stop) {
+            id<KSOTokenTextAttachment> value = [self.textStorage attribute:NSAttachmentAttributeName atIndex:idx effectiveRange:NULL];
+            
+            if (value.representedObject != nil) {
+                [retval addObject:value.representedObject];
+            }
+        }];
+        
+        [self setCachedRepresentedObjects:retval];
+    }
+    return self.cachedRepresentedObjects;
 }
 - (void)setRepresentedObjects:(NSArray *)representedObjects {
-    NSMutableAttributedString *temp = [[self _emptyAttributedStringWithDefaultAttributes] mutableCopy];
+    [self _setRepresentedObjects:representedObjects texts:nil tokenSizes:NULL];
+}
+- (void)setTokenCollapsingThreshold:(NSUInteger)tokenCollapsingThreshold {
+    _tokenCollapsingThreshold = tokenCollapsingThreshold;
     
-    for (id<KSOTokenRepresentedObject> representedObject in representedObjects) {
-        NSString *text = representedObject.tokenRepresentedObjectDisplayName;
-        
-        [temp appendAttributedString:[NSAttributedString attributedStringWithAttachment:[self _textAttachmentWithRepresentedObject:representedObject text:text]]];
+    // a threshold of 0 expands all of the collapsed tokens at once
+    if (_tokenCollapsingThreshold == 0) {
+        [self _expandCollapsedTokens];
+    }
+    else {
+        [self _collapseTokensIfNeeded];
+    }
+}
+- (NSUInteger)collapsedRepresentedObjectsCount {
+    return self.collapsedRepresentedObjects.count;
+}
+- (NSArray *)collapsedRepresentedObjects {
+    return self.collapsedTextAttachment.collapsedRepresentedObjects ?: @[];
+}
+- (KSOTokenCollapsedTextAttachment *)collapsedTextAttachment {
+    // the collapsed token is part of the text rather than separate state, so however it is deleted or replaced the represented objects it stands for go along with it
+    if (self.textStorage.length == 0) {
+        return nil;
     }
     
-    [self.textStorage replaceCharactersInRange:NSMakeRange(0, self.textStorage.length) withAttributedString:temp];
+    id value = [self.textStorage attribute:NSAttachmentAttributeName atIndex:0 effectiveRange:NULL];
     
-    if (self.selectedRange.length == 0) {
-        [self setSelectedRange:NSMakeRange(self.text.length, 0)];
-    }
+    return [value isKindOfClass:KSOTokenCollapsedTextAttachment.class] ? value : nil;
 }
 - (void)setTokenizingCharacterSet:(NSCharacterSet *)tokenizingCharacterSet {
     _tokenizingCharacterSet = [tokenizingCharacterSet copy] ?: [self.class _defaultTokenizingCharacterSet];
+    
+    [self.tokenizer setDelimiterCharacterSet:_tokenizingCharacterSet];
 }
 - (void)setTokenTextAttachmentClass:(Class<KSOTokenTextAttachment>)tokenTextAttachmentClass {
     _tokenTextAttachmentClass = tokenTextAttachmentClass ?: [self.class _defaultTokenTextAttachmentClass];
@@ -515,6 +909,20 @@
 }
 - (void)setCompletionsDelay:(NSTimeInterval)completionDelay {
     _completionsDelay = completionDelay < 0.0 ? [self.class _defaultCompletionDelay] : completionDelay;
+    
+    [self _recordCompletionScheduler];
+}
+- (void)setCompletionsSchedulingMode:(KSOTokenCompletionsSchedulingMode)completionsSchedulingMode {
+    _completionsSchedulingMode = completionsSchedulingMode;
+    
+    [self _recordCompletionScheduler];
+}
+- (void)setCompletionsTableViewRowHeight:(CGFloat)completionsTableViewRowHeight {
+    _completionsTableViewRowHeight = completionsTableViewRowHeight;
+    
+    if (self.tableView != nil) {
+        [self _updateCompletionsTableViewRowHeight];
+    }
 }
 - (void)setCompletionsTableViewClass:(Class)completionTableViewClass {
     _completionsTableViewClass = completionTableViewClass ?: [self.class _defaultCompletionTableViewClass];
@@ -533,20 +941,27 @@
 }
 #pragma mark *** Private Methods ***
 - (void)_KSOTokenTextViewInit; {
+    _completionStatistics = [[KSOTokenCompletionStatistics alloc] init];
     _completionOperationQueue = [[NSOperationQueue alloc] init];
     [_completionOperationQueue setMaxConcurrentOperationCount:1];
     [_completionOperationQueue setQualityOfService:NSQualityOfServiceUserInitiated];
     
     _tokenizingCharacterSet = [self.class _defaultTokenizingCharacterSet];
+    _tokenizer = [[KSOTokenTokenizer alloc] initWithDelimiterCharacterSet:_tokenizingCharacterSet];
     _tokenTextAttachmentClass = [self.class _defaultTokenTextAttachmentClass];
     _completionsDelay = [self.class _defaultCompletionDelay];
+    KSOTokenCompletionSchedulerInit(&_completionScheduler);
+    _completionsTableViewRowHeight = UITableViewAutomaticDimension;
     _completionsTableViewClass = [self.class _defaultCompletionTableViewClass];
     _completionsTableViewCellClass = [self.class _defaultCompletionTableViewCellClass];
     
     [self setTextColor:[self.class _defaultTextColor]];
-    [self setTypingAttributes:@{NSFontAttributeName: self.font, NSForegroundColorAttributeName: self.textColor}];
+    [self setTypingAttributes:[self _defaultAttributes]];
     [self setInputAccessoryView:[[KDINextPreviousInputAccessoryView alloc] initWithFrame:CGRectZero responder:self]];
     [(KDINextPreviousInputAccessoryView *)self.inputAccessoryView setItemOptions:KDINextPreviousInputAccessoryViewItemOptionsDone];
+    
+    _tokenTextAttachmentIndexes = [[NSMutableIndexSet alloc] init];
+    [self _updateTokenTextAttachmentIndexesForEditedRange:NSMakeRange(0, self.textStorage.length) changeInLength:self.textStorage.length];
     [self.textStorage setDelegate:self];
     
     _internalDelegate = [[KSOTokenTextViewInternalDelegate alloc] init];
@@ -587,6 +1002,12 @@
             return;
         }
         
+        // tapping the collapsed token displays more of the tokens it stands for
+        if ([value isKindOfClass:KSOTokenCollapsedTextAttachment.class]) {
+            [self _expandCollapsedTokens];
+            return;
+        }
+        
         // if the user tapped on a token that was already selected, move the caret immediately after the token
         // alternatively, if the user selected at the edge of a token, they probably don't want to select it
         if (NSEqualRanges(range, self.selectedRange) ||
@@ -610,44 +1031,30 @@
 }
 #pragma mark -
 - (BOOL)_tokenizeTextInRange:(NSRange)range tokenRange:(NSRangePointer)outTokenRange; {
+    KSOTokenMetricsInterval interval = [self _beginMetricsStage:KSOTokenMetricsStageTokenize];
+    
+    range = [self _insertionRangeForRange:range];
+    
     NSRange tokenRange = [self _tokenRangeForRange:range];
+    BOOL retval = NO;
     
     if (tokenRange.length > 0) {
         // trim surrounding whitespace to prevent something like " a@b.com" being shown as a token
         NSString *tokenText = [[self.text substringWithRange:tokenRange] stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceCharacterSet]];
-        // initially the represented object is the token text itself
-        id representedObject = tokenText;
-        
-        // if the delegate implements tokenTextView:representedObjectForEditingText: use its return value for the represented object
-        if ([self.delegate respondsToSelector:@selector(tokenTextView:representedObjectForEditingText:)]) {
-            representedObject = [self.delegate tokenTextView:self representedObjectForEditingText:tokenText];
-        }
-        
-        // initial array of represented objects to insert
-        NSArray *representedObjects = @[representedObject];
         // index to insert the objects at
         NSInteger index = [self _indexOfTokenTextAttachmentInRange:range textAttachment:NULL];
-        
-        // if the delegate responds to tokenTextView:shouldAddRepresentedObjects:atIndex use its return value for the represented objects to insert
-        if ([self.delegate respondsToSelector:@selector(tokenTextView:shouldAddRepresentedObjects:atIndex:)]) {
-            representedObjects = [self.delegate tokenTextView:self shouldAddRepresentedObjects:representedObjects atIndex:index];
-        }
+        // ask the delegate for the represented objects of the token text, then let it filter them
+        NSArray *representedObjects = [self _shouldAddRepresentedObjects:[self _representedObjectsForEditingTexts:@[tokenText]] atIndex:index];
         
         // if there are represented objects to insert, continue
         if (representedObjects.count > 0) {
-            NSMutableAttributedString *temp = [[self _emptyAttributedStringWithDefaultAttributes] mutableCopy];
-            
-            // loop through each represented object and ask the delegate for the display text for each one
-            for (id<KSOTokenRepresentedObject> representedObject in representedObjects) {
-                NSString *displayText = representedObject.tokenRepresentedObjectDisplayName;
-                
-                [temp appendAttributedString:[NSAttributedString attributedStringWithAttachment:[self _textAttachmentWithRepresentedObject:representedObject text:displayText]]];
-            }
+            NSAttributedString *temp = [self _attributedStringWithRepresentedObjects:representedObjects];
             
             // replace all characters in token range with the text attachments
             [self.textStorage replaceCharactersInRange:tokenRange withAttributedString:temp];
             
             [self setSelectedRange:NSMakeRange(tokenRange.location + 1, 0)];
+            [self _collapseTokensIfNeeded];
             
             // hide the completion table view if it was visible
             [self _hideCompletionsTableViewAndSelectCompletionModel:nil];
@@ -660,61 +1067,157 @@
                 *outTokenRange = tokenRange;
             }
             
-            return YES;
+            retval = YES;
         }
     }
-    return NO;
-}
-- (NSRange)_tokenRangeForRange:(NSRange)range; {
-    NSRange searchRange = NSMakeRange(0, range.location);
-    // take the inverted set of our tokenizing set
-    NSMutableCharacterSet *characterSet = [self.tokenizingCharacterSet.invertedSet mutableCopy];
-    // remove the NSAttachmentCharacter from our inverted character set, we don't want to match against tokens
-    [characterSet removeCharactersInString:[NSString stringWithFormat:@"%C",(unichar)NSAttachmentCharacter]];
     
-    NSRange foundRange = [self.text rangeOfCharacterFromSet:characterSet options:NSBackwardsSearch range:searchRange];
-    NSRange retval = foundRange;
+    [self _endMetricsStage:KSOTokenMetricsStageTokenize interval:interval];
     
-    // first search backwards until we hit either a token or end of text
-    while (foundRange.length > 0) {
-        retval = NSUnionRange(retval, foundRange);
+    return retval;
+}
+- (NSRange)_tokenRangeForRange:(NSRange)range; {
+    // the tokenizer only scans the run of text around range.location and remembers the result until the next edit
+    return [self.tokenizer tokenRangeInString:self.textStorage.string location:range.location];
+}
+- (NSUInteger)_indexOfTokenTextAttachmentInRange:(NSRange)range textAttachment:(id<KSOTokenTextAttachment> *)textAttachment; {
+    NSUInteger length = self.textStorage.length;
+    // if we don't have any text, there is no attachment, otherwise look for an attachment clamped to the passed in range.location and the end of our text - 1
+    NSUInteger location = length == 0 ? NSNotFound : MIN(range.location, length - 1);
+    id<KSOTokenTextAttachment> attachment = nil;
+    // the collapsed represented objects precede all of the displayed tokens
+    NSUInteger collapsedCount = self.collapsedRepresentedObjects.count;
+    NSUInteger retval = collapsedCount + self.tokenTextAttachmentIndexes.count;
+    
+    if (location != NSNotFound &&
+        [self.tokenTextAttachmentIndexes containsIndex:location]) {
         
-        searchRange = NSMakeRange(0, foundRange.location);
-        foundRange = [self.text rangeOfCharacterFromSet:characterSet options:NSBackwardsSearch range:searchRange];
+        attachment = [self.textStorage attribute:NSAttachmentAttributeName atIndex:location effectiveRange:NULL];
+        // adjacent tokens coalesce into a single range, so this is proportional to the number of runs of tokens rather than the number of tokens
+        retval = collapsedCount + [self.tokenTextAttachmentIndexes countOfIndexesInRange:NSMakeRange(0, location)];
     }
-    
-    // if we found something searching backwards, use a scanner to scan all characters from our character set starting at retval.location and moving forwards
-    if (retval.location != NSNotFound) {
-        NSScanner *scanner = [[NSScanner alloc] initWithString:self.text];
-        
-        [scanner setCharactersToBeSkipped:nil];
-        [scanner setScanLocation:retval.location];
+    else if (location == 0 &&
+             self.collapsedTextAttachment != nil) {
         
-        NSString *string;
-        if ([scanner scanCharactersFromSet:characterSet intoString:&string]) {
-            retval = NSMakeRange(retval.location, string.length);
-        }
+        retval = 0;
     }
     
-    // if the receiver has no text, leaving the NSNotFound will throw an exception when trying to replace with a completion
-    if (retval.location == NSNotFound) {
-        retval.location = 0;
+    if (textAttachment) {
+        *textAttachment = attachment;
     }
     
     return retval;
 }
-- (NSUInteger)_indexOfTokenTextAttachmentInRange:(NSRange)range textAttachment:(id<KSOTokenTextAttachment> *)textAttachment; {
-    // if we don't have any text, the attachment is nil, otherwise search for an attachment clamped to the passed in range.location and the end of our text - 1
-    id<KSOTokenTextAttachment> attachment = self.text.length == 0 ? nil : [self.attributedText attribute:NSAttachmentAttributeName atIndex:MIN(range.location, self.attributedText.length - 1) effectiveRange:NULL];
-    NSArray *representedObjects = self.representedObjects;
-    NSUInteger retval = [representedObjects indexOfObject:attachment.representedObject];
+- (void)_updateTokenTextAttachmentIndexesForEditedRange:(NSRange)editedRange changeInLength:(NSInteger)delta; {
+    // editedRange is in post edit coordinates, the characters it replaced ended at NSMaxRange(editedRange) - delta
+    NSUInteger previousMaxRange = (NSUInteger)((NSInteger)NSMaxRange(editedRange) - delta);
     
-    if (retval == NSNotFound) {
-        retval = representedObjects.count;
-    }
+    [self.tokenTextAttachmentIndexes removeIndexesInRange:NSMakeRange(editedRange.location, previousMaxRange - editedRange.location)];
+    [self.tokenTextAttachmentIndexes shiftIndexesStartingAtIndex:previousMaxRange by:delta];
     
-    if (textAttachment) {
-        *textAttachment = attachment;
+    [self.textStorage enumerateAttribute:NSAttachmentAttributeName inRange:editedRange options:NSAttributedStringEnumerationLongestEffectiveRangeNotRequired usingBlock:^(id  _Nullable value, NSRange range, BOOL * _Nonnull stop) {
+        // the collapsed token is not one of the tokens
+        if (value != nil &&
+            ![value isKindOfClass:KSOTokenCollapsedTextAttachment.class]) {
+            
+            [self.tokenTextAttachmentIndexes addIndexesInRange:range];
+        }
+    }];
+    
+    [self setCachedRepresentedObjects:nil];
+}
+- (void)_setNeedsLayoutTokenTextAttachments; {
+    if (self.needsLayoutTokenTextAttachments) {
+        return;
+    }
+    
+    [self setNeedsLayoutTokenTextAttachments:YES];
+    
+    // coalesce all the attachments that change during this turn of the run loop
+    kstWeakify(self);
+    dispatch_async(dispatch_get_main_queue(), ^{
+        kstStrongify(self);
+        [self _layoutTokenTextAttachmentsIfNeeded];
+    });
+}
+- (void)_layoutTokenTextAttachmentsIfNeeded; {
+    if (!self.needsLayoutTokenTextAttachments) {
+        return;
+    }
+    
+    [self setNeedsLayoutTokenTextAttachments:NO];
+    
+    // only the runs of tokens need to be laid out again, the attachments that were not drawn yet render lazily when they are
+    [self.tokenTextAttachmentIndexes enumerateRangesUsingBlock:^(NSRange range, BOOL * _Nonnull stop) {
+        [self.layoutManager invalidateLayoutForCharacterRange:range actualCharacterRange:NULL];
+        [self.layoutManager invalidateDisplayForCharacterRange:range];
+    }];
+}
+- (KSOTokenMetricsInterval)_beginMetricsStage:(KSOTokenMetricsStage)stage; {
+    KSOTokenMetricsInterval retval = {0.0, OS_SIGNPOST_ID_NULL};
+    
+    if (self.metricsSink == nil) {
+        return retval;
+    }
+    
+    retval.startTime = CACurrentMediaTime();
+    
+    os_log_t log = [self.class _metricsLog];
+    
+    // signposts cost next to nothing unless Instruments is recording them
+    if (os_signpost_enabled(log)) {
+        retval.signpostID = os_signpost_id_generate(log);
+        
+        KSOTokenMetricsSignpost(os_signpost_interval_begin, log, retval.signpostID, stage);
+    }
+    
+    return retval;
+}
+- (void)_endMetricsStage:(KSOTokenMetricsStage)stage interval:(KSOTokenMetricsInterval)interval; {
+    id<KSOTokenMetricsSink> metricsSink = self.metricsSink;
+    
+    // the sink may have been assigned after the stage began
+    if (metricsSink == nil ||
+        interval.startTime == 0.0) {
+        
+        return;
+    }
+    
+    NSTimeInterval duration = CACurrentMediaTime() - interval.startTime;
+    
+    if (interval.signpostID != OS_SIGNPOST_ID_NULL) {
+        os_log_t log = [self.class _metricsLog];
+        
+        KSOTokenMetricsSignpost(os_signpost_interval_end, log, interval.signpostID, stage);
+    }
+    
+    [metricsSink tokenTextView:self didMeasureStage:stage duration:duration];
+}
+- (void)_incrementMetricsCounter:(KSOTokenMetricsCounter)counter; {
+    [self.metricsSink tokenTextView:self didIncrementCounter:counter];
+}
+- (void)_recordCompletionLatency:(NSTimeInterval)latency cancelled:(BOOL)cancelled; {
+    KSOTokenCompletionSchedulerRecordLatency(&_completionScheduler, latency, cancelled);
+    
+    [self _recordCompletionScheduler];
+}
+- (NSUInteger)_locationOfTokenTextAttachmentAtIndex:(NSUInteger)index; {
+    __block NSUInteger remaining = index;
+    __block NSUInteger retval = NSNotFound;
+    
+    // walk the runs of tokens rather than the individual tokens
+    [self.tokenTextAttachmentIndexes enumerateRangesUsingBlock:^(NSRange range, BOOL * _Nonnull stop) {
+        if (remaining < range.length) {
+            retval = range.location + remaining;
+            *stop = YES;
+        }
+        else {
+            remaining -= range.length;
+        }
+    }];
+    
+    // past the last token, insert after it or the collapsed token
+    if (retval == NSNotFound) {
+        retval = self.tokenTextAttachmentIndexes.count > 0 ? self.tokenTextAttachmentIndexes.lastIndex + 1 : (self.collapsedTextAttachment == nil ? 0 : 1);
     }
     
     return retval;
@@ -726,7 +1229,13 @@
     // enumerate text attachments in the range to be deleted and add their represented object to the array
     [self.textStorage enumerateAttribute:NSAttachmentAttributeName inRange:range options:0 usingBlock:^(id<KSOTokenTextAttachment> value, NSRange range, BOOL *stop) {
         if (value) {
-            [representedObjects addObject:value.representedObject];
+            // the collapsed token stands for all of the collapsed represented objects
+            if ([value isKindOfClass:KSOTokenCollapsedTextAttachment.class]) {
+                [representedObjects addObjectsFromArray:((KSOTokenCollapsedTextAttachment *)value).collapsedRepresentedObjects];
+            }
+            else {
+                [representedObjects addObject:value.representedObject];
+            }
             
             // remove the range of the attachment from the entire selected range
             [rangeAsIndexSet removeIndexesInRange:range];
@@ -734,12 +1243,17 @@
     }];
     
     // if there is any plain text left selected, count will be > 0, create represented objects for left over text
-    if (rangeAsIndexSet.count > 0) {
+    if (rangeAsIndexSet.count > 0 &&
+        ([self.delegate respondsToSelector:@selector(tokenTextView:representedObjectsForEditingTexts:)] ||
+         [self.delegate respondsToSelector:@selector(tokenTextView:representedObjectForEditingText:)])) {
+        
+        NSMutableArray *editingTexts = [[NSMutableArray alloc] init];
+        
         [rangeAsIndexSet enumerateRangesUsingBlock:^(NSRange range, BOOL * _Nonnull stop) {
-            if ([self.delegate respondsToSelector:@selector(tokenTextView:representedObjectForEditingText:)]) {
-                [representedObjects addObject:[self.delegate tokenTextView:self representedObjectForEditingText:[self.textStorage.string substringWithRange:range]]];
-            }
+            [editingTexts addObject:[self.textStorage.string substringWithRange:range]];
         }];
+        
+        [representedObjects addObjectsFromArray:[self _representedObjectsForEditingTexts:editingTexts]];
     }
     
     if (representedObjects.count > 0) {
@@ -772,8 +1286,367 @@
     
     return retval;
 }
+- (NSDictionary<NSAttributedStringKey, id> *)_defaultAttributes; {
+    if (self.cachedDefaultAttributes == nil) {
+        [self setCachedDefaultAttributes:@{NSFontAttributeName: self.font, NSForegroundColorAttributeName: self.textColor, NSParagraphStyleAttributeName: [NSParagraphStyle KDI_paragraphStyleWithTextAlignment:self.textAlignment]}];
+    }
+    return self.cachedDefaultAttributes;
+}
+- (void)_invalidateDefaultAttributes; {
+    [self setCachedDefaultAttributes:nil];
+    [self setCachedEmptyAttributedString:nil];
+}
 - (NSAttributedString *)_emptyAttributedStringWithDefaultAttributes; {
-    return [[NSAttributedString alloc] initWithString:@"" attributes:@{NSFontAttributeName: self.font, NSForegroundColorAttributeName: self.textColor, NSParagraphStyleAttributeName: [NSParagraphStyle KDI_paragraphStyleWithTextAlignment:self.textAlignment]}];
+    if (self.cachedEmptyAttributedString == nil) {
+        [self setCachedEmptyAttributedString:[[NSAttributedString alloc] initWithString:@"" attributes:[self _defaultAttributes]]];
+    }
+    return self.cachedEmptyAttributedString;
+}
+- (void)_enumerateTokenTextAttachmentsUsingBlock:(void(^)(id<KSOTokenTextAttachment> textAttachment))block; {
+    if (self.collapsedTextAttachment != nil) {
+        block(self.collapsedTextAttachment);
+    }
+    
+    // only the runs of tokens are enumerated rather than all of the text
+    [self.tokenTextAttachmentIndexes enumerateRangesUsingBlock:^(NSRange range, BOOL * _Nonnull stop) {
+        [self.textStorage enumerateAttribute:NSAttachmentAttributeName inRange:range options:NSAttributedStringEnumerationLongestEffectiveRangeNotRequired usingBlock:^(id  _Nullable value, NSRange valueRange, BOOL * _Nonnull stop) {
+            if (value != nil) {
+                block(value);
+            }
+        }];
+    }];
+}
+- (NSAttributedString *)_attributedStringWithRepresentedObjects:(NSArray<id<KSOTokenRepresentedObject>> *)representedObjects; {
+    return [self _attributedStringWithRepresentedObjects:representedObjects texts:nil tokenSizes:NULL];
+}
+- (NSAttributedString *)_attributedStringWithRepresentedObjects:(NSArray<id<KSOTokenRepresentedObject>> *)representedObjects texts:(NSArray<NSString *> *)texts tokenSizes:(const CGSize *)tokenSizes; {
+    NSUInteger count = representedObjects.count;
+    
+    if (count == 0) {
+        return [self _emptyAttributedStringWithDefaultAttributes];
+    }
+    
+    // create all the attachment characters with the default attributes at once, then set each attachment, rather than appending one attributed string per token
+    unichar attachmentCharacter = NSAttachmentCharacter;
+    NSString *string = [@"" stringByPaddingToLength:count withString:[NSString stringWithCharacters:&attachmentCharacter length:1] startingAtIndex:0];
+    NSMutableAttributedString *retval = [[NSMutableAttributedString alloc] initWithString:string attributes:[self _defaultAttributes]];
+    
+    [retval beginEditing];
+    
+    [representedObjects enumerateObjectsUsingBlock:^(id<KSOTokenRepresentedObject>  _Nonnull representedObject, NSUInteger idx, BOOL * _Nonnull stop) {
+        NSTextAttachment<KSOTokenTextAttachment> *textAttachment = [self _textAttachmentWithRepresentedObject:representedObject text:texts == nil ? representedObject.tokenRepresentedObjectDisplayName : texts[idx]];
+        
+        // sizes restored from a snapshot let the token be laid out without measuring its text
+        if (tokenSizes != NULL &&
+            tokenSizes[idx].width > 0.0 &&
+            [textAttachment respondsToSelector:@selector(setTokenSize:)]) {
+            
+            [textAttachment setTokenSize:tokenSizes[idx]];
+        }
+        
+        [retval addAttribute:NSAttachmentAttributeName value:textAttachment range:NSMakeRange(idx, 1)];
+    }];
+    
+    [retval endEditing];
+    
+    return retval;
+}
+- (NSAttributedString *)_attributedStringWithCollapsedRepresentedObjects:(NSArray *)collapsedRepresentedObjects representedObjects:(NSArray<id<KSOTokenRepresentedObject>> *)representedObjects; {
+    return [self _attributedStringWithCollapsedRepresentedObjects:collapsedRepresentedObjects representedObjects:representedObjects texts:nil tokenSizes:NULL];
+}
+- (NSAttributedString *)_attributedStringWithCollapsedRepresentedObjects:(NSArray *)collapsedRepresentedObjects representedObjects:(NSArray<id<KSOTokenRepresentedObject>> *)representedObjects texts:(NSArray<NSString *> *)texts tokenSizes:(const CGSize *)tokenSizes; {
+    NSUInteger collapsedCount = collapsedRepresentedObjects.count;
+    
+    if (collapsedCount == 0) {
+        return [self _attributedStringWithRepresentedObjects:representedObjects texts:texts tokenSizes:tokenSizes];
+    }
+    
+    NSString *text = nil;
+    
+    if ([self.delegate respondsToSelector:@selector(tokenTextView:textForCollapsedRepresentedObjectsCount:)]) {
+        text = [self.delegate tokenTextView:self textForCollapsedRepresentedObjectsCount:collapsedCount];
+    }
+    
+    if (text == nil) {
+        text = [NSString localizedStringWithFormat:@"+%lu more",(unsigned long)collapsedCount];
+    }
+    
+    // a new attachment is created each time the collapsed represented objects change, the text of an attachment cannot be changed
+    KSOTokenCollapsedTextAttachment *collapsedTextAttachment = [[KSOTokenCollapsedTextAttachment alloc] initWithCollapsedRepresentedObjects:collapsedRepresentedObjects text:text tokenTextView:self];
+    
+    [collapsedTextAttachment setFont:self.font];
+    
+    unichar attachmentCharacter = NSAttachmentCharacter;
+    NSMutableAttributedString *retval = [[NSMutableAttributedString alloc] initWithString:[NSString stringWithCharacters:&attachmentCharacter length:1] attributes:[self _defaultAttributes]];
+    
+    [retval addAttribute:NSAttachmentAttributeName value:collapsedTextAttachment range:NSMakeRange(0, 1)];
+    
+    if (representedObjects.count > 0) {
+        [retval appendAttributedString:[self _attributedStringWithRepresentedObjects:representedObjects texts:texts tokenSizes:tokenSizes]];
+    }
+    
+    return retval;
+}
+- (void)_setRepresentedObjects:(NSArray *)representedObjects texts:(NSArray<NSString *> *)texts tokenSizes:(const CGSize *)tokenSizes; {
+    NSRange displayedRange = NSMakeRange(0, representedObjects.count);
+    
+    // only create attachments for the tokens that will be displayed
+    if (self.tokenCollapsingThreshold > 0 &&
+        representedObjects.count > self.tokenCollapsingThreshold) {
+        
+        displayedRange = NSMakeRange(representedObjects.count - self.tokenCollapsingThreshold, self.tokenCollapsingThreshold);
+    }
+    
+    NSAttributedString *temp = [self _attributedStringWithCollapsedRepresentedObjects:[representedObjects subarrayWithRange:NSMakeRange(0, displayedRange.location)] representedObjects:[representedObjects subarrayWithRange:displayedRange] texts:[texts subarrayWithRange:displayedRange] tokenSizes:tokenSizes == NULL ? NULL : tokenSizes + displayedRange.location];
+    
+    [self.textStorage beginEditing];
+    [self.textStorage replaceCharactersInRange:NSMakeRange(0, self.textStorage.length) withAttributedString:temp];
+    [self.textStorage endEditing];
+    
+    if (self.selectedRange.length == 0) {
+        [self setSelectedRange:NSMakeRange(self.text.length, 0)];
+    }
+}
+- (void)_collapseTokensIfNeeded; {
+    NSUInteger threshold = self.tokenCollapsingThreshold;
+    NSUInteger count = self.tokenTextAttachmentIndexes.count;
+    
+    if (threshold == 0 ||
+        count <= threshold) {
+        
+        return;
+    }
+    
+    NSUInteger start = self.collapsedTextAttachment == nil ? 0 : 1;
+    NSRange selectedRange = self.selectedRange;
+    __block NSRange firstRange = NSMakeRange(NSNotFound, 0);
+    
+    [self.tokenTextAttachmentIndexes enumerateRangesUsingBlock:^(NSRange range, BOOL * _Nonnull stop) {
+        firstRange = range;
+        *stop = YES;
+    }];
+    
+    // only the run of tokens at the beginning of the text that precedes the selection is collapsed, which leaves the selection and any text being edited alone
+    if (firstRange.location != start ||
+        selectedRange.location <= start) {
+        
+        return;
+    }
+    
+    NSUInteger collapsingCount = MIN(MIN(firstRange.length, count - threshold), selectedRange.location - start);
+    NSArray *previousCollapsedRepresentedObjects = self.collapsedRepresentedObjects;
+    NSMutableArray *collapsedRepresentedObjects = [[NSMutableArray alloc] initWithCapacity:previousCollapsedRepresentedObjects.count + collapsingCount];
+    
+    [collapsedRepresentedObjects addObjectsFromArray:previousCollapsedRepresentedObjects];
+    
+    [self.textStorage enumerateAttribute:NSAttachmentAttributeName inRange:NSMakeRange(start, collapsingCount) options:NSAttributedStringEnumerationLongestEffectiveRangeNotRequired usingBlock:^(id<KSOTokenTextAttachment> _Nullable value, NSRange range, BOOL * _Nonnull stop) {
+        if (value.representedObject != nil) {
+            [collapsedRepresentedObjects addObject:value.representedObject];
+        }
+    }];
+    
+    // replace the collapsed token, if there is one, along with the tokens being collapsed
+    NSRange range = NSMakeRange(0, start + collapsingCount);
+    NSAttributedString *temp = [self _attributedStringWithCollapsedRepresentedObjects:collapsedRepresentedObjects representedObjects:@[]];
+    
+    [self.textStorage beginEditing];
+    [self.textStorage replaceCharactersInRange:range withAttributedString:temp];
+    [self.textStorage endEditing];
+    
+    selectedRange.location -= range.length - temp.length;
+    
+    [self setSelectedRange:selectedRange];
+}
+- (void)_expandCollapsedTokens; {
+    NSArray *collapsedRepresentedObjects = self.collapsedRepresentedObjects;
+    NSUInteger collapsedCount = collapsedRepresentedObjects.count;
+    
+    if (collapsedCount == 0) {
+        return;
+    }
+    
+    // expand the collapsed tokens closest to the displayed ones, a page at a time so the number of tokens being laid out stays bounded
+    NSUInteger expandingCount = self.tokenCollapsingThreshold == 0 ? collapsedCount : MIN(collapsedCount, self.tokenCollapsingThreshold);
+    NSRange expandingRange = NSMakeRange(collapsedCount - expandingCount, expandingCount);
+    NSArray *representedObjects = [collapsedRepresentedObjects subarrayWithRange:expandingRange];
+    NSRange selectedRange = self.selectedRange;
+    NSAttributedString *temp = [self _attributedStringWithCollapsedRepresentedObjects:[collapsedRepresentedObjects subarrayWithRange:NSMakeRange(0, expandingRange.location)] representedObjects:representedObjects];
+    
+    [self.textStorage beginEditing];
+    [self.textStorage replaceCharactersInRange:NSMakeRange(0, 1) withAttributedString:temp];
+    [self.textStorage endEditing];
+    
+    // keep the selection on the same characters
+    if (selectedRange.location > 0) {
+        selectedRange.location += temp.length - 1;
+    }
+    
+    [self setSelectedRange:selectedRange];
+}
+- (NSArray *)_representedObjectsForEditingTexts:(NSArray<NSString *> *)editingTexts; {
+    if (editingTexts.count == 0) {
+        return @[];
+    }
+    // prefer the plural method, it lets the delegate look up all of the editing texts at once
+    else if ([self.delegate respondsToSelector:@selector(tokenTextView:representedObjectsForEditingTexts:)]) {
+        return [self.delegate tokenTextView:self representedObjectsForEditingTexts:editingTexts] ?: editingTexts;
+    }
+    else if ([self.delegate respondsToSelector:@selector(tokenTextView:representedObjectForEditingText:)]) {
+        NSMutableArray *retval = [[NSMutableArray alloc] initWithCapacity:editingTexts.count];
+        
+        for (NSString *editingText in editingTexts) {
+            [retval addObject:[self.delegate tokenTextView:self representedObjectForEditingText:editingText] ?: editingText];
+        }
+        
+        return retval;
+    }
+    return editingTexts;
+}
+- (NSArray *)_shouldAddRepresentedObjects:(NSArray *)representedObjects atIndex:(NSInteger)index; {
+    if (representedObjects.count > 0 &&
+        [self.delegate respondsToSelector:@selector(tokenTextView:shouldAddRepresentedObjects:atIndex:)]) {
+        
+        return [self.delegate tokenTextView:self shouldAddRepresentedObjects:representedObjects atIndex:index];
+    }
+    return representedObjects;
+}
+- (NSRange)_insertionRangeForRange:(NSRange)range; {
+    // the collapsed token must stay the first character, tokens inserted in front of it go right after it instead
+    if (NSEqualRanges(range, NSMakeRange(0, 0)) &&
+        self.collapsedTextAttachment != nil) {
+        
+        return NSMakeRange(1, 0);
+    }
+    return range;
+}
+- (void)_pasteStrings:(NSArray<NSString *> *)strings range:(NSRange)range; {
+    NSProgress *progress = [NSProgress discreteProgressWithTotalUnitCount:-1];
+    NSCharacterSet *tokenizingCharacterSet = self.tokenizingCharacterSet;
+    
+    [self setPasteProgress:progress];
+    
+    kstWeakify(self);
+    dispatch_async(dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0), ^{
+        // the tokenizer of the receiver caches its last token range and must only be used on the main thread
+        KSOTokenTokenizer *tokenizer = [[KSOTokenTokenizer alloc] initWithDelimiterCharacterSet:tokenizingCharacterSet];
+        NSMutableArray *tokenTexts = [[NSMutableArray alloc] init];
+        
+        for (NSString *string in strings) {
+            if (progress.isCancelled) {
+                break;
+            }
+            
+            [tokenTexts addObjectsFromArray:[tokenizer tokenTextsInString:string]];
+        }
+        
+        dispatch_async(dispatch_get_main_queue(), ^{
+            kstStrongify(self);
+            [progress setTotalUnitCount:tokenTexts.count];
+            
+            [self _resolvePastedTokenTexts:tokenTexts representedObjects:[[NSMutableArray alloc] initWithCapacity:tokenTexts.count] range:range progress:progress];
+        });
+    });
+}
+- (void)_resolvePastedTokenTexts:(NSArray<NSString *> *)tokenTexts representedObjects:(NSMutableArray *)representedObjects range:(NSRange)range progress:(NSProgress *)progress; {
+    if (progress.isCancelled) {
+        [self setPasteProgress:nil];
+        return;
+    }
+    
+    BOOL async = [self.delegate respondsToSelector:@selector(tokenTextView:representedObjectsForEditingTexts:completion:)];
+    BOOL resolves = (async ||
+                     [self.delegate respondsToSelector:@selector(tokenTextView:representedObjectsForEditingTexts:)] ||
+                     [self.delegate respondsToSelector:@selector(tokenTextView:representedObjectForEditingText:)]);
+    // resolve a batch per turn of the run loop so the user interface stays responsive, if the delegate does not resolve editing texts there is nothing to batch
+    NSUInteger start = (NSUInteger)progress.completedUnitCount;
+    NSUInteger end = resolves ? MIN(tokenTexts.count, start + [self.class _bulkPasteBatchSize]) : tokenTexts.count;
+    NSArray *editingTexts = [tokenTexts subarrayWithRange:NSMakeRange(start, end - start)];
+    
+    kstWeakify(self);
+    void(^block)(NSArray *) = ^(NSArray *resolvedRepresentedObjects){
+        kstStrongify(self);
+        [representedObjects addObjectsFromArray:resolvedRepresentedObjects];
+        [progress setCompletedUnitCount:end];
+        
+        if (end < tokenTexts.count) {
+            dispatch_async(dispatch_get_main_queue(), ^{
+                kstStrongify(self);
+                [self _resolvePastedTokenTexts:tokenTexts representedObjects:representedObjects range:range progress:progress];
+            });
+            return;
+        }
+        
+        [self setPasteProgress:nil];
+        
+        if (progress.isCancelled) {
+            return;
+        }
+        
+        // the text storage could have been replaced programmatically while the paste was in progress
+        NSUInteger length = self.textStorage.length;
+        NSRange insertRange = NSMakeRange(MIN(range.location, length), 0);
+        
+        insertRange.length = MIN(range.length, length - insertRange.location);
+        insertRange = [self _insertionRangeForRange:insertRange];
+        
+        NSInteger index = [self _indexOfTokenTextAttachmentInRange:insertRange textAttachment:NULL];
+        
+        [self _insertPastedRepresentedObjects:[self _shouldAddRepresentedObjects:representedObjects atIndex:index] index:index range:insertRange];
+    };
+    
+    // the async method lets the delegate resolve each batch off the main thread
+    if (async) {
+        [self.delegate tokenTextView:self representedObjectsForEditingTexts:editingTexts completion:^(NSArray<id<KSOTokenRepresentedObject>> * _Nullable resolvedRepresentedObjects) {
+            KSTDispatchMainAsync(^{
+                block(resolvedRepresentedObjects ?: editingTexts);
+            });
+        }];
+    }
+    else {
+        block([self _representedObjectsForEditingTexts:editingTexts]);
+    }
+}
+- (void)_insertPastedRepresentedObjects:(NSArray *)representedObjects index:(NSInteger)index range:(NSRange)range; {
+    if (representedObjects.count == 0) {
+        return;
+    }
+    
+    NSAttributedString *temp = [self _attributedStringWithRepresentedObjects:representedObjects];
+    NSMutableArray *deletedRepresentedObjects = [[NSMutableArray alloc] init];
+    
+    if (range.length > 0) {
+        [self.textStorage enumerateAttribute:NSAttachmentAttributeName inRange:range options:NSAttributedStringEnumerationLongestEffectiveRangeNotRequired usingBlock:^(id<KSOTokenTextAttachment> _Nullable value, NSRange valueRange, BOOL * _Nonnull stop) {
+            if ([value isKindOfClass:KSOTokenCollapsedTextAttachment.class]) {
+                [deletedRepresentedObjects addObjectsFromArray:((KSOTokenCollapsedTextAttachment *)value).collapsedRepresentedObjects];
+            }
+            else if (value.representedObject != nil) {
+                [deletedRepresentedObjects addObject:value.representedObject];
+            }
+        }];
+    }
+    
+    NSRange newSelectedRange = NSMakeRange(range.location + temp.length, 0);
+    
+    // replace all characters in range with the text attachments
+    [self.textStorage beginEditing];
+    [self.textStorage replaceCharactersInRange:range withAttributedString:temp];
+    [self.textStorage endEditing];
+    
+    [self setSelectedRange:newSelectedRange];
+    [self _collapseTokensIfNeeded];
+    
+    // hide the completion table view if it was visible
+    [self _hideCompletionsTableViewAndSelectCompletionModel:nil];
+    
+    if ([self.delegate respondsToSelector:@selector(tokenTextView:didAddRepresentedObjects:atIndex:)]) {
+        [self.delegate tokenTextView:self didAddRepresentedObjects:representedObjects atIndex:index];
+    }
+    
+    if (deletedRepresentedObjects.count > 0) {
+        if ([self.delegate respondsToSelector:@selector(tokenTextView:didRemoveRepresentedObjects:atIndex:)]) {
+            [self.delegate tokenTextView:self didRemoveRepresentedObjects:deletedRepresentedObjects atIndex:MAX(0, index - 1)];
+        }
+    }
 }
 #pragma mark -
 - (void)_showCompletionsTableView; {
@@ -792,14 +1665,7 @@
     if (self.tableView == nil) {
         [self setTableView:[[self.completionsTableViewClass alloc] initWithFrame:CGRectZero style:UITableViewStylePlain]];
         
-        CGFloat estimatedRowHeight = 44.0;
-        
-        if ([self.completionsTableViewCellClass respondsToSelector:@selector(estimatedRowHeight)]) {
-            estimatedRowHeight = [self.completionsTableViewCellClass estimatedRowHeight];
-        }
-        
-        [self.tableView setEstimatedRowHeight:estimatedRowHeight];
-        [self.tableView setRowHeight:UITableViewAutomaticDimension];
+        [self _updateCompletionsTableViewRowHeight];
         [self.tableView registerClass:self.completionsTableViewCellClass forCellReuseIdentifier:NSStringFromClass(self.completionsTableViewCellClass)];
         [self.tableView setDataSource:self];
         [self.tableView setDelegate:self];
@@ -809,7 +1675,7 @@
         [self.delegate tokenTextView:self showCompletionsTableView:self.tableView];
     }
     
-    [self _reloadCompletionsTableView];
+    [self _reloadCompletionsTableViewIgnoringCache:NO];
 }
 - (void)_hideCompletionsTableViewAndSelectCompletionModel:(id<KSOTokenCompletionModel>)completionModel; {
     // if the delegate responds, ask it to hide the completions table view
@@ -821,68 +1687,360 @@
             if ([self.delegate respondsToSelector:@selector(tokenTextView:representedObjectsForCompletionModel:)]) {
                 representedObjects = [self.delegate tokenTextView:self representedObjectsForCompletionModel:completionModel];
             }
-            else if ([self.delegate respondsToSelector:@selector(tokenTextView:representedObjectForEditingText:)]) {
-                representedObjects = @[[self.delegate tokenTextView:self representedObjectForEditingText:[completionModel tokenCompletionModelTitle]]];
-            }
             else {
-                representedObjects = @[[completionModel tokenCompletionModelTitle]];
+                representedObjects = [self _representedObjectsForEditingTexts:@[[completionModel tokenCompletionModelTitle]]];
             }
             
-            NSInteger index = [self _indexOfTokenTextAttachmentInRange:self.selectedRange textAttachment:NULL];
+            NSRange range = [self _insertionRangeForRange:self.selectedRange];
+            NSInteger index = [self _indexOfTokenTextAttachmentInRange:range textAttachment:NULL];
             
-            // if the delegate responds to tokenTextView:shouldAddRepresentedObjects:atIndex use its return value for the represented objects to insert
-            if ([self.delegate respondsToSelector:@selector(tokenTextView:shouldAddRepresentedObjects:atIndex:)]) {
-                representedObjects = [self.delegate tokenTextView:self shouldAddRepresentedObjects:representedObjects atIndex:index];
-            }
+            // the delegate filters the represented objects exactly once per insertion
+            representedObjects = [self _shouldAddRepresentedObjects:representedObjects atIndex:index];
             
             if (representedObjects.count > 0) {
-                NSMutableAttributedString *temp = [[self _emptyAttributedStringWithDefaultAttributes] mutableCopy];
+                NSAttributedString *temp = [self _attributedStringWithRepresentedObjects:representedObjects];
+                NSRange tokenRange = [self _tokenRangeForRange:range];
                 
-                for (id<KSOTokenRepresentedObject> representedObject in representedObjects) {
-                    NSString *displayText = representedObject.tokenRepresentedObjectDisplayName;
-                    
-                    [temp appendAttributedString:[NSAttributedString attributedStringWithAttachment:[self _textAttachmentWithRepresentedObject:representedObject text:displayText]]];
-                }
+                [self.textStorage replaceCharactersInRange:tokenRange withAttributedString:temp];
                 
-                if (![self.delegate respondsToSelector:@selector(tokenTextView:shouldAddRepresentedObjects:atIndex:)] ||
-                    ([self.delegate respondsToSelector:@selector(tokenTextView:shouldAddRepresentedObjects:atIndex:)] &&
-                     [self.delegate tokenTextView:self shouldAddRepresentedObjects:representedObjects atIndex:index])) {
-                    
-                        [self.textStorage replaceCharactersInRange:[self _tokenRangeForRange:self.selectedRange] withAttributedString:temp];
-                        
-                        if ([self.delegate respondsToSelector:@selector(tokenTextView:didAddRepresentedObjects:atIndex:)]) {
-                            [self.delegate tokenTextView:self didAddRepresentedObjects:representedObjects atIndex:index];
-                        }
+                // the selection goes after the inserted tokens before collapsing, which keeps it on the same characters
+                [self setSelectedRange:NSMakeRange(tokenRange.location + temp.length, 0)];
+                [self _collapseTokensIfNeeded];
+                
+                if ([self.delegate respondsToSelector:@selector(tokenTextView:didAddRepresentedObjects:atIndex:)]) {
+                    [self.delegate tokenTextView:self didAddRepresentedObjects:representedObjects atIndex:index];
                 }
             }
         }
         
         [self.delegate tokenTextView:self hideCompletionsTableView:self.tableView];
         
+        // results that are still on their way must not fill the hidden table view
+        self.completionRequestGeneration++;
+        
         [self setCompletionModels:nil];
     }
 }
-- (void)_reloadCompletionsTableView; {
-    // if the delegate responds to either of the completion returning methods, continue
-    if ([self.delegate respondsToSelector:@selector(tokenTextView:completionModelsForSubstring:indexOfRepresentedObject:completion:)]) {
-        NSInteger index = [self _indexOfTokenTextAttachmentInRange:self.selectedRange textAttachment:NULL];
-        NSRange range = [self _tokenRangeForRange:self.selectedRange];
-        NSString *substring = [self.text substringWithRange:range];
+- (void)_recordCompletionScheduler; {
+    KSOTokenCompletionsSchedulingPolicy policy;
+    NSTimeInterval delay;
+    
+    // the scheduler policies and the public ones have the same values
+    if (self.completionsSchedulingMode == KSOTokenCompletionsSchedulingModeAdaptive) {
+        policy = (KSOTokenCompletionsSchedulingPolicy)_completionScheduler.policy;
+        delay = MAX(self.completionsDelay, _completionScheduler.delay);
+    }
+    else {
+        policy = self.completionsDelay > 0.0 ? KSOTokenCompletionsSchedulingPolicyDebounce : KSOTokenCompletionsSchedulingPolicyImmediate;
+        delay = self.completionsDelay;
+    }
+    
+    [self.completionStatistics _recordScheduler:&_completionScheduler policy:policy delay:delay];
+}
+- (void)_updateCompletionsTableViewRowHeight; {
+    // a fixed row height lets the table view compute its content size without sizing any cells
+    if (self.completionsTableViewRowHeight > 0.0) {
+        [self.tableView setEstimatedRowHeight:self.completionsTableViewRowHeight];
+        [self.tableView setRowHeight:self.completionsTableViewRowHeight];
+        return;
+    }
+    
+    CGFloat estimatedRowHeight = 44.0;
+    
+    if ([self.completionsTableViewCellClass respondsToSelector:@selector(estimatedRowHeight)]) {
+        estimatedRowHeight = [self.completionsTableViewCellClass estimatedRowHeight];
+    }
+    
+    [self.tableView setEstimatedRowHeight:estimatedRowHeight];
+    [self.tableView setRowHeight:UITableViewAutomaticDimension];
+}
+- (void)_reloadCompletionsTableViewIgnoringCache:(BOOL)ignoringCache; {
+    KSOTokenMetricsInterval interval = [self _beginMetricsStage:KSOTokenMetricsStageReloadCompletions];
+    CFTimeInterval startTime = CACurrentMediaTime();
+    
+    if ([self _requestCompletionModelsIgnoringCache:ignoringCache]) {
+        [self.completionStatistics _recordMainThreadTime:CACurrentMediaTime() - startTime keystroke:YES];
+    }
+    
+    [self _endMetricsStage:KSOTokenMetricsStageReloadCompletions interval:interval];
+}
+- (BOOL)_requestCompletionModelsIgnoringCache:(BOOL)ignoringCache; {
+    BOOL batch = ([self.delegate respondsToSelector:@selector(tokenTextView:completionModelsForSubstring:indexOfRepresentedObject:cancellationToken:batchCompletion:)] ||
+                  [self.delegate respondsToSelector:@selector(tokenTextView:completionModelsForSubstring:indexOfRepresentedObject:batchCompletion:)]);
+    BOOL async = ([self.delegate respondsToSelector:@selector(tokenTextView:completionModelsForSubstring:indexOfRepresentedObject:cancellationToken:completion:)] ||
+                  [self.delegate respondsToSelector:@selector(tokenTextView:completionModelsForSubstring:indexOfRepresentedObject:completion:)]);
+    
+    // if the delegate responds to any of the completion returning methods, continue
+    if (!batch &&
+        !async &&
+        ![self.delegate respondsToSelector:@selector(tokenTextView:completionModelsForSubstring:indexOfRepresentedObject:)]) {
+        
+        return NO;
+    }
+    
+    NSInteger index = [self _indexOfTokenTextAttachmentInRange:self.selectedRange textAttachment:NULL];
+    NSRange range = [self _tokenRangeForRange:self.selectedRange];
+    NSString *substring = [self.text substringWithRange:range];
+    
+    // any outstanding request is for a stale substring
+    [self.completionOperationQueue cancelAllOperations];
+    
+    // an operation that already finished is no longer in the queue, but its results can still be on their way to the main queue
+    self.completionRequestGeneration++;
+    
+    NSUInteger generation = self.completionRequestGeneration;
+    
+    if (!ignoringCache) {
+        NSArray *completionModels = [self.completionsCache completionModelsForSubstring:substring index:index];
+        
+        if (self.completionsCache != nil) {
+            [self _incrementMetricsCounter:completionModels == nil ? KSOTokenMetricsCounterCompletionCacheMiss : KSOTokenMetricsCounterCompletionCacheHit];
+        }
+        
+        if (completionModels != nil) {
+            [self _setCompletionModels:completionModels substring:substring tokenRange:range index:index];
+            return YES;
+        }
+        
+        if ([self _refineCompletionModelsForSubstring:substring tokenRange:range index:index]) {
+            return YES;
+        }
+    }
+    
+    BOOL executesOnMainThread = self.completionsExecutionMode == KSOTokenCompletionsExecutionModeMainThread;
+    KSOTokenCompletionOperation *operation = nil;
+    CFTimeInterval dispatchTime = CACurrentMediaTime();
+    
+    // only queries that reach the delegate count, the cache and refinement answered the ones above without it
+    KSOTokenCompletionSchedulerDispatch(&_completionScheduler, dispatchTime);
+    
+    if (batch) {
+        __block BOOL firstBatch = YES;
         
         kstWeakify(self);
-        [self.completionOperationQueue cancelAllOperations];
-        [self.completionOperationQueue addOperation:[[KSOTokenCompletionOperation alloc] initWithTokenTextView:self substring:substring index:index completion:^(NSArray<id<KSOTokenCompletionModel>> * _Nullable completionModels) {
+        operation = [[KSOTokenCompletionOperation alloc] initWithTokenTextView:self substring:substring index:index batchCompletion:^(NSArray<id<KSOTokenCompletionModel>> * _Nullable completionModels, BOOL finished) {
             kstStrongify(self);
-            [self setCompletionModels:completionModels];
-        }]];
+            if (self.completionRequestGeneration != generation) {
+                return;
+            }
+            
+            // keep showing the previous completions until there is something to replace them with
+            if (firstBatch) {
+                if (completionModels.count == 0 &&
+                    !finished) {
+                    
+                    return;
+                }
+                
+                firstBatch = NO;
+                
+                [self setCompletionModels:completionModels];
+            }
+            else {
+                [self _appendCompletionModels:completionModels];
+            }
+            
+            if (finished) {
+                [self.completionsCache setCompletionModels:self.completionModels ?: @[] forSubstring:substring index:index];
+                
+                // the rows are already up to date, only record what they were provided for
+                [self setCompletionModelsSubstring:substring];
+                [self setCompletionModelsTokenRange:range];
+                [self setCompletionModelsIndex:index];
+            }
+        }];
     }
-    else if ([self.delegate respondsToSelector:@selector(tokenTextView:completionModelsForSubstring:indexOfRepresentedObject:)]) {
+    // in background mode the synchronous delegate method is called by the operation as well
+    else if (async ||
+             !executesOnMainThread) {
         
-        NSInteger index = [self _indexOfTokenTextAttachmentInRange:self.selectedRange textAttachment:NULL];
-        NSRange range = [self _tokenRangeForRange:self.selectedRange];
-        NSString *substring = [self.text substringWithRange:range];
+        kstWeakify(self);
+        operation = [[KSOTokenCompletionOperation alloc] initWithTokenTextView:self substring:substring index:index completion:^(NSArray<id<KSOTokenCompletionModel>> * _Nullable completionModels) {
+            kstStrongify(self);
+            if (self.completionRequestGeneration != generation) {
+                return;
+            }
+            
+            [self.completionsCache setCompletionModels:completionModels ?: @[] forSubstring:substring index:index];
+            
+            [self _setCompletionModels:completionModels substring:substring tokenRange:range index:index];
+        }];
+    }
+    else {
+        [self.completionStatistics _recordStartedQuery];
+        
+        NSArray *completionModels = [self.delegate tokenTextView:self completionModelsForSubstring:substring indexOfRepresentedObject:index];
+        
+        [self.completionStatistics _recordCompletedQuery];
+        [self _recordCompletionLatency:CACurrentMediaTime() - dispatchTime cancelled:NO];
+        
+        [self.completionsCache setCompletionModels:completionModels ?: @[] forSubstring:substring index:index];
+        
+        [self _setCompletionModels:completionModels substring:substring tokenRange:range index:index];
+    }
+    
+    if (operation != nil) {
+        [operation setExecutesOnMainThread:executesOnMainThread];
+        
+        [self.completionOperationQueue addOperation:operation];
+    }
+    
+    return YES;
+}
+- (BOOL)_refineCompletionModelsForSubstring:(NSString *)substring tokenRange:(NSRange)tokenRange index:(NSInteger)index; {
+    // refinement only applies when the user extended the substring the current completion models were provided for
+    if (!self.isCompletionsRefinementEnabled ||
+        self.completionModelsSubstring == nil ||
+        self.completionModelsIndex != index ||
+        self.completionModelsTokenRange.location != tokenRange.location ||
+        substring.length <= self.completionModelsSubstring.length ||
+        [substring rangeOfString:self.completionModelsSubstring options:NSAnchoredSearch|NSCaseInsensitiveSearch].length == 0) {
+        
+        return NO;
+    }
+    
+    NSMutableArray<id<KSOTokenCompletionModel>> *previousCompletionModels = [[NSMutableArray alloc] initWithCapacity:self.completionModels.count];
+    
+    for (id<KSOTokenCompletionModel> completionModel in self.completionModels) {
+        [previousCompletionModels addObject:[self _completionModelForDelegate:completionModel]];
+    }
+    
+    NSArray<id<KSOTokenCompletionModel>> *completionModels;
+    
+    if ([self.delegate respondsToSelector:@selector(tokenTextView:completionModelsForSubstring:indexOfRepresentedObject:refiningCompletionModels:)]) {
+        completionModels = [self.delegate tokenTextView:self completionModelsForSubstring:substring indexOfRepresentedObject:index refiningCompletionModels:previousCompletionModels];
+    }
+    else {
+        NSMutableArray *temp = [[NSMutableArray alloc] init];
+        
+        for (id<KSOTokenCompletionModel> completionModel in previousCompletionModels) {
+            NSRange range = [completionModel.tokenCompletionModelTitle rangeOfString:substring options:NSCaseInsensitiveSearch];
+            
+            if (range.length == 0) {
+                continue;
+            }
+            
+            // the matching ranges of the completion model are for the shorter substring, highlight the match of the new one instead
+            if ([completionModel respondsToSelector:@selector(tokenCompletionModelIndexes)] ||
+                [completionModel respondsToSelector:@selector(tokenCompletionModelRange)]) {
+                
+                [temp addObject:[[KSOTokenRefinedCompletionModel alloc] initWithCompletionModel:completionModel indexes:[NSIndexSet indexSetWithIndexesInRange:range]]];
+            }
+            else {
+                [temp addObject:completionModel];
+            }
+        }
+        
+        completionModels = temp;
+    }
+    
+    [self _setCompletionModels:completionModels substring:substring tokenRange:tokenRange index:index];
+    
+    return YES;
+}
+- (id<KSOTokenCompletionModel>)_completionModelForDelegate:(id<KSOTokenCompletionModel>)completionModel; {
+    // the delegate only ever sees the completion models it provided
+    if ([completionModel isKindOfClass:KSOTokenRefinedCompletionModel.class]) {
+        return [(KSOTokenRefinedCompletionModel *)completionModel completionModel];
+    }
+    return completionModel;
+}
+- (NSArray<id<KSOTokenCompletionModel>> *)_completionModelsForDelegate:(NSArray<id<KSOTokenCompletionModel>> *)completionModels; {
+    NSMutableArray *retval = [[NSMutableArray alloc] initWithCapacity:completionModels.count];
+    
+    for (id<KSOTokenCompletionModel> completionModel in completionModels) {
+        [retval addObject:[self _completionModelForDelegate:completionModel]];
+    }
+    
+    return retval;
+}
+- (void)_setCompletionModels:(NSArray<id<KSOTokenCompletionModel>> *)completionModels substring:(NSString *)substring tokenRange:(NSRange)tokenRange index:(NSInteger)index; {
+    [self setCompletionModels:completionModels];
+    
+    [self setCompletionModelsSubstring:substring];
+    [self setCompletionModelsTokenRange:tokenRange];
+    [self setCompletionModelsIndex:index];
+}
+- (void)_appendCompletionModels:(NSArray<id<KSOTokenCompletionModel>> *)completionModels; {
+    if (completionModels.count == 0) {
+        return;
+    }
+    
+    NSInteger row = _completionModels.count;
+    // inserting rows requires a visible table view that already displays the previous rows, otherwise it throws
+    BOOL reloads = (self.tableView.window == nil ||
+                    [self.tableView numberOfRowsInSection:0] != row);
+    
+    _completionModels = [_completionModels arrayByAddingObjectsFromArray:completionModels] ?: [completionModels copy];
+    
+    if (reloads) {
+        [self.tableView reloadData];
+    }
+    else {
+        NSMutableArray<NSIndexPath *> *indexPaths = [[NSMutableArray alloc] initWithCapacity:completionModels.count];
         
-        [self setCompletionModels:[self.delegate tokenTextView:self completionModelsForSubstring:substring indexOfRepresentedObject:index]];
+        for (NSInteger i=0; i<completionModels.count; i++) {
+            [indexPaths addObject:[NSIndexPath indexPathForRow:row + i inSection:0]];
+        }
+        
+        // insert the new rows rather than reloading, the rows that are already visible keep their cells
+        [UIView performWithoutAnimation:^{
+            [self.tableView insertRowsAtIndexPaths:indexPaths withRowAnimation:UITableViewRowAnimationNone];
+        }];
+    }
+    
+    if (self.tableView.window != nil) {
+        [self.tableView setHidden:NO];
+    }
+}
+- (void)_updateCompletionsTableViewFromCompletionModels:(NSArray<id<KSOTokenCompletionModel>> *)oldCompletionModels; {
+    NSArray *completionModels = _completionModels ?: @[];
+    
+    oldCompletionModels = oldCompletionModels ?: @[];
+    
+    // diffing only pays off for a visible table view, and for result sets small enough that it is cheaper than reloading
+    if (self.tableView.window == nil ||
+        oldCompletionModels.count + completionModels.count > [self.class _maximumDiffableCompletionModelsCount] ||
+        [self.tableView numberOfRowsInSection:0] != oldCompletionModels.count) {
+        
+        [self.tableView reloadData];
+        return;
+    }
+    
+    // completion models are identified by isEqual: of the completion models the delegate provided, rows whose completion model is still present keep their cells even if refinement changed its matching ranges
+    NSOrderedCollectionDifference *difference = [[self _completionModelsForDelegate:completionModels] differenceFromArray:[self _completionModelsForDelegate:oldCompletionModels]];
+    
+    if (difference.hasChanges) {
+        NSMutableArray<NSIndexPath *> *deletedIndexPaths = [[NSMutableArray alloc] init];
+        NSMutableArray<NSIndexPath *> *insertedIndexPaths = [[NSMutableArray alloc] init];
+        
+        for (NSOrderedCollectionChange *change in difference.removals) {
+            [deletedIndexPaths addObject:[NSIndexPath indexPathForRow:change.index inSection:0]];
+        }
+        for (NSOrderedCollectionChange *change in difference.insertions) {
+            [insertedIndexPaths addObject:[NSIndexPath indexPathForRow:change.index inSection:0]];
+        }
+        
+        [UIView performWithoutAnimation:^{
+            [self.tableView performBatchUpdates:^{
+                [self.tableView deleteRowsAtIndexPaths:deletedIndexPaths withRowAnimation:UITableViewRowAnimationNone];
+                [self.tableView insertRowsAtIndexPaths:insertedIndexPaths withRowAnimation:UITableViewRowAnimationNone];
+            } completion:nil];
+        }];
+    }
+    
+    // an equal completion model can still have different matching ranges for the new substring, update the kept cells in place
+    for (NSIndexPath *indexPath in self.tableView.indexPathsForVisibleRows) {
+        if (indexPath.row >= completionModels.count) {
+            continue;
+        }
+        
+        UITableViewCell<KSOTokenCompletionTableViewCell> *cell = [self.tableView cellForRowAtIndexPath:indexPath];
+        id<KSOTokenCompletionModel> completionModel = completionModels[indexPath.row];
+        
+        if (cell.completionModel != completionModel) {
+            [cell setCompletionModel:completionModel];
+        }
     }
 }
 #pragma mark -
@@ -908,6 +2066,23 @@
 + (UIColor *)_defaultTextColor; {
     return UIColor.blackColor;
 }
++ (NSUInteger)_bulkPasteLengthThreshold; {
+    return 4096;
+}
++ (NSUInteger)_bulkPasteBatchSize; {
+    return 256;
+}
++ (NSUInteger)_maximumDiffableCompletionModelsCount; {
+    return 500;
+}
++ (os_log_t)_metricsLog; {
+    static os_log_t kRetval;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        kRetval = os_log_create("com.kosoku.ksotoken", "Metrics");
+    });
+    return kRetval;
+}
 #pragma mark Properties
 - (void)setSelectedTextAttachmentRanges:(NSIndexSet *)selectedTextAttachmentRanges {
     // force a display of the old selected token ranges
@@ -931,8 +2106,14 @@
     }
 }
 - (void)setCompletionModels:(NSArray<id<KSOTokenCompletionModel>> *)completionModels {
+    KSOTokenMetricsInterval interval = [self _beginMetricsStage:KSOTokenMetricsStageSetCompletionModels];
+    NSArray *oldCompletionModels = _completionModels;
+    
     _completionModels = completionModels;
     
+    // anything set directly was not provided for a particular substring, so it cannot be refined
+    _completionModelsSubstring = nil;
+    
     if (_completionModels.count == 0 &&
         self.tableView.window != nil) {
         
@@ -945,13 +2126,15 @@
         [self.tableView setHidden:shouldHide];
     }
     
-    [self.tableView reloadData];
+    [self _updateCompletionsTableViewFromCompletionModels:oldCompletionModels];
     
     if (_completionModels.count > 0 &&
         self.tableView.window != nil) {
         
         [self.tableView setHidden:NO];
     }
+    
+    [self _endMetricsStage:KSOTokenMetricsStageSetCompletionModels interval:interval];
 }
 
 @end
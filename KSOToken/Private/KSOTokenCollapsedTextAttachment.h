@@ -0,0 +1,35 @@
+//
+//  KSOTokenCollapsedTextAttachment.h
+//  KSOToken
+//
+//  Created by William Towe on 10/17/26.
+//  Copyright © 2021 Kosoku Interactive, LLC. All rights reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+
+#import "KSOTokenDefaultTextAttachment.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+// the token that stands for the represented objects collapsed in front of the displayed tokens, it is always the first character of the text view and owns the represented objects so they are removed along with it
+@interface KSOTokenCollapsedTextAttachment : KSOTokenDefaultTextAttachment
+
+@property (readonly,copy,nonatomic) NSArray *collapsedRepresentedObjects;
+
+- (instancetype)initWithCollapsedRepresentedObjects:(NSArray *)collapsedRepresentedObjects text:(NSString *)text tokenTextView:(KSOTokenTextView *)tokenTextView NS_DESIGNATED_INITIALIZER;
+- (instancetype)initWithRepresentedObject:(id<KSOTokenRepresentedObject>)representedObject text:(NSString *)text tokenTextView:(KSOTokenTextView *)tokenTextView NS_UNAVAILABLE;
+
+@end
+
+NS_ASSUME_NONNULL_END
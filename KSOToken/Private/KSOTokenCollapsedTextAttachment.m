@@ -0,0 +1,39 @@
+//
+//  KSOTokenCollapsedTextAttachment.m
+//  KSOToken
+//
+//  Created by William Towe on 10/17/26.
+//  Copyright © 2021 Kosoku Interactive, LLC. All rights reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+
+#import "KSOTokenCollapsedTextAttachment.h"
+
+@interface KSOTokenCollapsedTextAttachment ()
+@property (readwrite,copy,nonatomic) NSArray *collapsedRepresentedObjects;
+@end
+
+@implementation KSOTokenCollapsedTextAttachment
+
+- (instancetype)initWithCollapsedRepresentedObjects:(NSArray *)collapsedRepresentedObjects text:(NSString *)text tokenTextView:(KSOTokenTextView *)tokenTextView; {
+    // the text is the represented object, the collapsed represented objects are never passed to the delegate as a single object
+    if (!(self = [super initWithRepresentedObject:text text:text tokenTextView:tokenTextView]))
+        return nil;
+    
+    _collapsedRepresentedObjects = [collapsedRepresentedObjects copy];
+    
+    return self;
+}
+
+@end
@@ -0,0 +1,391 @@
+//
+//  KSOTokenCompletionIndexFunctions.c
+//  KSOToken
+//
+//  Created by William Towe on 10/17/26.
+//  Copyright © 2021 Kosoku Interactive, LLC. All rights reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+#include "KSOTokenCompletionIndexFunctions.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+uint16_t KSOTokenFoldCharacter(uint16_t c) {
+    if (c < 0x80) {
+        return (c >= 'A' && c <= 'Z') ? c + 32 : c;
+    }
+    // latin-1 supplement, excluding the multiplication sign
+    if (c >= 0xC0 && c <= 0xDE && c != 0xD7) {
+        return c + 32;
+    }
+    // latin extended-a
+    if (c >= 0x100 && c <= 0x17F) {
+        if (c == 0x130) {
+            return 'i';
+        }
+        if (c == 0x178) {
+            return 0xFF;
+        }
+        if ((c >= 0x139 && c <= 0x148) || (c >= 0x179 && c <= 0x17E)) {
+            return (c & 1) ? c + 1 : c;
+        }
+        if (c <= 0x137 || (c >= 0x14A && c <= 0x177)) {
+            return (c & 1) ? c : c + 1;
+        }
+        return c;
+    }
+    // greek
+    if (c >= 0x386 && c <= 0x3A9) {
+        if (c >= 0x391 && c != 0x3A2) {
+            return c + 32;
+        }
+        if (c == 0x386) {
+            return 0x3AC;
+        }
+        if (c >= 0x388 && c <= 0x38A) {
+            return c + 37;
+        }
+        if (c == 0x38C) {
+            return 0x3CC;
+        }
+        if (c == 0x38E || c == 0x38F) {
+            return c + 63;
+        }
+        return c;
+    }
+    // cyrillic
+    if (c >= 0x400 && c <= 0x42F) {
+        return c < 0x410 ? c + 80 : c + 32;
+    }
+    // fullwidth latin
+    if (c >= 0xFF21 && c <= 0xFF3A) {
+        return c + 32;
+    }
+    return c;
+}
+void KSOTokenFoldCharacters(const uint16_t *characters, uint16_t *outCharacters, size_t length) {
+    for (size_t i=0; i<length; i++) {
+        outCharacters[i] = KSOTokenFoldCharacter(characters[i]);
+    }
+}
+
+// compare the suffixes at a and b up to and including their terminators, ties are broken by position so the sort is deterministic
+static inline int KSOTokenSuffixCompare(const uint16_t *characters, uint32_t a, uint32_t b) {
+    const uint16_t *p = characters + a;
+    const uint16_t *q = characters + b;
+    
+    for (;;) {
+        uint16_t x = *p++;
+        uint16_t y = *q++;
+        
+        if (x != y) {
+            return x < y ? -1 : 1;
+        }
+        if (x == 0) {
+            return a < b ? -1 : (a > b ? 1 : 0);
+        }
+    }
+}
+
+uint32_t *KSOTokenSuffixArrayCreate(const uint16_t *characters, size_t length, size_t *outCount) {
+    size_t count = 0;
+    
+    for (size_t i=0; i<length; i++) {
+        if (characters[i] != 0) {
+            count++;
+        }
+    }
+    
+    uint32_t *retval = malloc(sizeof(uint32_t) * (count > 0 ? count : 1));
+    uint32_t *scratch = malloc(sizeof(uint32_t) * (count > 0 ? count : 1));
+    
+    if (retval == NULL ||
+        scratch == NULL) {
+        
+        free(retval);
+        free(scratch);
+        return NULL;
+    }
+    
+    for (size_t i=0, j=0; i<length; i++) {
+        if (characters[i] != 0) {
+            retval[j++] = (uint32_t)i;
+        }
+    }
+    
+    // insertion sort short runs, then merge them bottom up
+    const size_t run = 16;
+    
+    for (size_t start=0; start<count; start+=run) {
+        size_t end = start + run < count ? start + run : count;
+        
+        for (size_t i=start + 1; i<end; i++) {
+            uint32_t value = retval[i];
+            size_t j = i;
+            
+            while (j > start && KSOTokenSuffixCompare(characters, retval[j - 1], value) > 0) {
+                retval[j] = retval[j - 1];
+                j--;
+            }
+            retval[j] = value;
+        }
+    }
+    
+    uint32_t *source = retval;
+    uint32_t *destination = scratch;
+    
+    for (size_t width=run; width<count; width*=2) {
+        for (size_t start=0; start<count; start+=width * 2) {
+            size_t middle = start + width < count ? start + width : count;
+            size_t end = start + width * 2 < count ? start + width * 2 : count;
+            size_t i = start, j = middle, k = start;
+            
+            while (i < middle && j < end) {
+                destination[k++] = KSOTokenSuffixCompare(characters, source[i], source[j]) <= 0 ? source[i++] : source[j++];
+            }
+            while (i < middle) {
+                destination[k++] = source[i++];
+            }
+            while (j < end) {
+                destination[k++] = source[j++];
+            }
+        }
+        
+        uint32_t *temp = source;
+        
+        source = destination;
+        destination = temp;
+    }
+    
+    if (source != retval) {
+        memcpy(retval, source, sizeof(uint32_t) * count);
+    }
+    
+    free(scratch);
+    
+    if (outCount != NULL) {
+        *outCount = count;
+    }
+    
+    return retval;
+}
+
+// compare the first patternLength code units of the suffix at position against pattern, the end of the suffix sorts before everything including a 0 in pattern, so the comparison never reads past the terminator of the entry
+static inline int KSOTokenSuffixComparePattern(const uint16_t *characters, size_t length, uint32_t position, const uint16_t *pattern, size_t patternLength) {
+    const uint16_t *p = characters + position;
+    size_t suffixLength = length - position;
+    
+    for (size_t i=0; i<patternLength; i++) {
+        uint16_t x = i < suffixLength ? p[i] : 0;
+        
+        if (x == 0) {
+            return -1;
+        }
+        else if (x != pattern[i]) {
+            return x < pattern[i] ? -1 : 1;
+        }
+    }
+    return 0;
+}
+
+size_t KSOTokenSuffixArrayFind(const uint16_t *characters, size_t length, const uint32_t *suffixes, size_t count, const uint16_t *pattern, size_t patternLength, size_t *outLength) {
+    size_t low = 0, high = count;
+    
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        
+        if (KSOTokenSuffixComparePattern(characters, length, suffixes[middle], pattern, patternLength) < 0) {
+            low = middle + 1;
+        }
+        else {
+            high = middle;
+        }
+    }
+    
+    size_t first = low;
+    
+    high = count;
+    
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        
+        if (KSOTokenSuffixComparePattern(characters, length, suffixes[middle], pattern, patternLength) <= 0) {
+            low = middle + 1;
+        }
+        else {
+            high = middle;
+        }
+    }
+    
+    if (outLength != NULL) {
+        *outLength = low - first;
+    }
+    
+    return first;
+}
+
+size_t KSOTokenOffsetsFind(const uint32_t *offsets, size_t count, uint32_t position) {
+    size_t low = 0, high = count;
+    
+    // find the last offset <= position
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        
+        if (offsets[middle] <= position) {
+            low = middle + 1;
+        }
+        else {
+            high = middle;
+        }
+    }
+    
+    return low > 0 ? low - 1 : 0;
+}
+
+bool KSOTokenCharactersContainPattern(const uint16_t *characters, size_t length, const uint16_t *pattern, size_t patternLength) {
+    return KSOTokenCharactersFindPattern(characters, length, pattern, patternLength) != SIZE_MAX;
+}
+size_t KSOTokenCharactersFindPattern(const uint16_t *characters, size_t length, const uint16_t *pattern, size_t patternLength) {
+    if (patternLength == 0) {
+        return 0;
+    }
+    
+    for (size_t i=0; i + patternLength <= length; i++) {
+        if (characters[i] == pattern[0] &&
+            memcmp(characters + i, pattern, sizeof(uint16_t) * patternLength) == 0) {
+            
+            return i;
+        }
+    }
+    return SIZE_MAX;
+}
+
+bool KSOTokenBoundedHeapInit(KSOTokenBoundedHeap *heap, size_t capacity) {
+    heap->count = 0;
+    heap->capacity = capacity;
+    heap->keys = malloc(sizeof(uint64_t) * (capacity > 0 ? capacity : 1));
+    heap->scores = malloc(sizeof(uint64_t) * (capacity > 0 ? capacity : 1));
+    
+    if (heap->keys == NULL ||
+        heap->scores == NULL) {
+        
+        KSOTokenBoundedHeapDestroy(heap);
+        return false;
+    }
+    return true;
+}
+void KSOTokenBoundedHeapDestroy(KSOTokenBoundedHeap *heap) {
+    free(heap->keys);
+    free(heap->scores);
+    
+    heap->keys = NULL;
+    heap->scores = NULL;
+    heap->count = 0;
+    heap->capacity = 0;
+}
+
+// whether the entry at first ranks lower than the entry at second, scores are compared before keys
+static inline bool KSOTokenBoundedHeapGreater(const KSOTokenBoundedHeap *heap, size_t first, size_t second) {
+    if (heap->scores[first] != heap->scores[second]) {
+        return heap->scores[first] > heap->scores[second];
+    }
+    return heap->keys[first] > heap->keys[second];
+}
+static inline void KSOTokenBoundedHeapSwap(KSOTokenBoundedHeap *heap, size_t first, size_t second) {
+    uint64_t temp = heap->keys[first];
+    
+    heap->keys[first] = heap->keys[second];
+    heap->keys[second] = temp;
+    
+    temp = heap->scores[first];
+    
+    heap->scores[first] = heap->scores[second];
+    heap->scores[second] = temp;
+}
+static inline void KSOTokenBoundedHeapSiftDown(KSOTokenBoundedHeap *heap, size_t count, size_t index) {
+    for (;;) {
+        size_t largest = index;
+        size_t left = index * 2 + 1;
+        size_t right = left + 1;
+        
+        if (left < count && KSOTokenBoundedHeapGreater(heap, left, largest)) {
+            largest = left;
+        }
+        if (right < count && KSOTokenBoundedHeapGreater(heap, right, largest)) {
+            largest = right;
+        }
+        if (largest == index) {
+            return;
+        }
+        
+        KSOTokenBoundedHeapSwap(heap, index, largest);
+        index = largest;
+    }
+}
+static void KSOTokenBoundedHeapInsertOrdered(KSOTokenBoundedHeap *heap, uint64_t score, uint64_t key) {
+    if (heap->capacity == 0) {
+        return;
+    }
+    
+    // the root is the largest retained entry, replace it if the new entry ranks higher
+    if (heap->count == heap->capacity) {
+        if (score > heap->scores[0] ||
+            (score == heap->scores[0] && key >= heap->keys[0])) {
+            
+            return;
+        }
+        
+        heap->keys[0] = key;
+        heap->scores[0] = score;
+        KSOTokenBoundedHeapSiftDown(heap, heap->count, 0);
+        return;
+    }
+    
+    size_t index = heap->count++;
+    
+    heap->keys[index] = key;
+    heap->scores[index] = score;
+    
+    while (index > 0) {
+        size_t parent = (index - 1) / 2;
+        
+        if (!KSOTokenBoundedHeapGreater(heap, index, parent)) {
+            break;
+        }
+        
+        KSOTokenBoundedHeapSwap(heap, parent, index);
+        index = parent;
+    }
+}
+
+void KSOTokenBoundedHeapInsert(KSOTokenBoundedHeap *heap, uint64_t key) {
+    KSOTokenBoundedHeapInsertOrdered(heap, 0, key);
+}
+void KSOTokenBoundedHeapInsertScore(KSOTokenBoundedHeap *heap, double score, size_t index) {
+    union {
+        double value;
+        uint64_t bits;
+    } temp = {.value = score == 0.0 ? 0.0 : score};
+    // map the double onto an unsigned integer with the same ordering, then invert it so higher scores are smaller
+    uint64_t ordered = (temp.bits & 0x8000000000000000ULL) ? ~temp.bits : (temp.bits | 0x8000000000000000ULL);
+    
+    KSOTokenBoundedHeapInsertOrdered(heap, ~ordered, (uint64_t)index);
+}
+void KSOTokenBoundedHeapSort(KSOTokenBoundedHeap *heap) {
+    for (size_t end=heap->count; end>1; end--) {
+        KSOTokenBoundedHeapSwap(heap, 0, end - 1);
+        KSOTokenBoundedHeapSiftDown(heap, end - 1, 0);
+    }
+}
@@ -0,0 +1,118 @@
+//
+//  KSOTokenCompletionIndexFunctions.h
+//  KSOToken
+//
+//  Created by William Towe on 10/17/26.
+//  Copyright © 2021 Kosoku Interactive, LLC. All rights reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+#ifndef KSOTokenCompletionIndexFunctions_h
+#define KSOTokenCompletionIndexFunctions_h
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ Returns the case folded version of the UTF-16 code unit *character*. Folding is always one code unit to one code unit, so matching locations within folded text are valid within the original text.
+ */
+uint16_t KSOTokenFoldCharacter(uint16_t character);
+/**
+ Case folds *length* code units from *characters* into *outCharacters*, which may be the same buffer.
+ */
+void KSOTokenFoldCharacters(const uint16_t *characters, uint16_t *outCharacters, size_t length);
+
+/**
+ Returns a malloc'd suffix array for *characters*, which must be a sequence of entries each terminated by 0. Only suffixes that begin with a non-terminator are included. The number of suffixes is returned by reference in *outCount*. Returns NULL on allocation failure.
+ */
+uint32_t *KSOTokenSuffixArrayCreate(const uint16_t *characters, size_t length, size_t *outCount);
+/**
+ Returns the first index in *suffixes* whose suffix begins with *pattern*, and returns by reference the number of consecutive suffixes that do in *outLength*. *characters* and *length* must be the ones *suffixes* was created with. Matches never extend past the terminator of an entry, so a *pattern* that contains 0 matches nothing.
+ */
+size_t KSOTokenSuffixArrayFind(const uint16_t *characters, size_t length, const uint32_t *suffixes, size_t count, const uint16_t *pattern, size_t patternLength, size_t *outLength);
+/**
+ Returns the index of the entry containing *position*, given the ascending entry start *offsets*.
+ */
+size_t KSOTokenOffsetsFind(const uint32_t *offsets, size_t count, uint32_t position);
+/**
+ Returns whether *pattern* occurs within the first *length* code units of *characters*.
+ */
+bool KSOTokenCharactersContainPattern(const uint16_t *characters, size_t length, const uint16_t *pattern, size_t patternLength);
+/**
+ Returns the location of the first occurrence of *pattern* within the first *length* code units of *characters*, or SIZE_MAX if there is none.
+ */
+size_t KSOTokenCharactersFindPattern(const uint16_t *characters, size_t length, const uint16_t *pattern, size_t patternLength);
+
+/**
+ Bounded heap that retains the *capacity* smallest keys inserted into it. Keys inserted with a score are ordered by score first, see KSOTokenBoundedHeapInsertScore.
+ */
+typedef struct {
+    uint64_t *keys;
+    // the ordered bits of the score of each key, parallel to keys and 0 for keys inserted without a score
+    uint64_t *scores;
+    size_t count;
+    size_t capacity;
+} KSOTokenBoundedHeap;
+
+/**
+ Initializes *heap* with the provided *capacity*. Returns false on allocation failure.
+ */
+bool KSOTokenBoundedHeapInit(KSOTokenBoundedHeap *heap, size_t capacity);
+/**
+ Releases the storage owned by *heap*.
+ */
+void KSOTokenBoundedHeapDestroy(KSOTokenBoundedHeap *heap);
+/**
+ Inserts *key* into *heap*, discarding the largest key if *heap* is full.
+ */
+void KSOTokenBoundedHeapInsert(KSOTokenBoundedHeap *heap, uint64_t key);
+/**
+ Inserts *index* into *heap* with *score*, discarding the lowest score if *heap* is full. Higher scores rank higher, entries with equal scores rank by *index*. The full precision of *score* is kept, so timestamps and large weights order correctly.
+ */
+void KSOTokenBoundedHeapInsertScore(KSOTokenBoundedHeap *heap, double score, size_t index);
+/**
+ Sorts the keys of *heap* ascending. After this call *heap* is no longer a valid heap.
+ */
+void KSOTokenBoundedHeapSort(KSOTokenBoundedHeap *heap);
+
+/**
+ Returns the ranking key for a match at *location* within an entry of *length* at *index*. Smaller keys rank higher. Locations and lengths are clamped to 16 bits, which only affects the order of matches that are already ranked last.
+ */
+static inline uint64_t KSOTokenCompletionRankKey(size_t location, size_t length, size_t index) {
+    return ((uint64_t)(location < 0xFFFF ? location : 0xFFFF) << 48) | ((uint64_t)(length < 0xFFFF ? length : 0xFFFF) << 32) | (uint64_t)(uint32_t)index;
+}
+/**
+ Returns the match location encoded in *key*, or SIZE_MAX if the location was clamped and must be found again.
+ */
+static inline size_t KSOTokenCompletionRankKeyLocation(uint64_t key) {
+    size_t retval = (size_t)(key >> 48);
+    
+    return retval < 0xFFFF ? retval : SIZE_MAX;
+}
+/**
+ Returns the entry index encoded in *key*, which is also the key of an entry inserted with KSOTokenBoundedHeapInsertScore.
+ */
+static inline size_t KSOTokenCompletionRankKeyIndex(uint64_t key) {
+    return (size_t)(key & 0xFFFFFFFF);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
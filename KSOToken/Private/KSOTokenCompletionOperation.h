@@ -26,7 +26,12 @@ NS_ASSUME_NONNULL_BEGIN
 
 @interface KSOTokenCompletionOperation : NSOperation
 
+// YES to call the delegate on the main thread, otherwise it is called on the thread of the operation queue, the default is NO
+@property (assign,nonatomic) BOOL executesOnMainThread;
+
+// completion is used with the completion delegate methods, or the synchronous one if the delegate does not implement them
 - (instancetype)initWithTokenTextView:(KSOTokenTextView *)tokenTextView substring:(NSString *)substring index:(NSUInteger)index completion:(void(^)(NSArray<id<KSOTokenCompletionModel> > * _Nullable completionModels))completion;
+- (instancetype)initWithTokenTextView:(KSOTokenTextView *)tokenTextView substring:(NSString *)substring index:(NSUInteger)index batchCompletion:(void(^)(NSArray<id<KSOTokenCompletionModel> > * _Nullable completionModels, BOOL finished))batchCompletion;
 
 @end
 
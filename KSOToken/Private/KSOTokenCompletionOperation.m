@@ -19,17 +19,37 @@
 
 #import "KSOTokenCompletionOperation.h"
 #import "KSOTokenTextView.h"
+#import "KSOTokenTextView+Private.h"
+#import "KSOTokenCompletionCancellationToken.h"
+#import "KSOTokenCompletionStatistics+Private.h"
 
 #import <Stanley/Stanley.h>
 
 @interface KSOTokenCompletionOperation ()
 @property (weak,nonatomic) KSOTokenTextView *tokenTextView;
+@property (weak,nonatomic) id<KSOTokenTextViewDelegate> delegate;
 @property (copy,nonatomic) NSString *substring;
 @property (assign,nonatomic) NSUInteger index;
 @property (copy,nonatomic) void(^completion)(NSArray<id<KSOTokenCompletionModel> > *);
+@property (copy,nonatomic) void(^batchCompletion)(NSArray<id<KSOTokenCompletionModel> > *, BOOL);
+@property (strong,nonatomic) KSOTokenCompletionCancellationToken *cancellationToken;
+// the statistics of tokenTextView when the query was created, the query is either completed or cancelled exactly once
+@property (strong,nonatomic) KSOTokenCompletionStatistics *statistics;
+// begun on the main thread when the query was created, ended when it is completed or cancelled
+@property (assign,nonatomic) KSOTokenMetricsInterval metricsInterval;
+// when the query was created, the latency reported to tokenTextView includes the time spent waiting in the queue
+@property (assign,nonatomic) CFTimeInterval creationTime;
+@property (assign,nonatomic,getter=isResolved) BOOL resolved;
+@property (atomic,assign,getter=isStarted) BOOL started;
+// set once an asynchronous or batch provider call has returned and is still working, only then can a cancelled query finish before the provider does
+@property (assign,nonatomic,getter=isAwaitingProvider) BOOL awaitingProvider;
 
 @property (assign,nonatomic,getter=isExecuting) BOOL executing;
 @property (assign,nonatomic,getter=isFinished) BOOL finished;
+
+- (void)_finish;
+- (void)_awaitProvider;
+- (BOOL)_resolve;
 @end
 
 @implementation KSOTokenCompletionOperation
@@ -41,7 +61,9 @@
         return;
     }
     
-    if (!NSThread.isMainThread) {
+    if (self.executesOnMainThread &&
+        !NSThread.isMainThread) {
+        
         [self performSelectorOnMainThread:_cmd withObject:nil waitUntilDone:NO];
         return;
     }
@@ -50,24 +72,132 @@
 }
 - (void)main {
     if (self.isCancelled) {
-        [self setExecuting:NO];
-        [self setFinished:YES];
+        [self _finish];
+        return;
     }
     
     [self setExecuting:YES];
+    [self setStarted:YES];
+    [self.statistics _recordStartedQuery];
+    
+    // the delegate and statistics were captured on the main thread, the text view must not be asked for them here
+    id<KSOTokenTextViewDelegate> delegate = self.delegate;
+    CFTimeInterval startTime = CACurrentMediaTime();
     
     kstWeakify(self);
-    [self.tokenTextView.delegate tokenTextView:self.tokenTextView completionModelsForSubstring:self.substring indexOfRepresentedObject:self.index completion:^(NSArray<id<KSOTokenCompletionModel>> * _Nullable completionModels) {
-        kstStrongify(self);
-        if (!self.isCancelled) {
+    if (self.batchCompletion != nil) {
+        void(^batchCompletion)(NSArray<id<KSOTokenCompletionModel>> *, BOOL) = ^(NSArray<id<KSOTokenCompletionModel>> * _Nullable completionModels, BOOL finished) {
+            kstStrongify(self);
+            if (self == nil ||
+                self.isFinished) {
+                
+                return;
+            }
+            
             KSTDispatchMainAsync(^{
-                self.completion(completionModels);
+                // the next keystroke cancels us on the main thread, so checking here guarantees stale batches are never delivered
+                if (!self.isCancelled) {
+                    if (finished &&
+                        [self _resolve]) {
+                        
+                        [self.statistics _recordCompletedQuery];
+                        [self.tokenTextView _endMetricsStage:KSOTokenMetricsStageCompletionOperation interval:self.metricsInterval];
+                        [self.tokenTextView _recordCompletionLatency:CACurrentMediaTime() - self.creationTime cancelled:NO];
+                    }
+                    
+                    CFTimeInterval displayStartTime = CACurrentMediaTime();
+                    
+                    self.batchCompletion(completionModels, finished);
+                    
+                    [self.statistics _recordMainThreadTime:CACurrentMediaTime() - displayStartTime keystroke:NO];
+                }
             });
+            
+            if (finished) {
+                [self _finish];
+            }
+        };
+        
+        if ([delegate respondsToSelector:@selector(tokenTextView:completionModelsForSubstring:indexOfRepresentedObject:cancellationToken:batchCompletion:)]) {
+            [delegate tokenTextView:self.tokenTextView completionModelsForSubstring:self.substring indexOfRepresentedObject:self.index cancellationToken:self.cancellationToken batchCompletion:batchCompletion];
+        }
+        else {
+            [delegate tokenTextView:self.tokenTextView completionModelsForSubstring:self.substring indexOfRepresentedObject:self.index batchCompletion:batchCompletion];
         }
         
-        [self setExecuting:NO];
-        [self setFinished:YES];
-    }];
+        [self _awaitProvider];
+    }
+    else {
+        void(^completion)(NSArray<id<KSOTokenCompletionModel>> *) = ^(NSArray<id<KSOTokenCompletionModel>> * _Nullable completionModels) {
+            kstStrongify(self);
+            if (self == nil) {
+                return;
+            }
+            
+            if (!self.isCancelled) {
+                KSTDispatchMainAsync(^{
+                    if (!self.isCancelled &&
+                        [self _resolve]) {
+                        
+                        [self.statistics _recordCompletedQuery];
+                        [self.tokenTextView _endMetricsStage:KSOTokenMetricsStageCompletionOperation interval:self.metricsInterval];
+                        [self.tokenTextView _recordCompletionLatency:CACurrentMediaTime() - self.creationTime cancelled:NO];
+                        
+                        CFTimeInterval displayStartTime = CACurrentMediaTime();
+                        
+                        self.completion(completionModels);
+                        
+                        [self.statistics _recordMainThreadTime:CACurrentMediaTime() - displayStartTime keystroke:NO];
+                    }
+                });
+            }
+            
+            [self _finish];
+        };
+        
+        if ([delegate respondsToSelector:@selector(tokenTextView:completionModelsForSubstring:indexOfRepresentedObject:cancellationToken:completion:)]) {
+            [delegate tokenTextView:self.tokenTextView completionModelsForSubstring:self.substring indexOfRepresentedObject:self.index cancellationToken:self.cancellationToken completion:completion];
+            [self _awaitProvider];
+        }
+        else if ([delegate respondsToSelector:@selector(tokenTextView:completionModelsForSubstring:indexOfRepresentedObject:completion:)]) {
+            [delegate tokenTextView:self.tokenTextView completionModelsForSubstring:self.substring indexOfRepresentedObject:self.index completion:completion];
+            [self _awaitProvider];
+        }
+        // the synchronous call finishes the receiver once the delegate returns, finishing any earlier would let the next query call the delegate while this one still is
+        else {
+            completion([delegate tokenTextView:self.tokenTextView completionModelsForSubstring:self.substring indexOfRepresentedObject:self.index]);
+        }
+    }
+    
+    // whatever the delegate did synchronously blocked the main thread
+    if (NSThread.isMainThread) {
+        [self.statistics _recordMainThreadTime:CACurrentMediaTime() - startTime keystroke:NO];
+    }
+}
+- (void)cancel {
+    [super cancel];
+    
+    // let a provider that is still searching stop right away
+    [self.cancellationToken cancel];
+    
+    // only queries that were started and have not displayed their results count as cancelled
+    if (self.isStarted &&
+        [self _resolve]) {
+        
+        [self.statistics _recordCancelledQuery];
+        [self.tokenTextView _endMetricsStage:KSOTokenMetricsStageCompletionOperation interval:self.metricsInterval];
+        [self.tokenTextView _incrementMetricsCounter:KSOTokenMetricsCounterCompletionCancellation];
+        [self.tokenTextView _recordCompletionLatency:CACurrentMediaTime() - self.creationTime cancelled:YES];
+    }
+    
+    // a provider that is still working asynchronously would hold up the queue, a delegate call that has not returned must finish first so delegate calls never overlap
+    @synchronized (self) {
+        if (self.isExecuting &&
+            self.isAwaitingProvider) {
+            
+            [self _finish];
+        }
+    }
 }
 
 - (BOOL)isAsynchronous {
@@ -79,9 +209,30 @@
         return nil;
  
     _tokenTextView = tokenTextView;
+    _delegate = tokenTextView.delegate;
+    _statistics = tokenTextView.completionStatistics;
     _substring = [substring copy];
     _index = index;
     _completion = [completion copy];
+    _cancellationToken = [[KSOTokenCompletionCancellationToken alloc] init];
+    _metricsInterval = [tokenTextView _beginMetricsStage:KSOTokenMetricsStageCompletionOperation];
+    _creationTime = CACurrentMediaTime();
+    
+    return self;
+}
+- (instancetype)initWithTokenTextView:(KSOTokenTextView *)tokenTextView substring:(NSString *)substring index:(NSUInteger)index batchCompletion:(void (^)(NSArray<id<KSOTokenCompletionModel>> * _Nullable, BOOL))batchCompletion {
+    if (!(self = [super init]))
+        return nil;
+    
+    _tokenTextView = tokenTextView;
+    _delegate = tokenTextView.delegate;
+    _statistics = tokenTextView.completionStatistics;
+    _substring = [substring copy];
+    _index = index;
+    _batchCompletion = [batchCompletion copy];
+    _cancellationToken = [[KSOTokenCompletionCancellationToken alloc] init];
+    _metricsInterval = [tokenTextView _beginMetricsStage:KSOTokenMetricsStageCompletionOperation];
+    _creationTime = CACurrentMediaTime();
     
     return self;
 }
@@ -104,4 +255,36 @@
     [self didChangeValueForKey:@kstKeypath(self,isFinished)];
 }
 
+- (void)_finish; {
+    @synchronized (self) {
+        if (self.isFinished) {
+            return;
+        }
+        
+        [self setExecuting:NO];
+        [self setFinished:YES];
+    }
+}
+- (void)_awaitProvider; {
+    @synchronized (self) {
+        [self setAwaitingProvider:YES];
+        
+        // the query was cancelled while the delegate was still being called
+        if (self.isCancelled) {
+            [self _finish];
+        }
+    }
+}
+- (BOOL)_resolve; {
+    @synchronized (self) {
+        if (self.isResolved) {
+            return NO;
+        }
+        
+        [self setResolved:YES];
+        
+        return YES;
+    }
+}
+
 @end
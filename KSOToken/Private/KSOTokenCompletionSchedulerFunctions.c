@@ -0,0 +1,90 @@
+//
+//  KSOTokenCompletionSchedulerFunctions.c
+//  KSOToken
+//
+//  Created by William Towe on 10/17/26.
+//  Copyright © 2021 Kosoku Interactive, LLC. All rights reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+#include "KSOTokenCompletionSchedulerFunctions.h"
+
+// how much each new sample moves an average, higher adapts faster and smooths less
+static const double kKSOTokenCompletionSchedulerWeight = 0.3;
+// providers that answer within a frame are queried on every keystroke
+static const double kKSOTokenCompletionSchedulerImmediateLatency = 1.0 / 60.0;
+// longer gaps between keystrokes are pauses, not typing speed
+static const double kKSOTokenCompletionSchedulerMaximumKeystrokeInterval = 1.0;
+// debouncing waits a little longer than the usual gap between keystrokes, up to a limit so a slow typist still sees completions
+static const double kKSOTokenCompletionSchedulerDebounceFactor = 1.5;
+static const double kKSOTokenCompletionSchedulerMaximumDebounceDelay = 0.5;
+
+static double KSOTokenCompletionSchedulerAverage(double average, double sample) {
+    return average < 0.0 ? sample : average + kKSOTokenCompletionSchedulerWeight * (sample - average);
+}
+
+void KSOTokenCompletionSchedulerInit(KSOTokenCompletionScheduler *scheduler) {
+    scheduler->latency = -1.0;
+    scheduler->keystrokeInterval = -1.0;
+    scheduler->lastKeystrokeTime = -1.0;
+    scheduler->lastDispatchTime = -1.0;
+    scheduler->policy = KSOTokenCompletionSchedulerPolicyImmediate;
+    scheduler->delay = 0.0;
+}
+double KSOTokenCompletionSchedulerKeystroke(KSOTokenCompletionScheduler *scheduler, double time) {
+    if (scheduler->lastKeystrokeTime >= 0.0) {
+        double interval = time - scheduler->lastKeystrokeTime;
+        
+        if (interval >= 0.0 &&
+            interval <= kKSOTokenCompletionSchedulerMaximumKeystrokeInterval) {
+            
+            scheduler->keystrokeInterval = KSOTokenCompletionSchedulerAverage(scheduler->keystrokeInterval, interval);
+        }
+    }
+    
+    scheduler->lastKeystrokeTime = time;
+    
+    if (scheduler->latency <= kKSOTokenCompletionSchedulerImmediateLatency) {
+        scheduler->policy = KSOTokenCompletionSchedulerPolicyImmediate;
+        scheduler->delay = 0.0;
+    }
+    else if (scheduler->keystrokeInterval < 0.0 ||
+             scheduler->latency < scheduler->keystrokeInterval) {
+        
+        // the leading keystroke queries right away, the ones after it wait until the query before them has had time to answer
+        double next = scheduler->lastDispatchTime < 0.0 ? time : scheduler->lastDispatchTime + scheduler->latency;
+        
+        scheduler->policy = KSOTokenCompletionSchedulerPolicyThrottle;
+        scheduler->delay = next > time ? next - time : 0.0;
+    }
+    else {
+        double delay = scheduler->keystrokeInterval * kKSOTokenCompletionSchedulerDebounceFactor;
+        
+        scheduler->policy = KSOTokenCompletionSchedulerPolicyDebounce;
+        scheduler->delay = delay < kKSOTokenCompletionSchedulerMaximumDebounceDelay ? delay : kKSOTokenCompletionSchedulerMaximumDebounceDelay;
+    }
+    
+    return scheduler->delay;
+}
+void KSOTokenCompletionSchedulerDispatch(KSOTokenCompletionScheduler *scheduler, double time) {
+    scheduler->lastDispatchTime = time;
+}
+void KSOTokenCompletionSchedulerRecordLatency(KSOTokenCompletionScheduler *scheduler, double latency, bool cancelled) {
+    if (latency < 0.0 ||
+        (cancelled && latency <= scheduler->latency)) {
+        
+        return;
+    }
+    
+    scheduler->latency = KSOTokenCompletionSchedulerAverage(scheduler->latency, latency);
+}
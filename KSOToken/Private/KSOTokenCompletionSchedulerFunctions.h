@@ -0,0 +1,75 @@
+//
+//  KSOTokenCompletionSchedulerFunctions.h
+//  KSOToken
+//
+//  Created by William Towe on 10/17/26.
+//  Copyright © 2021 Kosoku Interactive, LLC. All rights reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+#ifndef KSOTokenCompletionSchedulerFunctions_h
+#define KSOTokenCompletionSchedulerFunctions_h
+
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ Enum describing when a completion query is sent after a keystroke, the values match KSOTokenCompletionsSchedulingPolicy.
+ */
+typedef enum {
+    // query on every keystroke, the provider answers faster than a frame
+    KSOTokenCompletionSchedulerPolicyImmediate = 0,
+    // query on the first keystroke, then at most once per provider latency, the provider answers faster than the user types
+    KSOTokenCompletionSchedulerPolicyThrottle = 1,
+    // query once the user pauses, the provider is slower than the user types so every other query would be cancelled
+    KSOTokenCompletionSchedulerPolicyDebounce = 2
+} KSOTokenCompletionSchedulerPolicy;
+
+/**
+ Exponentially weighted moving averages of the provider latency and the time between keystrokes, and the policy they chose. Times are in seconds, negative values are unknown.
+ */
+typedef struct {
+    double latency;
+    double keystrokeInterval;
+    double lastKeystrokeTime;
+    double lastDispatchTime;
+    KSOTokenCompletionSchedulerPolicy policy;
+    // the delay chosen for the last keystroke
+    double delay;
+} KSOTokenCompletionScheduler;
+
+/**
+ Initializes *scheduler* with nothing measured, which chooses KSOTokenCompletionSchedulerPolicyImmediate so the first query measures the provider.
+ */
+void KSOTokenCompletionSchedulerInit(KSOTokenCompletionScheduler *scheduler);
+/**
+ Records a keystroke at *time* and returns how long to wait before querying for it. Pending queries for earlier keystrokes should be replaced by the returned delay.
+ */
+double KSOTokenCompletionSchedulerKeystroke(KSOTokenCompletionScheduler *scheduler, double time);
+/**
+ Records that a query was sent to the provider at *time*.
+ */
+void KSOTokenCompletionSchedulerDispatch(KSOTokenCompletionScheduler *scheduler, double time);
+/**
+ Records the *latency* of a query. When *cancelled* the query was superseded before it was answered and its latency is only a lower bound, which is recorded only if it is longer than the average.
+ */
+void KSOTokenCompletionSchedulerRecordLatency(KSOTokenCompletionScheduler *scheduler, double latency, bool cancelled);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
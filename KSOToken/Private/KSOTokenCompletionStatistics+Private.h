@@ -0,0 +1,38 @@
+//
+//  KSOTokenCompletionStatistics+Private.h
+//  KSOToken
+//
+//  Created by William Towe on 10/17/26.
+//  Copyright © 2021 Kosoku Interactive, LLC. All rights reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+#import "KSOTokenCompletionStatistics.h"
+#import "KSOTokenCompletionSchedulerFunctions.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+// used by KSOTokenCompletionOperation and KSOTokenTextView to record the outcome of each query and the time it took on the main thread
+@interface KSOTokenCompletionStatistics ()
+
+- (void)_recordStartedQuery;
+- (void)_recordCancelledQuery;
+- (void)_recordCompletedQuery;
+// keystroke is YES for the time spent starting a lookup, and NO for the time spent displaying its results later
+- (void)_recordMainThreadTime:(NSTimeInterval)time keystroke:(BOOL)keystroke;
+// copies the averages and the policy chosen for the last keystroke from the scheduler of the text view
+- (void)_recordScheduler:(const KSOTokenCompletionScheduler *)scheduler policy:(KSOTokenCompletionsSchedulingPolicy)policy delay:(NSTimeInterval)delay;
+
+@end
+
+NS_ASSUME_NONNULL_END
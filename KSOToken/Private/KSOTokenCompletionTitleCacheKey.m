@@ -0,0 +1,73 @@
+//
+//  KSOTokenCompletionTitleCacheKey.m
+//  KSOToken
+//
+//  Created by William Towe on 10/17/26.
+//  Copyright © 2021 Kosoku Interactive, LLC. All rights reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+#import "KSOTokenCompletionTitleCacheKey.h"
+
+@interface KSOTokenCompletionTitleCacheKey ()
+@property (copy,nonatomic) NSString *title;
+@property (copy,nonatomic) NSIndexSet *matchingIndexes;
+@property (strong,nonatomic) UIFont *font;
+@property (strong,nonatomic) UIColor *textColor;
+@property (strong,nonatomic) UIColor *highlightBackgroundColor;
+@property (assign,nonatomic) NSUInteger hashValue;
+@end
+
+@implementation KSOTokenCompletionTitleCacheKey
+
+- (BOOL)isEqual:(id)object {
+    if (self == object) {
+        return YES;
+    }
+    else if (![object isKindOfClass:KSOTokenCompletionTitleCacheKey.class]) {
+        return NO;
+    }
+    
+    KSOTokenCompletionTitleCacheKey *other = (KSOTokenCompletionTitleCacheKey *)object;
+    
+    return (self.hashValue == other.hashValue &&
+            [self.title isEqualToString:other.title] &&
+            (self.matchingIndexes == other.matchingIndexes || [self.matchingIndexes isEqualToIndexSet:other.matchingIndexes]) &&
+            [self.font isEqual:other.font] &&
+            [self.textColor isEqual:other.textColor] &&
+            [self.highlightBackgroundColor isEqual:other.highlightBackgroundColor]);
+}
+- (NSUInteger)hash {
+    return self.hashValue;
+}
+
+- (id)copyWithZone:(NSZone *)zone {
+    return self;
+}
+
+- (instancetype)initWithTitle:(NSString *)title matchingIndexes:(NSIndexSet *)matchingIndexes font:(UIFont *)font textColor:(UIColor *)textColor highlightBackgroundColor:(UIColor *)highlightBackgroundColor {
+    if (!(self = [super init]))
+        return nil;
+    
+    _title = [title copy];
+    _matchingIndexes = [matchingIndexes copy];
+    _font = font;
+    _textColor = textColor;
+    _highlightBackgroundColor = highlightBackgroundColor;
+    // the same title is usually shown with different matching ranges as the user types, mix in where they start
+    _hashValue = title.hash ^ (font.hash * 31) ^ (matchingIndexes == nil ? 0 : (matchingIndexes.firstIndex << 11) ^ matchingIndexes.count);
+    
+    return self;
+}
+
+@end
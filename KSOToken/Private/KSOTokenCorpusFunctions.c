@@ -0,0 +1,248 @@
+//
+//  KSOTokenCorpusFunctions.c
+//  KSOToken
+//
+//  Created by William Towe on 10/17/26.
+//  Copyright © 2021 Kosoku Interactive, LLC. All rights reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+#include "KSOTokenCorpusFunctions.h"
+#include "KSOTokenCompletionIndexFunctions.h"
+#include "KSOTokenFuzzyMatchFunctions.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static const uint8_t kKSOTokenCorpusMagic[4] = {'K', 'S', 'O', 'C'};
+// read back as 0x04030201 on a host with the other byte order
+static const uint32_t kKSOTokenCorpusByteOrderMark = 0x01020304;
+
+typedef struct {
+    uint8_t magic[4];
+    uint32_t version;
+    uint32_t byteOrderMark;
+    uint32_t flags;
+    uint32_t count;
+    uint32_t charactersLength;
+    uint32_t suffixesCount;
+    uint32_t prefixesCount;
+} KSOTokenCorpusHeader;
+
+typedef enum {
+    KSOTokenCorpusSectionCharacters,
+    KSOTokenCorpusSectionFoldedCharacters,
+    KSOTokenCorpusSectionOffsets,
+    KSOTokenCorpusSectionSuffixes,
+    KSOTokenCorpusSectionPrefixes,
+    KSOTokenCorpusSectionMasks,
+    KSOTokenCorpusSectionWeights,
+    KSOTokenCorpusSectionCount
+} KSOTokenCorpusSection;
+
+static uint64_t KSOTokenCorpusAlign(uint64_t value) {
+    return (value + 7) & ~(uint64_t)7;
+}
+// computes where each section begins and returns the total length, the counts are at most UINT32_MAX so this cannot overflow
+static uint64_t KSOTokenCorpusLayout(const KSOTokenCorpusHeader *header, uint64_t outOffsets[KSOTokenCorpusSectionCount], uint64_t outLengths[KSOTokenCorpusSectionCount]) {
+    outLengths[KSOTokenCorpusSectionCharacters] = sizeof(uint16_t) * (uint64_t)header->charactersLength;
+    outLengths[KSOTokenCorpusSectionFoldedCharacters] = sizeof(uint16_t) * (uint64_t)header->charactersLength;
+    outLengths[KSOTokenCorpusSectionOffsets] = sizeof(uint32_t) * ((uint64_t)header->count + 1);
+    outLengths[KSOTokenCorpusSectionSuffixes] = sizeof(uint32_t) * (uint64_t)header->suffixesCount;
+    outLengths[KSOTokenCorpusSectionPrefixes] = sizeof(uint32_t) * (uint64_t)header->prefixesCount;
+    outLengths[KSOTokenCorpusSectionMasks] = sizeof(uint64_t) * (uint64_t)header->count;
+    outLengths[KSOTokenCorpusSectionWeights] = (header->flags & KSOTokenCorpusFlagsWeights) ? sizeof(float) * (uint64_t)header->count : 0;
+    
+    uint64_t retval = KSOTokenCorpusAlign(sizeof(KSOTokenCorpusHeader));
+    
+    for (size_t i=0; i<KSOTokenCorpusSectionCount; i++) {
+        outOffsets[i] = retval;
+        retval = KSOTokenCorpusAlign(retval + outLengths[i]);
+    }
+    
+    return retval;
+}
+static bool KSOTokenCorpusHeaderInit(KSOTokenCorpusHeader *header, const KSOTokenCorpus *corpus) {
+    if (corpus->count >= UINT32_MAX ||
+        corpus->charactersLength > UINT32_MAX ||
+        corpus->suffixesCount > UINT32_MAX ||
+        corpus->prefixesCount > UINT32_MAX) {
+        
+        return false;
+    }
+    
+    memcpy(header->magic, kKSOTokenCorpusMagic, sizeof(kKSOTokenCorpusMagic));
+    header->version = KSOTokenCorpusVersion;
+    header->byteOrderMark = kKSOTokenCorpusByteOrderMark;
+    header->flags = corpus->weights == NULL ? KSOTokenCorpusFlagsNone : KSOTokenCorpusFlagsWeights;
+    header->count = (uint32_t)corpus->count;
+    header->charactersLength = (uint32_t)corpus->charactersLength;
+    header->suffixesCount = (uint32_t)corpus->suffixesCount;
+    header->prefixesCount = (uint32_t)corpus->prefixesCount;
+    
+    return true;
+}
+
+bool KSOTokenCorpusCreateSections(KSOTokenCorpus *corpus) {
+    size_t length = corpus->charactersLength;
+    size_t count = corpus->count;
+    uint16_t *foldedCharacters = malloc(sizeof(uint16_t) * (length > 0 ? length : 1));
+    uint32_t *prefixes = malloc(sizeof(uint32_t) * (count > 0 ? count : 1));
+    uint64_t *masks = malloc(sizeof(uint64_t) * (count > 0 ? count : 1));
+    uint32_t *suffixes = NULL;
+    size_t suffixesCount = 0;
+    size_t prefixesCount = 0;
+    
+    if (foldedCharacters != NULL) {
+        KSOTokenFoldCharacters(corpus->characters, foldedCharacters, length);
+        
+        suffixes = KSOTokenSuffixArrayCreate(foldedCharacters, length, &suffixesCount);
+    }
+    
+    if (foldedCharacters == NULL ||
+        prefixes == NULL ||
+        masks == NULL ||
+        suffixes == NULL) {
+        
+        free(foldedCharacters);
+        free(prefixes);
+        free(masks);
+        free(suffixes);
+        return false;
+    }
+    
+    // the suffixes that begin an entry, in suffix order, are the entries sorted by their folded characters
+    for (size_t i=0; i<suffixesCount; i++) {
+        uint32_t position = suffixes[i];
+        
+        if (position == 0 ||
+            foldedCharacters[position - 1] == 0) {
+            
+            prefixes[prefixesCount++] = position;
+        }
+    }
+    
+    for (size_t i=0; i<count; i++) {
+        masks[i] = KSOTokenFuzzyCharactersMask(foldedCharacters + corpus->offsets[i], corpus->offsets[i + 1] - corpus->offsets[i] - 1);
+    }
+    
+    corpus->foldedCharacters = foldedCharacters;
+    corpus->suffixes = suffixes;
+    corpus->suffixesCount = suffixesCount;
+    corpus->prefixes = prefixes;
+    corpus->prefixesCount = prefixesCount;
+    corpus->masks = masks;
+    
+    return true;
+}
+void KSOTokenCorpusDestroySections(KSOTokenCorpus *corpus) {
+    free((void *)corpus->foldedCharacters);
+    free((void *)corpus->suffixes);
+    free((void *)corpus->prefixes);
+    free((void *)corpus->masks);
+    
+    corpus->foldedCharacters = NULL;
+    corpus->suffixes = NULL;
+    corpus->suffixesCount = 0;
+    corpus->prefixes = NULL;
+    corpus->prefixesCount = 0;
+    corpus->masks = NULL;
+}
+
+size_t KSOTokenCorpusWriteLength(const KSOTokenCorpus *corpus) {
+    KSOTokenCorpusHeader header;
+    uint64_t offsets[KSOTokenCorpusSectionCount];
+    uint64_t lengths[KSOTokenCorpusSectionCount];
+    
+    if (!KSOTokenCorpusHeaderInit(&header, corpus)) {
+        return 0;
+    }
+    
+    uint64_t retval = KSOTokenCorpusLayout(&header, offsets, lengths);
+    
+    return retval > SIZE_MAX ? 0 : (size_t)retval;
+}
+void KSOTokenCorpusWrite(const KSOTokenCorpus *corpus, uint8_t *bytes) {
+    KSOTokenCorpusHeader header;
+    uint64_t offsets[KSOTokenCorpusSectionCount];
+    uint64_t lengths[KSOTokenCorpusSectionCount];
+    
+    if (!KSOTokenCorpusHeaderInit(&header, corpus)) {
+        return;
+    }
+    
+    uint64_t length = KSOTokenCorpusLayout(&header, offsets, lengths);
+    const void *sections[KSOTokenCorpusSectionCount] = {corpus->characters, corpus->foldedCharacters, corpus->offsets, corpus->suffixes, corpus->prefixes, corpus->masks, corpus->weights};
+    
+    // zero the padding, so the same corpus always writes the same bytes
+    memset(bytes, 0, (size_t)length);
+    memcpy(bytes, &header, sizeof(header));
+    
+    for (size_t i=0; i<KSOTokenCorpusSectionCount; i++) {
+        if (lengths[i] > 0) {
+            memcpy(bytes + offsets[i], sections[i], (size_t)lengths[i]);
+        }
+    }
+}
+bool KSOTokenCorpusOpen(KSOTokenCorpus *outCorpus, const uint8_t *bytes, size_t length) {
+    KSOTokenCorpusHeader header;
+    uint64_t offsets[KSOTokenCorpusSectionCount];
+    uint64_t lengths[KSOTokenCorpusSectionCount];
+    
+    // the sections are read in place, so they must be aligned like the arrays they are
+    if (length < sizeof(header) ||
+        ((uintptr_t)bytes & 7) != 0) {
+        
+        return false;
+    }
+    
+    memcpy(&header, bytes, sizeof(header));
+    
+    if (memcmp(header.magic, kKSOTokenCorpusMagic, sizeof(kKSOTokenCorpusMagic)) != 0 ||
+        header.version != KSOTokenCorpusVersion ||
+        header.byteOrderMark != kKSOTokenCorpusByteOrderMark ||
+        (header.flags & ~(uint32_t)KSOTokenCorpusFlagsWeights) != 0 ||
+        header.count == UINT32_MAX ||
+        header.suffixesCount > header.charactersLength ||
+        header.prefixesCount > header.count ||
+        KSOTokenCorpusLayout(&header, offsets, lengths) != (uint64_t)length) {
+        
+        return false;
+    }
+    
+    const uint16_t *characters = (const uint16_t *)(bytes + offsets[KSOTokenCorpusSectionCharacters]);
+    const uint16_t *foldedCharacters = (const uint16_t *)(bytes + offsets[KSOTokenCorpusSectionFoldedCharacters]);
+    const uint32_t *corpusOffsets = (const uint32_t *)(bytes + offsets[KSOTokenCorpusSectionOffsets]);
+    
+    // every search stops at a terminator, so the last one keeps a corrupt corpus from being read past its end
+    if (corpusOffsets[0] != 0 ||
+        corpusOffsets[header.count] != header.charactersLength ||
+        (header.charactersLength > 0 && (characters[header.charactersLength - 1] != 0 || foldedCharacters[header.charactersLength - 1] != 0))) {
+        
+        return false;
+    }
+    
+    outCorpus->characters = characters;
+    outCorpus->foldedCharacters = foldedCharacters;
+    outCorpus->charactersLength = header.charactersLength;
+    outCorpus->offsets = corpusOffsets;
+    outCorpus->count = header.count;
+    outCorpus->suffixes = (const uint32_t *)(bytes + offsets[KSOTokenCorpusSectionSuffixes]);
+    outCorpus->suffixesCount = header.suffixesCount;
+    outCorpus->prefixes = (const uint32_t *)(bytes + offsets[KSOTokenCorpusSectionPrefixes]);
+    outCorpus->prefixesCount = header.prefixesCount;
+    outCorpus->masks = (const uint64_t *)(bytes + offsets[KSOTokenCorpusSectionMasks]);
+    outCorpus->weights = (header.flags & KSOTokenCorpusFlagsWeights) ? (const float *)(bytes + offsets[KSOTokenCorpusSectionWeights]) : NULL;
+    
+    return true;
+}
@@ -0,0 +1,104 @@
+//
+//  KSOTokenCorpusFunctions.h
+//  KSOToken
+//
+//  Created by William Towe on 10/17/26.
+//  Copyright © 2021 Kosoku Interactive, LLC. All rights reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+#ifndef KSOTokenCorpusFunctions_h
+#define KSOTokenCorpusFunctions_h
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ Corpus files are the sections of a KSOTokenCompletionIndex written in the byte order of the host, so they can be mapped and queried in place:
+ 
+ magic "KSOC", version, byte order mark 0x01020304, flags, count, characters length, suffixes count and prefixes count, each uint32
+ characters, folded characters, offsets, suffixes, prefixes, masks and, if flags has KSOTokenCorpusFlagsWeights, weights
+ 
+ Each section begins on an 8 byte boundary, the padding between sections is zeroed.
+ */
+
+/**
+ The version written by KSOTokenCorpusWrite, corpora with any other version are rejected.
+ */
+#define KSOTokenCorpusVersion ((uint32_t)1)
+
+/**
+ Options describing the optional sections of a corpus.
+ */
+typedef enum {
+    KSOTokenCorpusFlagsNone = 0,
+    // the corpus has one weight per entry
+    KSOTokenCorpusFlagsWeights = 1 << 0
+} KSOTokenCorpusFlags;
+
+/**
+ The sections of a completion index, laid out like KSOTokenCompletionIndex. Each entry of characters is terminated by 0 and offsets has one extra element for the total length. When opened, every section points into the bytes of the corpus.
+ */
+typedef struct {
+    const uint16_t *characters;
+    // case folded characters, parallel to characters
+    const uint16_t *foldedCharacters;
+    size_t charactersLength;
+    const uint32_t *offsets;
+    size_t count;
+    // suffix array over foldedCharacters
+    const uint32_t *suffixes;
+    size_t suffixesCount;
+    // start of each non-empty entry, sorted by its folded characters
+    const uint32_t *prefixes;
+    size_t prefixesCount;
+    // character class mask of each entry
+    const uint64_t *masks;
+    // weight of each entry, NULL if the corpus has no weights
+    const float *weights;
+} KSOTokenCorpus;
+
+/**
+ Creates the folded characters, suffixes, prefixes and masks of *corpus* from its characters and offsets, which must already be set. The created sections are malloc'd and owned by the caller, free them with KSOTokenCorpusDestroySections. Returns false on allocation failure, in which case nothing is created.
+ */
+bool KSOTokenCorpusCreateSections(KSOTokenCorpus *corpus);
+/**
+ Frees the sections created by KSOTokenCorpusCreateSections.
+ */
+void KSOTokenCorpusDestroySections(KSOTokenCorpus *corpus);
+
+/**
+ Returns the number of bytes KSOTokenCorpusWrite writes for *corpus*, or 0 if any of its sections is too long to be written.
+ */
+size_t KSOTokenCorpusWriteLength(const KSOTokenCorpus *corpus);
+/**
+ Writes *corpus* to *bytes*, which must have room for KSOTokenCorpusWriteLength bytes.
+ */
+void KSOTokenCorpusWrite(const KSOTokenCorpus *corpus, uint8_t *bytes);
+/**
+ Points the sections of *outCorpus* into *length* bytes from *bytes*, which must be 8 byte aligned and outlive it. Nothing is copied and only the header and the last terminator are read, so opening is constant time no matter how large the corpus is. Returns false if the magic, version, byte order or any length is invalid.
+ 
+ The positions within the offsets, suffixes and prefixes are not validated, which would mean reading the entire corpus, so corpora must come from a trusted source like the bundle of the app.
+ */
+bool KSOTokenCorpusOpen(KSOTokenCorpus *outCorpus, const uint8_t *bytes, size_t length);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,34 @@
+//
+//  KSOTokenDefaultTextAttachment+Private.h
+//  KSOToken
+//
+//  Created by William Towe on 10/17/26.
+//  Copyright © 2021 Kosoku Interactive, LLC. All rights reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+
+#import "KSOTokenDefaultTextAttachment.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+@interface KSOTokenDefaultTextAttachment ()
+
+// used by KSOTokenTextView to have its tokens measured and rendered again after a change the attachments cannot observe, like the appearance of the text view
+- (void)_setNeedsUpdateImages;
+// used by KSOTokenTextView when its width changes, only tokens that are limited to the width of the text view, or would be now, are measured again
+- (void)_maximumImageWidthDidChange;
+
+@end
+
+NS_ASSUME_NONNULL_END
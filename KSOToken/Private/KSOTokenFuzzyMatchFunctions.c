@@ -0,0 +1,311 @@
+//
+//  KSOTokenFuzzyMatchFunctions.c
+//  KSOToken
+//
+//  Created by William Towe on 10/17/26.
+//  Copyright © 2021 Kosoku Interactive, LLC. All rights reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+#include "KSOTokenFuzzyMatchFunctions.h"
+
+#include <string.h>
+
+// longest pattern that typo matching is attempted for, which bounds the rows below
+#define KSOTokenFuzzyMaximumTypoLength 64
+#define KSOTokenFuzzyMaximumDistance 3
+
+static inline uint64_t KSOTokenFuzzyCharacterBit(uint16_t c) {
+    if (c >= 'a' && c <= 'z') {
+        return (uint64_t)1 << (c - 'a');
+    }
+    else if (c >= '0' && c <= '9') {
+        return (uint64_t)1 << (26 + c - '0');
+    }
+    else if (c < 0x80) {
+        return (uint64_t)1 << (36 + c % 12);
+    }
+    return (uint64_t)1 << (48 + c % 16);
+}
+static inline bool KSOTokenFuzzyIsSeparator(uint16_t c) {
+    return c < 0x80 && !((c >= 'a' && c <= 'z') || (c >= '0' && c <= '9'));
+}
+static inline uint8_t KSOTokenFuzzyMinimum(uint8_t a, uint8_t b) {
+    return a < b ? a : b;
+}
+
+uint64_t KSOTokenFuzzyCharactersMask(const uint16_t *characters, size_t length) {
+    uint64_t retval = 0;
+    
+    for (size_t i=0; i<length; i++) {
+        retval |= KSOTokenFuzzyCharacterBit(characters[i]);
+    }
+    
+    return retval;
+}
+
+void KSOTokenFuzzyPatternInit(KSOTokenFuzzyPattern *pattern, const uint16_t *characters, size_t length, size_t maximumDistance) {
+    pattern->characters = characters;
+    pattern->length = length;
+    pattern->mask = KSOTokenFuzzyCharactersMask(characters, length);
+    pattern->maximumDistance = length > KSOTokenFuzzyMaximumTypoLength ? 0 : maximumDistance;
+    
+    if (pattern->maximumDistance > length / 3) {
+        pattern->maximumDistance = length / 3;
+    }
+    if (pattern->maximumDistance > KSOTokenFuzzyMaximumDistance) {
+        pattern->maximumDistance = KSOTokenFuzzyMaximumDistance;
+    }
+}
+
+size_t KSOTokenFuzzyPatternPositionsCapacity(const KSOTokenFuzzyPattern *pattern) {
+    return pattern->length + pattern->maximumDistance;
+}
+
+size_t KSOTokenFuzzyFilterMasks(const uint64_t *masks, size_t count, const KSOTokenFuzzyPattern *pattern, uint32_t *outIndexes) {
+    uint64_t mask = pattern->mask;
+    size_t maximumDistance = pattern->maximumDistance;
+    size_t retval = 0;
+    
+    if (maximumDistance == 0) {
+        for (size_t i=0; i<count; i++) {
+            outIndexes[retval] = (uint32_t)i;
+            retval += (mask & ~masks[i]) == 0;
+        }
+    }
+    else {
+        // each character class missing from an entry costs at least one edit
+        for (size_t i=0; i<count; i++) {
+            outIndexes[retval] = (uint32_t)i;
+            retval += (size_t)__builtin_popcountll(mask & ~masks[i]) <= maximumDistance;
+        }
+    }
+    
+    return retval;
+}
+
+static bool KSOTokenFuzzySubsequenceMatch(const KSOTokenFuzzyPattern *pattern, const uint16_t *characters, size_t length, uint32_t *outPositions, KSOTokenFuzzyMatchResult *outResult) {
+    const uint16_t *p = pattern->characters;
+    size_t m = pattern->length;
+    size_t pi = 0;
+    size_t end = 0;
+    
+    // find where the leftmost match ends
+    for (size_t i=0; i<length; i++) {
+        if (characters[i] == p[pi] &&
+            ++pi == m) {
+            
+            end = i;
+            break;
+        }
+    }
+    
+    if (pi < m) {
+        return false;
+    }
+    
+    // walk back from the end to find the shortest match ending there, "ab" within "axab" should highlight the last two characters
+    size_t start = end;
+    
+    for (size_t i=end + 1; i-- > 0;) {
+        if (characters[i] == p[pi - 1] &&
+            --pi == 0) {
+            
+            start = i;
+            break;
+        }
+    }
+    
+    int32_t score = 0;
+    size_t previous = SIZE_MAX;
+    
+    pi = 0;
+    
+    for (size_t i=start; i<=end && pi<m; i++) {
+        if (characters[i] != p[pi]) {
+            continue;
+        }
+        
+        score += 16;
+        
+        if (i == 0) {
+            score += 16;
+        }
+        else if (KSOTokenFuzzyIsSeparator(characters[i - 1])) {
+            score += 10;
+        }
+        
+        if (previous == SIZE_MAX) {
+            score -= (int32_t)(i < 8 ? i : 8);
+        }
+        else if (i == previous + 1) {
+            score += 12;
+        }
+        else {
+            size_t gap = i - previous - 1;
+            
+            score -= (int32_t)(3 + (gap < 8 ? gap : 8));
+        }
+        
+        if (outPositions != NULL) {
+            outPositions[pi] = (uint32_t)i;
+        }
+        
+        previous = i;
+        pi++;
+    }
+    
+    size_t extra = length - m;
+    
+    // shorter entries are closer matches
+    score -= (int32_t)((extra < 64 ? extra : 64) / 4);
+    
+    outResult->score = score;
+    outResult->distance = 0;
+    outResult->location = (uint32_t)start;
+    outResult->positionsCount = (uint32_t)m;
+    
+    return true;
+}
+
+static bool KSOTokenFuzzyTypoMatch(const KSOTokenFuzzyPattern *pattern, const uint16_t *characters, size_t length, uint32_t *outPositions, KSOTokenFuzzyMatchResult *outResult) {
+    const uint16_t *p = pattern->characters;
+    size_t m = pattern->length;
+    size_t k = pattern->maximumDistance;
+    
+    if (k == 0 ||
+        length + k < m) {
+        
+        return false;
+    }
+    
+    // only columns within k of the diagonal can hold distances <= k, everything else is treated as k + 1
+    size_t n = length < m + k ? length : m + k;
+    
+    // the entry mask may include characters past the columns that are compared, check those columns alone before filling any rows
+    if ((size_t)__builtin_popcountll(pattern->mask & ~KSOTokenFuzzyCharactersMask(characters, n)) > k) {
+        return false;
+    }
+    
+    uint8_t infinity = (uint8_t)(k + 1);
+    uint8_t rows[3][KSOTokenFuzzyMaximumTypoLength + KSOTokenFuzzyMaximumDistance + 2];
+    uint8_t *previous2 = rows[0];
+    uint8_t *previous = rows[1];
+    uint8_t *current = rows[2];
+    
+    for (size_t j=0; j<=n + 1; j++) {
+        previous[j] = j <= k ? (uint8_t)j : infinity;
+        previous2[j] = infinity;
+    }
+    
+    for (size_t i=1; i<=m; i++) {
+        size_t first = i > k ? i - k : 0;
+        size_t last = i + k < n ? i + k : n;
+        uint8_t minimum = infinity;
+        
+        if (first > 0) {
+            current[first - 1] = infinity;
+        }
+        if (first > last) {
+            return false;
+        }
+        
+        for (size_t j=first; j<=last; j++) {
+            uint8_t value;
+            
+            if (j == 0) {
+                value = i < infinity ? (uint8_t)i : infinity;
+            }
+            else {
+                value = KSOTokenFuzzyMinimum(previous[j - 1] + (p[i - 1] != characters[j - 1]), KSOTokenFuzzyMinimum(previous[j], current[j - 1]) + 1);
+                
+                if (i > 1 &&
+                    j > 1 &&
+                    p[i - 1] == characters[j - 2] &&
+                    p[i - 2] == characters[j - 1]) {
+                    
+                    value = KSOTokenFuzzyMinimum(value, previous2[j - 2] + 1);
+                }
+                
+                value = KSOTokenFuzzyMinimum(value, infinity);
+            }
+            
+            current[j] = value;
+            minimum = KSOTokenFuzzyMinimum(minimum, value);
+        }
+        
+        current[last + 1] = infinity;
+        
+        // distances never decrease from one row to the next
+        if (minimum > k) {
+            return false;
+        }
+        
+        uint8_t *temp = previous2;
+        
+        previous2 = previous;
+        previous = current;
+        current = temp;
+    }
+    
+    // the pattern may end anywhere in the band, prefer the smallest distance and then the prefix closest to the pattern length
+    size_t first = m > k ? m - k : 0;
+    size_t last = m + k < n ? m + k : n;
+    size_t best = SIZE_MAX;
+    
+    for (size_t j=first; j<=last; j++) {
+        if (previous[j] > k) {
+            continue;
+        }
+        if (best == SIZE_MAX ||
+            previous[j] < previous[best] ||
+            (previous[j] == previous[best] && (j > m ? j - m : m - j) < (best > m ? best - m : m - best))) {
+            
+            best = j;
+        }
+    }
+    
+    if (best == SIZE_MAX ||
+        best == 0) {
+        
+        return false;
+    }
+    
+    if (outPositions != NULL) {
+        for (size_t j=0; j<best; j++) {
+            outPositions[j] = (uint32_t)j;
+        }
+    }
+    
+    size_t extra = length - best;
+    
+    // score as a contiguous prefix match less a penalty per edit, so close typos outrank scattered subsequence matches
+    outResult->score = (int32_t)(28 * m + 4) - (int32_t)(24 * previous[best]) - (int32_t)((extra < 64 ? extra : 64) / 4);
+    outResult->distance = previous[best];
+    outResult->location = 0;
+    outResult->positionsCount = (uint32_t)best;
+    
+    return true;
+}
+
+bool KSOTokenFuzzyMatch(const KSOTokenFuzzyPattern *pattern, const uint16_t *characters, size_t length, uint64_t mask, uint32_t *outPositions, KSOTokenFuzzyMatchResult *outResult) {
+    if (pattern->length == 0) {
+        return false;
+    }
+    if ((pattern->mask & ~mask) == 0 &&
+        KSOTokenFuzzySubsequenceMatch(pattern, characters, length, outPositions, outResult)) {
+        
+        return true;
+    }
+    return KSOTokenFuzzyTypoMatch(pattern, characters, length, outPositions, outResult);
+}
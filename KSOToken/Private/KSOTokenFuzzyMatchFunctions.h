@@ -0,0 +1,82 @@
+//
+//  KSOTokenFuzzyMatchFunctions.h
+//  KSOToken
+//
+//  Created by William Towe on 10/17/26.
+//  Copyright © 2021 Kosoku Interactive, LLC. All rights reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+#ifndef KSOTokenFuzzyMatchFunctions_h
+#define KSOTokenFuzzyMatchFunctions_h
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ Fuzzy pattern prepared for matching against case folded characters.
+ */
+typedef struct {
+    const uint16_t *characters;
+    size_t length;
+    // bit per character class present in characters
+    uint64_t mask;
+    // the number of edits allowed when characters are not a subsequence
+    size_t maximumDistance;
+} KSOTokenFuzzyPattern;
+
+/**
+ Result of a successful fuzzy match.
+ */
+typedef struct {
+    // higher scores are better matches
+    int32_t score;
+    // 0 for subsequence matches, otherwise the number of edits
+    uint32_t distance;
+    // the first matching position
+    uint32_t location;
+    // the number of positions written to outPositions
+    uint32_t positionsCount;
+} KSOTokenFuzzyMatchResult;
+
+/**
+ Returns the character class mask of *length* case folded code units from *characters*. A pattern can only be a subsequence of characters whose mask contains the mask of the pattern.
+ */
+uint64_t KSOTokenFuzzyCharactersMask(const uint16_t *characters, size_t length);
+/**
+ Initializes *pattern* with *length* case folded code units from *characters*, which must outlive *pattern*. The *maximumDistance* is clamped to a third of *length*, so short patterns are not flooded with typo matches, and to at most 3.
+ */
+void KSOTokenFuzzyPatternInit(KSOTokenFuzzyPattern *pattern, const uint16_t *characters, size_t length, size_t maximumDistance);
+/**
+ Returns the number of positions *outPositions* must have room for when matching *pattern*.
+ */
+size_t KSOTokenFuzzyPatternPositionsCapacity(const KSOTokenFuzzyPattern *pattern);
+/**
+ Writes the indexes of the *count* entries of *masks* that can match *pattern* to *outIndexes*, which must have room for *count* indexes, and returns how many were written. The loop is branch free so it vectorizes.
+ */
+size_t KSOTokenFuzzyFilterMasks(const uint64_t *masks, size_t count, const KSOTokenFuzzyPattern *pattern, uint32_t *outIndexes);
+/**
+ Matches *pattern* against *length* case folded code units from *characters*, whose character class mask is *mask*. Subsequence matches are tried first, then matches against a prefix of *characters* within the maximum distance of *pattern*, counting insertions, deletions, substitutions and adjacent transpositions. Returns whether there is a match, the matching positions are written to *outPositions* if it is not NULL.
+ */
+bool KSOTokenFuzzyMatch(const KSOTokenFuzzyPattern *pattern, const uint16_t *characters, size_t length, uint64_t mask, uint32_t *outPositions, KSOTokenFuzzyMatchResult *outResult);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,38 @@
+//
+//  KSOTokenImageCacheKey.h
+//  KSOToken
+//
+//  Created by William Towe on 10/17/26.
+//  Copyright © 2021 Kosoku Interactive, LLC. All rights reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+#import <UIKit/UIKit.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+typedef NS_ENUM(NSInteger, KSOTokenImageCacheKeyState) {
+    KSOTokenImageCacheKeyStateNormal = 0,
+    KSOTokenImageCacheKeyStateHighlighted,
+    KSOTokenImageCacheKeyStateDisabled
+};
+
+// immutable key identifying everything that affects the rendered image of a KSOTokenDefaultTextAttachment, maxWidth is the width of the image after clamping
+@interface KSOTokenImageCacheKey : NSObject <NSCopying>
+
+- (instancetype)initWithText:(NSString *)text font:(UIFont *)font textColor:(UIColor *)textColor backgroundColor:(UIColor *)backgroundColor cornerRadius:(CGFloat)cornerRadius edgeInsets:(UIEdgeInsets)edgeInsets state:(KSOTokenImageCacheKeyState)state maxWidth:(CGFloat)maxWidth NS_DESIGNATED_INITIALIZER;
+- (instancetype)init NS_UNAVAILABLE;
+
+@end
+
+NS_ASSUME_NONNULL_END
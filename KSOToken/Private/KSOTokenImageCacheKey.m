@@ -0,0 +1,82 @@
+//
+//  KSOTokenImageCacheKey.m
+//  KSOToken
+//
+//  Created by William Towe on 10/17/26.
+//  Copyright © 2021 Kosoku Interactive, LLC. All rights reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+#import "KSOTokenImageCacheKey.h"
+
+@interface KSOTokenImageCacheKey ()
+@property (copy,nonatomic) NSString *text;
+@property (strong,nonatomic) UIFont *font;
+@property (strong,nonatomic) UIColor *textColor;
+@property (strong,nonatomic) UIColor *backgroundColor;
+@property (assign,nonatomic) CGFloat cornerRadius;
+@property (assign,nonatomic) UIEdgeInsets edgeInsets;
+@property (assign,nonatomic) KSOTokenImageCacheKeyState state;
+@property (assign,nonatomic) CGFloat maxWidth;
+@property (assign,nonatomic) NSUInteger hashValue;
+@end
+
+@implementation KSOTokenImageCacheKey
+
+- (BOOL)isEqual:(id)object {
+    if (self == object) {
+        return YES;
+    }
+    else if (![object isKindOfClass:KSOTokenImageCacheKey.class]) {
+        return NO;
+    }
+    
+    KSOTokenImageCacheKey *other = (KSOTokenImageCacheKey *)object;
+    
+    // compare the cheap values first, most keys differ by text
+    return (self.hashValue == other.hashValue &&
+            self.state == other.state &&
+            self.cornerRadius == other.cornerRadius &&
+            self.maxWidth == other.maxWidth &&
+            UIEdgeInsetsEqualToEdgeInsets(self.edgeInsets, other.edgeInsets) &&
+            [self.text isEqualToString:other.text] &&
+            [self.font isEqual:other.font] &&
+            [self.textColor isEqual:other.textColor] &&
+            [self.backgroundColor isEqual:other.backgroundColor]);
+}
+- (NSUInteger)hash {
+    return self.hashValue;
+}
+
+- (id)copyWithZone:(NSZone *)zone {
+    return self;
+}
+
+- (instancetype)initWithText:(NSString *)text font:(UIFont *)font textColor:(UIColor *)textColor backgroundColor:(UIColor *)backgroundColor cornerRadius:(CGFloat)cornerRadius edgeInsets:(UIEdgeInsets)edgeInsets state:(KSOTokenImageCacheKeyState)state maxWidth:(CGFloat)maxWidth {
+    if (!(self = [super init]))
+        return nil;
+    
+    _text = [text copy];
+    _font = font;
+    _textColor = textColor;
+    _backgroundColor = backgroundColor;
+    _cornerRadius = cornerRadius;
+    _edgeInsets = edgeInsets;
+    _state = state;
+    _maxWidth = maxWidth;
+    _hashValue = text.hash ^ (font.hash * 31) ^ ((NSUInteger)state << 7) ^ (NSUInteger)maxWidth;
+    
+    return self;
+}
+
+@end
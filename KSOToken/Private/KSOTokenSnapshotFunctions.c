@@ -0,0 +1,225 @@
+//
+//  KSOTokenSnapshotFunctions.c
+//  KSOToken
+//
+//  Created by William Towe on 10/17/26.
+//  Copyright © 2021 Kosoku Interactive, LLC. All rights reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+#include "KSOTokenSnapshotFunctions.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static const uint8_t kKSOTokenSnapshotMagic[4] = {'K', 'S', 'O', 'S'};
+
+bool KSOTokenSnapshotWriterInit(KSOTokenSnapshotWriter *writer, size_t capacity) {
+    writer->length = 0;
+    writer->capacity = capacity > 0 ? capacity : 64;
+    writer->bytes = malloc(writer->capacity);
+    
+    return writer->bytes != NULL;
+}
+void KSOTokenSnapshotWriterDestroy(KSOTokenSnapshotWriter *writer) {
+    free(writer->bytes);
+    
+    writer->bytes = NULL;
+    writer->length = 0;
+    writer->capacity = 0;
+}
+
+static bool KSOTokenSnapshotWriterReserve(KSOTokenSnapshotWriter *writer, size_t length) {
+    if (writer->capacity - writer->length >= length) {
+        return true;
+    }
+    
+    size_t capacity = writer->capacity;
+    
+    while (capacity - writer->length < length) {
+        capacity *= 2;
+    }
+    
+    uint8_t *bytes = realloc(writer->bytes, capacity);
+    
+    if (bytes == NULL) {
+        return false;
+    }
+    
+    writer->bytes = bytes;
+    writer->capacity = capacity;
+    
+    return true;
+}
+static bool KSOTokenSnapshotWriteBytes(KSOTokenSnapshotWriter *writer, const void *bytes, size_t length) {
+    if (!KSOTokenSnapshotWriterReserve(writer, length)) {
+        return false;
+    }
+    
+    if (length > 0) {
+        memcpy(writer->bytes + writer->length, bytes, length);
+    }
+    
+    writer->length += length;
+    
+    return true;
+}
+static bool KSOTokenSnapshotWriteVarint(KSOTokenSnapshotWriter *writer, uint64_t value) {
+    uint8_t bytes[10];
+    size_t length = 0;
+    
+    // seven bits per byte, the high bit is set on every byte but the last
+    do {
+        uint8_t byte = value & 0x7F;
+        
+        value >>= 7;
+        bytes[length++] = value != 0 ? byte | 0x80 : byte;
+    } while (value != 0);
+    
+    return KSOTokenSnapshotWriteBytes(writer, bytes, length);
+}
+static bool KSOTokenSnapshotWriteFloat(KSOTokenSnapshotWriter *writer, float value) {
+    uint32_t bits;
+    
+    memcpy(&bits, &value, sizeof(bits));
+    
+    uint8_t bytes[4] = {bits & 0xFF, (bits >> 8) & 0xFF, (bits >> 16) & 0xFF, bits >> 24};
+    
+    return KSOTokenSnapshotWriteBytes(writer, bytes, sizeof(bytes));
+}
+static bool KSOTokenSnapshotWriteData(KSOTokenSnapshotWriter *writer, const uint8_t *bytes, size_t length) {
+    return KSOTokenSnapshotWriteVarint(writer, length) && KSOTokenSnapshotWriteBytes(writer, bytes, length);
+}
+
+bool KSOTokenSnapshotWriteHeader(KSOTokenSnapshotWriter *writer, const KSOTokenSnapshotHeader *header) {
+    uint8_t version = KSOTokenSnapshotVersion;
+    
+    return (KSOTokenSnapshotWriteBytes(writer, kKSOTokenSnapshotMagic, sizeof(kKSOTokenSnapshotMagic)) &&
+            KSOTokenSnapshotWriteBytes(writer, &version, 1) &&
+            KSOTokenSnapshotWriteData(writer, header->fontName, header->fontNameLength) &&
+            KSOTokenSnapshotWriteFloat(writer, header->fontSize) &&
+            KSOTokenSnapshotWriteVarint(writer, header->count));
+}
+bool KSOTokenSnapshotWriteRecord(KSOTokenSnapshotWriter *writer, const KSOTokenSnapshotRecord *record) {
+    uint8_t kind = (uint8_t)record->kind;
+    
+    return (KSOTokenSnapshotWriteBytes(writer, &kind, 1) &&
+            KSOTokenSnapshotWriteData(writer, record->text, record->textLength) &&
+            KSOTokenSnapshotWriteFloat(writer, record->width) &&
+            KSOTokenSnapshotWriteFloat(writer, record->height) &&
+            KSOTokenSnapshotWriteData(writer, record->payload, record->payloadLength));
+}
+
+void KSOTokenSnapshotReaderInit(KSOTokenSnapshotReader *reader, const uint8_t *bytes, size_t length) {
+    reader->bytes = bytes;
+    reader->length = length;
+    reader->offset = 0;
+}
+
+static bool KSOTokenSnapshotReadBytes(KSOTokenSnapshotReader *reader, size_t length, const uint8_t **outBytes) {
+    if (reader->length - reader->offset < length) {
+        return false;
+    }
+    
+    *outBytes = reader->bytes + reader->offset;
+    reader->offset += length;
+    
+    return true;
+}
+static bool KSOTokenSnapshotReadVarint(KSOTokenSnapshotReader *reader, uint64_t *outValue) {
+    uint64_t value = 0;
+    
+    for (unsigned shift=0; shift<64; shift+=7) {
+        if (reader->offset >= reader->length) {
+            return false;
+        }
+        
+        uint8_t byte = reader->bytes[reader->offset++];
+        
+        value |= (uint64_t)(byte & 0x7F) << shift;
+        
+        if ((byte & 0x80) == 0) {
+            *outValue = value;
+            return true;
+        }
+    }
+    return false;
+}
+static bool KSOTokenSnapshotReadFloat(KSOTokenSnapshotReader *reader, float *outValue) {
+    const uint8_t *bytes;
+    
+    if (!KSOTokenSnapshotReadBytes(reader, 4, &bytes)) {
+        return false;
+    }
+    
+    uint32_t bits = (uint32_t)bytes[0] | ((uint32_t)bytes[1] << 8) | ((uint32_t)bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+    
+    memcpy(outValue, &bits, sizeof(bits));
+    
+    return true;
+}
+static bool KSOTokenSnapshotReadData(KSOTokenSnapshotReader *reader, const uint8_t **outBytes, size_t *outLength) {
+    uint64_t length;
+    
+    if (!KSOTokenSnapshotReadVarint(reader, &length) ||
+        length > reader->length - reader->offset) {
+        
+        return false;
+    }
+    
+    *outLength = (size_t)length;
+    
+    return KSOTokenSnapshotReadBytes(reader, (size_t)length, outBytes);
+}
+
+bool KSOTokenSnapshotReadHeader(KSOTokenSnapshotReader *reader, KSOTokenSnapshotHeader *outHeader) {
+    const uint8_t *magic;
+    const uint8_t *version;
+    uint64_t count;
+    
+    if (!KSOTokenSnapshotReadBytes(reader, sizeof(kKSOTokenSnapshotMagic), &magic) ||
+        memcmp(magic, kKSOTokenSnapshotMagic, sizeof(kKSOTokenSnapshotMagic)) != 0 ||
+        !KSOTokenSnapshotReadBytes(reader, 1, &version) ||
+        *version != KSOTokenSnapshotVersion ||
+        !KSOTokenSnapshotReadData(reader, &outHeader->fontName, &outHeader->fontNameLength) ||
+        !KSOTokenSnapshotReadFloat(reader, &outHeader->fontSize) ||
+        !KSOTokenSnapshotReadVarint(reader, &count)) {
+        
+        return false;
+    }
+    
+    // every record takes at least 11 bytes, a larger count can only come from a corrupt snapshot and must not be used to size allocations
+    if (count > (reader->length - reader->offset) / 11) {
+        return false;
+    }
+    
+    outHeader->count = (size_t)count;
+    
+    return true;
+}
+bool KSOTokenSnapshotReadRecord(KSOTokenSnapshotReader *reader, KSOTokenSnapshotRecord *outRecord) {
+    const uint8_t *kind;
+    
+    if (!KSOTokenSnapshotReadBytes(reader, 1, &kind) ||
+        *kind > KSOTokenSnapshotRecordKindData) {
+        
+        return false;
+    }
+    
+    outRecord->kind = (KSOTokenSnapshotRecordKind)*kind;
+    
+    return (KSOTokenSnapshotReadData(reader, &outRecord->text, &outRecord->textLength) &&
+            KSOTokenSnapshotReadFloat(reader, &outRecord->width) &&
+            KSOTokenSnapshotReadFloat(reader, &outRecord->height) &&
+            KSOTokenSnapshotReadData(reader, &outRecord->payload, &outRecord->payloadLength));
+}
@@ -0,0 +1,131 @@
+//
+//  KSOTokenSnapshotFunctions.h
+//  KSOToken
+//
+//  Created by William Towe on 10/17/26.
+//  Copyright © 2021 Kosoku Interactive, LLC. All rights reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+#ifndef KSOTokenSnapshotFunctions_h
+#define KSOTokenSnapshotFunctions_h
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ Snapshots are little endian regardless of the host:
+ 
+ magic "KSOS", version byte
+ font name (varint length, UTF-8), font point size (float32), record count (varint)
+ each record: kind byte, text (varint length, UTF-8), width and height (float32), payload (varint length, bytes)
+ */
+
+/**
+ The version written by KSOTokenSnapshotWriteHeader, snapshots with any other version are rejected.
+ */
+#define KSOTokenSnapshotVersion ((uint8_t)1)
+
+/**
+ Enum describing how the represented object of a record is restored.
+ */
+typedef enum {
+    // the text is the represented object
+    KSOTokenSnapshotRecordKindString = 0,
+    // the payload is the UTF-8 absolute string of a URL
+    KSOTokenSnapshotRecordKindURL = 1,
+    // the payload was provided by the delegate
+    KSOTokenSnapshotRecordKindData = 2
+} KSOTokenSnapshotRecordKind;
+
+/**
+ Header of a snapshot, the font is what the sizes of the records were measured with.
+ */
+typedef struct {
+    const uint8_t *fontName;
+    size_t fontNameLength;
+    float fontSize;
+    size_t count;
+} KSOTokenSnapshotHeader;
+
+/**
+ A single token of a snapshot. When read, text and payload point into the buffer of the reader. A size of 0 means the token was not measured.
+ */
+typedef struct {
+    KSOTokenSnapshotRecordKind kind;
+    const uint8_t *text;
+    size_t textLength;
+    float width;
+    float height;
+    const uint8_t *payload;
+    size_t payloadLength;
+} KSOTokenSnapshotRecord;
+
+/**
+ Growable buffer that snapshots are written to.
+ */
+typedef struct {
+    uint8_t *bytes;
+    size_t length;
+    size_t capacity;
+} KSOTokenSnapshotWriter;
+
+/**
+ Initializes *writer* with room for *capacity* bytes. Returns false if the buffer could not be allocated.
+ */
+bool KSOTokenSnapshotWriterInit(KSOTokenSnapshotWriter *writer, size_t capacity);
+/**
+ Frees the buffer of *writer*.
+ */
+void KSOTokenSnapshotWriterDestroy(KSOTokenSnapshotWriter *writer);
+/**
+ Appends *header* to *writer*, this must be written first. Returns false if the buffer could not grow.
+ */
+bool KSOTokenSnapshotWriteHeader(KSOTokenSnapshotWriter *writer, const KSOTokenSnapshotHeader *header);
+/**
+ Appends *record* to *writer*, exactly header.count records must follow the header. Returns false if the buffer could not grow.
+ */
+bool KSOTokenSnapshotWriteRecord(KSOTokenSnapshotWriter *writer, const KSOTokenSnapshotRecord *record);
+
+/**
+ Cursor over the bytes of a snapshot, nothing is copied or allocated while reading.
+ */
+typedef struct {
+    const uint8_t *bytes;
+    size_t length;
+    size_t offset;
+} KSOTokenSnapshotReader;
+
+/**
+ Initializes *reader* to read *length* bytes from *bytes*, which must outlive it.
+ */
+void KSOTokenSnapshotReaderInit(KSOTokenSnapshotReader *reader, const uint8_t *bytes, size_t length);
+/**
+ Reads the header into *outHeader*. Returns false if the magic, version or any length is invalid.
+ */
+bool KSOTokenSnapshotReadHeader(KSOTokenSnapshotReader *reader, KSOTokenSnapshotHeader *outHeader);
+/**
+ Reads the next record into *outRecord*. Returns false if the record is truncated or its kind is unknown.
+ */
+bool KSOTokenSnapshotReadRecord(KSOTokenSnapshotReader *reader, KSOTokenSnapshotRecord *outRecord);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,48 @@
+//
+//  KSOTokenTextView+Private.h
+//  KSOToken
+//
+//  Created by William Towe on 10/17/26.
+//  Copyright © 2021 Kosoku Interactive, LLC. All rights reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+#import "KSOTokenTextView.h"
+
+#import <QuartzCore/QuartzCore.h>
+#import <os/signpost.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+// a stage that is being measured, startTime is 0.0 when the text view has no metrics sink
+typedef struct {
+    CFTimeInterval startTime;
+    os_signpost_id_t signpostID;
+} KSOTokenMetricsInterval;
+
+@interface KSOTokenTextView ()
+
+// used by KSOTokenDefaultTextAttachment to have the text view lay out and redraw its tokens after their appearance changes
+- (void)_setNeedsLayoutTokenTextAttachments;
+
+// used by KSOTokenDefaultTextAttachment and KSOTokenCompletionOperation to report metrics, these return right away when there is no metrics sink
+- (KSOTokenMetricsInterval)_beginMetricsStage:(KSOTokenMetricsStage)stage;
+- (void)_endMetricsStage:(KSOTokenMetricsStage)stage interval:(KSOTokenMetricsInterval)interval;
+- (void)_incrementMetricsCounter:(KSOTokenMetricsCounter)counter;
+
+// used by KSOTokenCompletionOperation on the main thread to report how long a query was outstanding, cancelled is YES if it was superseded before its results were displayed
+- (void)_recordCompletionLatency:(NSTimeInterval)latency cancelled:(BOOL)cancelled;
+
+@end
+
+NS_ASSUME_NONNULL_END
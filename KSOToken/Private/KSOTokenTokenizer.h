@@ -0,0 +1,41 @@
+//
+//  KSOTokenTokenizer.h
+//  KSOToken
+//
+//  Created by William Towe on 10/17/26.
+//  Copyright © 2021 Kosoku Interactive, LLC. All rights reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+// finds the range of untokenized text around a location, the delimiter set is compiled once and scanning only visits the run of text being edited
+@interface KSOTokenTokenizer : NSObject
+
+@property (copy,nonatomic) NSCharacterSet *delimiterCharacterSet;
+
+- (instancetype)initWithDelimiterCharacterSet:(NSCharacterSet *)delimiterCharacterSet NS_DESIGNATED_INITIALIZER;
+- (instancetype)init NS_UNAVAILABLE;
+
+// returns the range of the run of token characters containing location, or {location, 0} if the character before location is not part of one
+- (NSRange)tokenRangeInString:(NSString *)string location:(NSUInteger)location;
+// must be called whenever the string passed to tokenRangeInString:location: changes
+- (void)invalidate;
+
+- (NSArray<NSString *> *)tokenTextsInString:(NSString *)string;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,188 @@
+//
+//  KSOTokenTokenizer.m
+//  KSOToken
+//
+//  Created by William Towe on 10/17/26.
+//  Copyright © 2021 Kosoku Interactive, LLC. All rights reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+#import "KSOTokenTokenizer.h"
+#import "KSOTokenTokenizerFunctions.h"
+
+@interface KSOTokenTokenizer () {
+    KSOTokenDelimiterSet _delimiterSet;
+}
+// the result of the last call to tokenRangeInString:location:, valid until the next call to invalidate
+@property (assign,nonatomic) BOOL hasCachedTokenRange;
+@property (assign,nonatomic) NSUInteger cachedLocation;
+@property (assign,nonatomic) NSRange cachedTokenRange;
+
+- (void)_compileDelimiterCharacterSet;
+
++ (NSUInteger)_initialWindowLength;
++ (const KSOTokenDelimiterSet *)_whitespaceSet;
+@end
+
+@implementation KSOTokenTokenizer
+
+- (instancetype)initWithDelimiterCharacterSet:(NSCharacterSet *)delimiterCharacterSet {
+    if (!(self = [super init]))
+        return nil;
+    
+    _delimiterCharacterSet = [delimiterCharacterSet copy];
+    
+    [self _compileDelimiterCharacterSet];
+    
+    return self;
+}
+
+- (NSRange)tokenRangeInString:(NSString *)string location:(NSUInteger)location {
+    NSUInteger length = string.length;
+    
+    location = MIN(location, length);
+    
+    if (self.hasCachedTokenRange &&
+        self.cachedLocation == location) {
+        
+        return self.cachedTokenRange;
+    }
+    
+    // copy a window of characters around location, doubling it until the run of token characters no longer touches one of its edges
+    NSUInteger windowLength = [self.class _initialWindowLength];
+    unichar stackBuffer[2 * 64];
+    unichar *buffer = stackBuffer;
+    NSRange retval;
+    
+    for (;;) {
+        NSUInteger windowStart = location > windowLength ? location - windowLength : 0;
+        NSUInteger windowEnd = MIN(length, location + windowLength);
+        NSRange window = NSMakeRange(windowStart, windowEnd - windowStart);
+        
+        if (window.length > sizeof(stackBuffer) / sizeof(unichar)) {
+            unichar *temp = buffer == stackBuffer ? malloc(sizeof(unichar) * window.length) : realloc(buffer, sizeof(unichar) * window.length);
+            
+            if (temp == NULL) {
+                retval = NSMakeRange(location, 0);
+                break;
+            }
+            
+            buffer = temp;
+        }
+        
+        [string getCharacters:buffer range:window];
+        
+        size_t start = KSOTokenScanBackward(buffer, location - windowStart, &_delimiterSet);
+        
+        if (start == 0 &&
+            windowStart > 0) {
+            
+            windowLength *= 2;
+            continue;
+        }
+        
+        // no token characters before location, there is nothing to tokenize
+        if (start == location - windowStart) {
+            retval = NSMakeRange(location, 0);
+            break;
+        }
+        
+        size_t end = KSOTokenScanForward(buffer, window.length, location - windowStart, &_delimiterSet);
+        
+        if (end == window.length &&
+            windowEnd < length) {
+            
+            windowLength *= 2;
+            continue;
+        }
+        
+        retval = NSMakeRange(windowStart + start, end - start);
+        break;
+    }
+    
+    if (buffer != stackBuffer) {
+        free(buffer);
+    }
+    
+    [self setHasCachedTokenRange:YES];
+    [self setCachedLocation:location];
+    [self setCachedTokenRange:retval];
+    
+    return retval;
+}
+- (void)invalidate {
+    [self setHasCachedTokenRange:NO];
+}
+
+- (NSArray<NSString *> *)tokenTextsInString:(NSString *)string {
+    NSUInteger length = string.length;
+    
+    if (length == 0) {
+        return @[];
+    }
+    
+    unichar *buffer = malloc(sizeof(unichar) * length);
+    size_t capacity = length / 2 + 1;
+    KSOTokenTextRange *ranges = malloc(sizeof(KSOTokenTextRange) * capacity);
+    
+    if (buffer == NULL ||
+        ranges == NULL) {
+        
+        free(buffer);
+        free(ranges);
+        return @[];
+    }
+    
+    [string getCharacters:buffer range:NSMakeRange(0, length)];
+    
+    size_t count = KSOTokenSplitTokenTexts(buffer, length, &_delimiterSet, [self.class _whitespaceSet], ranges, capacity);
+    NSMutableArray *retval = [[NSMutableArray alloc] initWithCapacity:count];
+    
+    for (size_t i=0; i<count; i++) {
+        [retval addObject:[[NSString alloc] initWithCharacters:buffer + ranges[i].location length:ranges[i].length]];
+    }
+    
+    free(buffer);
+    free(ranges);
+    
+    return retval;
+}
+
+- (void)setDelimiterCharacterSet:(NSCharacterSet *)delimiterCharacterSet {
+    _delimiterCharacterSet = [delimiterCharacterSet copy];
+    
+    [self _compileDelimiterCharacterSet];
+    [self invalidate];
+}
+
+- (void)_compileDelimiterCharacterSet; {
+    NSData *bitmap = self.delimiterCharacterSet.bitmapRepresentation;
+    
+    KSOTokenDelimiterSetInit(&_delimiterSet, bitmap.bytes, bitmap.length);
+}
+
++ (NSUInteger)_initialWindowLength; {
+    return 64;
+}
++ (const KSOTokenDelimiterSet *)_whitespaceSet; {
+    static KSOTokenDelimiterSet kRetval;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        NSData *bitmap = NSCharacterSet.whitespaceAndNewlineCharacterSet.bitmapRepresentation;
+        
+        KSOTokenDelimiterSetInit(&kRetval, bitmap.bytes, bitmap.length);
+    });
+    return &kRetval;
+}
+
+@end
@@ -0,0 +1,81 @@
+//
+//  KSOTokenTokenizerFunctions.c
+//  KSOToken
+//
+//  Created by William Towe on 10/17/26.
+//  Copyright © 2021 Kosoku Interactive, LLC. All rights reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+#include "KSOTokenTokenizerFunctions.h"
+
+#include <string.h>
+
+void KSOTokenDelimiterSetInit(KSOTokenDelimiterSet *set, const uint8_t *bitmap, size_t bitmapLength) {
+    size_t length = bitmapLength < sizeof(set->bits) ? bitmapLength : sizeof(set->bits);
+    
+    memset(set->bits, 0, sizeof(set->bits));
+    
+    if (bitmap != NULL) {
+        memcpy(set->bits, bitmap, length);
+    }
+}
+
+size_t KSOTokenScanBackward(const uint16_t *characters, size_t location, const KSOTokenDelimiterSet *set) {
+    while (location > 0 &&
+           KSOTokenIsTokenCharacter(set, characters[location - 1])) {
+        
+        location--;
+    }
+    return location;
+}
+size_t KSOTokenScanForward(const uint16_t *characters, size_t length, size_t location, const KSOTokenDelimiterSet *set) {
+    while (location < length &&
+           KSOTokenIsTokenCharacter(set, characters[location])) {
+        
+        location++;
+    }
+    return location;
+}
+
+size_t KSOTokenSplitTokenTexts(const uint16_t *characters, size_t length, const KSOTokenDelimiterSet *delimiters, const KSOTokenDelimiterSet *whitespace, KSOTokenTextRange *ranges, size_t capacity) {
+    size_t retval = 0;
+    // start of the current piece after leading whitespace, SIZE_MAX while only whitespace has been seen
+    size_t start = SIZE_MAX;
+    // end of the current piece after the last non whitespace code unit
+    size_t end = 0;
+    
+    for (size_t i=0; i<=length; i++) {
+        if (i == length ||
+            KSOTokenDelimiterSetContains(delimiters, characters[i])) {
+            
+            if (start != SIZE_MAX) {
+                if (retval < capacity) {
+                    ranges[retval].location = start;
+                    ranges[retval].length = end - start;
+                }
+                retval++;
+            }
+            
+            start = SIZE_MAX;
+        }
+        else if (!KSOTokenDelimiterSetContains(whitespace, characters[i])) {
+            if (start == SIZE_MAX) {
+                start = i;
+            }
+            end = i + 1;
+        }
+    }
+    
+    return retval;
+}
@@ -0,0 +1,90 @@
+//
+//  KSOTokenTokenizerFunctions.h
+//  KSOToken
+//
+//  Created by William Towe on 10/17/26.
+//  Copyright © 2021 Kosoku Interactive, LLC. All rights reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+#ifndef KSOTokenTokenizerFunctions_h
+#define KSOTokenTokenizerFunctions_h
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ The object replacement character, which is the character of every token text attachment.
+ */
+#define KSOTokenAttachmentCharacter ((uint16_t)0xFFFC)
+
+/**
+ Compiled set of delimiting UTF-16 code units, one bit per code unit of the basic multilingual plane. This matches the layout of the first plane of -[NSCharacterSet bitmapRepresentation]. Delimiters outside of the basic multilingual plane are not supported.
+ */
+typedef struct {
+    uint8_t bits[8192];
+} KSOTokenDelimiterSet;
+
+/**
+ Initializes *set* from *bitmap*, only the first 8192 bytes are used and missing bytes are treated as 0.
+ */
+void KSOTokenDelimiterSetInit(KSOTokenDelimiterSet *set, const uint8_t *bitmap, size_t bitmapLength);
+/**
+ Returns whether *set* contains *character*.
+ */
+static inline bool KSOTokenDelimiterSetContains(const KSOTokenDelimiterSet *set, uint16_t character) {
+    return (set->bits[character >> 3] & (1 << (character & 7))) != 0;
+}
+/**
+ Returns whether *character* can be part of the text of a token, meaning it is neither a delimiter nor a token text attachment.
+ */
+static inline bool KSOTokenIsTokenCharacter(const KSOTokenDelimiterSet *set, uint16_t character) {
+    return character != KSOTokenAttachmentCharacter && !KSOTokenDelimiterSetContains(set, character);
+}
+
+/**
+ Returns the start of the run of token characters that ends at *location*, which is *location* if the character before it is not a token character.
+ */
+size_t KSOTokenScanBackward(const uint16_t *characters, size_t location, const KSOTokenDelimiterSet *set);
+/**
+ Returns the end of the run of token characters that starts at *location*, which is *location* if the character at it is not a token character.
+ */
+size_t KSOTokenScanForward(const uint16_t *characters, size_t length, size_t location, const KSOTokenDelimiterSet *set);
+
+/**
+ Range of the text of a single token within a buffer of UTF-16 code units.
+ */
+typedef struct {
+    size_t location;
+    size_t length;
+} KSOTokenTextRange;
+
+/**
+ Splits *characters* on the code units in *delimiters* and trims the code units in *whitespace* from both ends of each piece in a single pass. Pieces that are empty after trimming are skipped. Up to *capacity* ranges are written to *ranges*, which may be NULL if *capacity* is 0.
+ 
+ A buffer of length / 2 + 1 ranges is always large enough.
+ 
+ @return The total number of ranges, which is larger than *capacity* if *ranges* was too small
+ */
+size_t KSOTokenSplitTokenTexts(const uint16_t *characters, size_t length, const KSOTokenDelimiterSet *delimiters, const KSOTokenDelimiterSet *whitespace, KSOTokenTextRange *ranges, size_t capacity);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
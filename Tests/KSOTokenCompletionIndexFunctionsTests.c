@@ -0,0 +1,99 @@
+//
+//  KSOTokenCompletionIndexFunctionsTests.c
+//  KSOToken
+//
+//  Created by William Towe on 10/17/26.
+//  Copyright © 2021 Kosoku Interactive, LLC. All rights reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+
+#include "KSOTokenCompletionIndexFunctions.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+static int KSOTokenTestFailures;
+
+#define KSOTokenTestAssert(condition) do { \
+    if (!(condition)) { \
+        fprintf(stderr, "%s:%d: %s\n", __FILE__, __LINE__, #condition); \
+        KSOTokenTestFailures++; \
+    } \
+} while (0)
+
+// the entries "abc" and "ab", each terminated by 0 like the characters of a completion index
+static const uint16_t kCharacters[] = {'a', 'b', 'c', 0, 'a', 'b', 0};
+static const size_t kCharactersLength = sizeof(kCharacters) / sizeof(kCharacters[0]);
+
+static size_t KSOTokenTestSuffixArrayFindCount(const uint32_t *suffixes, size_t count, const uint16_t *pattern, size_t patternLength) {
+    size_t retval;
+    
+    KSOTokenSuffixArrayFind(kCharacters, kCharactersLength, suffixes, count, pattern, patternLength, &retval);
+    
+    return retval;
+}
+
+static void KSOTokenTestSuffixArrayFind(void) {
+    size_t count;
+    uint32_t *suffixes = KSOTokenSuffixArrayCreate(kCharacters, kCharactersLength, &count);
+    
+    KSOTokenTestAssert(suffixes != NULL);
+    KSOTokenTestAssert(count == 5);
+    
+    const uint16_t ab[] = {'a', 'b'};
+    const uint16_t b[] = {'b'};
+    const uint16_t abc[] = {'a', 'b', 'c'};
+    const uint16_t abca[] = {'a', 'b', 'c', 'a'};
+    
+    KSOTokenTestAssert(KSOTokenTestSuffixArrayFindCount(suffixes, count, ab, 2) == 2);
+    KSOTokenTestAssert(KSOTokenTestSuffixArrayFindCount(suffixes, count, b, 1) == 2);
+    KSOTokenTestAssert(KSOTokenTestSuffixArrayFindCount(suffixes, count, abc, 3) == 1);
+    KSOTokenTestAssert(KSOTokenTestSuffixArrayFindCount(suffixes, count, abca, 4) == 0);
+    
+    free(suffixes);
+}
+
+// a query with an embedded 0 must not match across the terminator of an entry, or read past the end of the characters after the last one
+static void KSOTokenTestSuffixArrayFindEmbeddedTerminator(void) {
+    size_t count;
+    uint32_t *suffixes = KSOTokenSuffixArrayCreate(kCharacters, kCharactersLength, &count);
+    
+    KSOTokenTestAssert(suffixes != NULL);
+    
+    const uint16_t acrossEntries[] = {'c', 0, 'a', 'b'};
+    const uint16_t lastTerminator[] = {'b', 0};
+    const uint16_t pastLastTerminator[] = {'b', 0, 'a'};
+    const uint16_t terminator[] = {0};
+    
+    KSOTokenTestAssert(KSOTokenTestSuffixArrayFindCount(suffixes, count, acrossEntries, 4) == 0);
+    KSOTokenTestAssert(KSOTokenTestSuffixArrayFindCount(suffixes, count, lastTerminator, 2) == 0);
+    KSOTokenTestAssert(KSOTokenTestSuffixArrayFindCount(suffixes, count, pastLastTerminator, 3) == 0);
+    KSOTokenTestAssert(KSOTokenTestSuffixArrayFindCount(suffixes, count, terminator, 1) == 0);
+    
+    free(suffixes);
+}
+
+int main(void) {
+    KSOTokenTestSuffixArrayFind();
+    KSOTokenTestSuffixArrayFindEmbeddedTerminator();
+    
+    if (KSOTokenTestFailures > 0) {
+        fprintf(stderr, "%d failures\n", KSOTokenTestFailures);
+        return 1;
+    }
+    
+    printf("KSOTokenCompletionIndexFunctionsTests passed\n");
+    
+    return 0;
+}
@@ -0,0 +1,271 @@
+//
+//  KSOTokenCorpusBuilder.c
+//  KSOToken
+//
+//  Created by William Towe on 10/17/26.
+//  Copyright © 2021 Kosoku Interactive, LLC. All rights reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+// Builds a corpus file for -[KSOTokenCompletionIndex initWithContentsOfCorpusURL:] from a UTF-8 text file with one string per line. The file is written in the byte order of the host, build it on a little endian machine for iOS. See the Makefile in this directory.
+
+#include "KSOTokenCorpusFunctions.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// decodes the UTF-8 in bytes to UTF-16 in outCharacters, which must have room for length code units, invalid sequences become U+FFFD
+static size_t KSOTokenCorpusBuilderDecode(const unsigned char *bytes, size_t length, uint16_t *outCharacters) {
+    size_t retval = 0;
+    
+    for (size_t i=0; i<length;) {
+        uint32_t scalar = bytes[i];
+        size_t count = scalar < 0x80 ? 0 : scalar >= 0xC2 && scalar < 0xE0 ? 1 : scalar >= 0xE0 && scalar < 0xF0 ? 2 : scalar >= 0xF0 && scalar < 0xF5 ? 3 : SIZE_MAX;
+        
+        if (count == SIZE_MAX ||
+            i + count >= length) {
+            
+            outCharacters[retval++] = 0xFFFD;
+            i++;
+            continue;
+        }
+        
+        scalar &= count == 0 ? 0x7F : 0x3F >> count;
+        
+        size_t j = 1;
+        
+        for (; j<=count && (bytes[i + j] & 0xC0) == 0x80; j++) {
+            scalar = (scalar << 6) | (bytes[i + j] & 0x3F);
+        }
+        
+        // truncated, overlong, surrogate or out of range sequences
+        if (j <= count ||
+            (count == 2 && scalar < 0x800) ||
+            (count == 3 && (scalar < 0x10000 || scalar > 0x10FFFF)) ||
+            (scalar >= 0xD800 && scalar < 0xE000)) {
+            
+            outCharacters[retval++] = 0xFFFD;
+            i += j;
+            continue;
+        }
+        
+        if (scalar >= 0x10000) {
+            scalar -= 0x10000;
+            outCharacters[retval++] = (uint16_t)(0xD800 + (scalar >> 10));
+            outCharacters[retval++] = (uint16_t)(0xDC00 + (scalar & 0x3FF));
+        }
+        // embedded terminators would split the string in two, like KSOTokenCompletionIndex replace them
+        else {
+            outCharacters[retval++] = scalar == 0 ? ' ' : (uint16_t)scalar;
+        }
+        
+        i += count + 1;
+    }
+    
+    return retval;
+}
+
+static void KSOTokenCorpusBuilderUsage(const char *program) {
+    fprintf(stderr, "usage: %s [--weighted] input.txt output.corpus\n", program);
+    fprintf(stderr, "  --weighted  each line ends with a tab and the weight of the string, for example its frequency\n");
+}
+
+int main(int argc, char *argv[]) {
+    const char *inputPath = NULL;
+    const char *outputPath = NULL;
+    int weighted = 0;
+    
+    for (int i=1; i<argc; i++) {
+        if (strcmp(argv[i], "--weighted") == 0) {
+            weighted = 1;
+        }
+        else if (inputPath == NULL) {
+            inputPath = argv[i];
+        }
+        else if (outputPath == NULL) {
+            outputPath = argv[i];
+        }
+        else {
+            KSOTokenCorpusBuilderUsage(argv[0]);
+            return 1;
+        }
+    }
+    
+    if (inputPath == NULL ||
+        outputPath == NULL) {
+        
+        KSOTokenCorpusBuilderUsage(argv[0]);
+        return 1;
+    }
+    
+    FILE *file = fopen(inputPath, "rb");
+    
+    if (file == NULL) {
+        fprintf(stderr, "unable to read %s\n", inputPath);
+        return 1;
+    }
+    
+    fseek(file, 0, SEEK_END);
+    
+    long size = ftell(file);
+    
+    fseek(file, 0, SEEK_SET);
+    
+    unsigned char *bytes = malloc(size > 0 ? (size_t)size : 1);
+    
+    if (size < 0 ||
+        bytes == NULL ||
+        fread(bytes, 1, (size_t)size, file) != (size_t)size) {
+        
+        fprintf(stderr, "unable to read %s\n", inputPath);
+        free(bytes);
+        fclose(file);
+        return 1;
+    }
+    
+    fclose(file);
+    
+    size_t lines = 1;
+    
+    for (long i=0; i<size; i++) {
+        if (bytes[i] == '\n') {
+            lines++;
+        }
+    }
+    
+    // UTF-8 never takes fewer bytes than UTF-16 takes code units, so the input length plus one terminator per line is enough
+    uint16_t *characters = malloc(sizeof(uint16_t) * ((size_t)size + lines));
+    uint32_t *offsets = malloc(sizeof(uint32_t) * (lines + 1));
+    float *weights = weighted ? malloc(sizeof(float) * lines) : NULL;
+    
+    if (characters == NULL ||
+        offsets == NULL ||
+        (weighted && weights == NULL) ||
+        (size_t)size + lines > UINT32_MAX) {
+        
+        fprintf(stderr, "%s is too large\n", inputPath);
+        free(bytes);
+        free(characters);
+        free(offsets);
+        free(weights);
+        return 1;
+    }
+    
+    KSOTokenCorpus corpus = {.characters = characters, .offsets = offsets, .weights = weights};
+    size_t length = 0;
+    size_t count = 0;
+    size_t line = 0;
+    size_t start = 0;
+    
+    for (size_t i=0; i<=(size_t)size; i++) {
+        if (i < (size_t)size &&
+            bytes[i] != '\n') {
+            
+            continue;
+        }
+        
+        size_t end = i;
+        
+        line++;
+        
+        if (end > start &&
+            bytes[end - 1] == '\r') {
+            
+            end--;
+        }
+        
+        if (weighted) {
+            size_t tab = end;
+            
+            while (tab > start && bytes[tab - 1] != '\t') {
+                tab--;
+            }
+            
+            if (tab == start) {
+                if (end > start) {
+                    fprintf(stderr, "line %zu of %s has no weight\n", line, inputPath);
+                }
+                
+                weights[count] = 0.0f;
+            }
+            else {
+                char weight[64];
+                size_t weightLength = end - tab < sizeof(weight) - 1 ? end - tab : sizeof(weight) - 1;
+                
+                memcpy(weight, bytes + tab, weightLength);
+                weight[weightLength] = 0;
+                weights[count] = strtof(weight, NULL);
+                end = tab - 1;
+            }
+        }
+        
+        // empty lines, including the one after the final newline, are not strings
+        if (end > start) {
+            offsets[count++] = (uint32_t)length;
+            length += KSOTokenCorpusBuilderDecode(bytes + start, end - start, characters + length);
+            characters[length++] = 0;
+        }
+        
+        start = i + 1;
+    }
+    
+    offsets[count] = (uint32_t)length;
+    corpus.charactersLength = length;
+    corpus.count = count;
+    
+    free(bytes);
+    
+    if (!KSOTokenCorpusCreateSections(&corpus)) {
+        fprintf(stderr, "unable to index %s\n", inputPath);
+        free(characters);
+        free(offsets);
+        free(weights);
+        return 1;
+    }
+    
+    size_t outputLength = KSOTokenCorpusWriteLength(&corpus);
+    uint8_t *output = outputLength > 0 ? malloc(outputLength) : NULL;
+    int retval = 1;
+    
+    if (output == NULL) {
+        fprintf(stderr, "%s is too large\n", inputPath);
+    }
+    else {
+        KSOTokenCorpusWrite(&corpus, output);
+        
+        file = fopen(outputPath, "wb");
+        
+        // close the file even if writing fails, closing flushes it and can fail on its own
+        size_t written = file == NULL ? 0 : fwrite(output, 1, outputLength, file);
+        
+        if (file == NULL ||
+            fclose(file) != 0 ||
+            written != outputLength) {
+            
+            fprintf(stderr, "unable to write %s\n", outputPath);
+        }
+        else {
+            fprintf(stderr, "wrote %zu strings, %zu bytes to %s\n", count, outputLength, outputPath);
+            retval = 0;
+        }
+    }
+    
+    free(output);
+    KSOTokenCorpusDestroySections(&corpus);
+    free(characters);
+    free(offsets);
+    free(weights);
+    
+    return retval;
+}